@@ -1,30 +1,6 @@
 #include "algebra.h"
 #include <cmath>
 
-Vector4 operator*(const Matrix4x4& mat, const Vector4& vec) {
-	return {
-		vec.x * mat.elem[0][0] + vec.y * mat.elem[0][1] + vec.z * mat.elem[0][2] + vec.w * mat.elem[0][3],
-		vec.x * mat.elem[1][0] + vec.y * mat.elem[1][1] + vec.z * mat.elem[1][2] + vec.w * mat.elem[1][3],
-		vec.x * mat.elem[2][0] + vec.y * mat.elem[2][1] + vec.z * mat.elem[2][2] + vec.w * mat.elem[2][3],
-		vec.x * mat.elem[3][0] + vec.y * mat.elem[3][1] + vec.z * mat.elem[3][2] + vec.w * mat.elem[3][3]
-	};
-}
-
-Vector4 operator*(const float& x, const Vector4& vec)
-{
-	return { x * vec.x, x * vec.y, x * vec.z, x * vec.w };
-}
-
-Vector4 operator+(const Vector4& vec1, const Vector4& vec2)
-{
-	return { vec1.x + vec2.x, vec1.y + vec2.y, vec1.z + vec2.z, vec1.w + vec2.w };
-}
-
-Vector4 operator-(const Vector4& vec1, const Vector4& vec2)
-{
-	return { vec1.x - vec2.x, vec1.y - vec2.y, vec1.z - vec2.z, vec1.w - vec2.w };
-}
-
 Vector4 operator-(const Vector4& vec)
 {
 	return { -vec.x,-vec.y,-vec.z,-vec.w };
@@ -56,35 +32,6 @@ Matrix3x3 operator*(const Matrix3x3& mat1, const Matrix3x3& mat2)
 	return result;
 }
 
-Matrix4x4 operator*(const Matrix4x4& mat1, const Matrix4x4& mat2) {
-	Matrix4x4 result;
-	for (int i = 0; i < Matrix4x4::DIMENSION; ++i) {
-		for (int j = 0; j < Matrix4x4::DIMENSION; ++j) {
-			result.elem[i][j] = mat1.elem[i][0] * mat2.elem[0][j] + mat1.elem[i][1] * mat2.elem[1][j] + mat1.elem[i][2] * mat2.elem[2][j] + mat1.elem[i][3] * mat2.elem[3][j];
-		}
-	}
-	return result;
-}
-
-Matrix4x4 mul_with_first_transposed(const Matrix4x4& mat1, const Matrix4x4& mat2) {
-	Matrix4x4 result;
-	for (int i = 0; i < Matrix4x4::DIMENSION; ++i) {
-		for (int j = 0; j < Matrix4x4::DIMENSION; ++j) {
-			result.elem[i][j] = mat1.elem[0][i] * mat2.elem[0][j] + mat1.elem[1][i] * mat2.elem[1][j] + mat1.elem[2][i] * mat2.elem[2][j] + mat1.elem[3][i] * mat2.elem[3][j];
-		}
-	}
-	return result;
-}
-
-float dot(const Vector4& vec1, const Vector4& vec2) {
-	return vec1.x * vec2.x + vec1.y * vec2.y + vec1.z * vec2.z + vec1.w * vec2.w;
-}
-
-float dot(const Vector3& vec1, const Vector3& vec2)
-{
-	return vec1.x * vec2.x + vec1.y * vec2.y + vec1.z * vec2.z;
-}
-
 float Vector4::length() const
 {
 	return sqrt(x * x + y * y + z * z + w * w);;
@@ -108,11 +55,6 @@ Vector4& Vector4::operator+=(const Vector4& vec)
 	return *this;
 }
 
-float Vector3::length() const
-{
-	return sqrt(x * x + y * y + z * z);
-}
-
 bool Vector3::is_valid() const
 {
 	return std::isfinite(x) && std::isfinite(y) && std::isfinite(z);
@@ -183,45 +125,6 @@ Vector3 Vector3::euler_angles(const Quaternion<float>& q)
 	};
 }
 
-Vector3 cross(const Vector3& vec1, const Vector3& vec2) {
-	return { vec1.y * vec2.z - vec1.z * vec2.y, vec1.z * vec2.x - vec1.x * vec2.z, vec1.x * vec2.y - vec1.y * vec2.x };
-}
-
-Vector3 normalize(const Vector3& vec) {
-	auto l = vec.length();
-	return { vec.x / l, vec.y / l, vec.z / l };
-}
-
-Vector3 operator+(const Vector3& vec1, const Vector3& vec2)
-{
-	return { vec1.x + vec2.x, vec1.y + vec2.y, vec1.z + vec2.z };
-}
-
-Vector3 operator-(const Vector3& vec1, const Vector3& vec2)
-{
-	return { vec1.x - vec2.x, vec1.y - vec2.y, vec1.z - vec2.z };
-}
-
-Vector3 operator-(const Vector3& vec)
-{
-	return { -vec.x,-vec.y,-vec.z };
-}
-
-Vector3 operator*(const float& x, const Vector3& vec)
-{
-	return { vec.x * x,vec.y * x,vec.z * x };
-}
-
-Vector3 operator/(const Vector3& vec, const float& x)
-{
-	return { vec.x / x,vec.y / x,vec.z / x };
-}
-
-Vector3 operator*(const Vector3& vec1, const Vector3& vec2)
-{
-	return { vec1.x * vec2.x, vec1.y * vec2.y, vec1.z * vec2.z };
-}
-
 bool operator==(const Vector3& vec1, const Vector3& vec2)
 {
 	return vec1.x == vec2.x && vec1.y == vec2.y && vec1.z == vec2.z;
@@ -247,28 +150,6 @@ Matrix3x3 transpose(const Matrix3x3& mat)
 	return res;
 }
 
-Matrix4x4 transpose(const Matrix4x4& mat)
-{
-	Matrix4x4 res;
-	res.elem[0][0] = mat.elem[0][0];
-	res.elem[0][1] = mat.elem[1][0];
-	res.elem[0][2] = mat.elem[2][0];
-	res.elem[0][3] = mat.elem[3][0];
-	res.elem[1][0] = mat.elem[0][1];
-	res.elem[1][1] = mat.elem[1][1];
-	res.elem[1][2] = mat.elem[2][1];
-	res.elem[1][3] = mat.elem[3][1];
-	res.elem[2][0] = mat.elem[0][2];
-	res.elem[2][1] = mat.elem[1][2];
-	res.elem[2][2] = mat.elem[2][2];
-	res.elem[2][3] = mat.elem[3][2];
-	res.elem[3][0] = mat.elem[0][3];
-	res.elem[3][1] = mat.elem[1][3];
-	res.elem[3][2] = mat.elem[2][3];
-	res.elem[3][3] = mat.elem[3][3];
-	return res;
-}
-
 Vector3 operator*(const Matrix3x3& mat, const Vector3& vec) {
 	return {
 		vec.x * mat.elem[0][0] + vec.y * mat.elem[0][1] + vec.z * mat.elem[0][2],
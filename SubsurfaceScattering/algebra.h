@@ -24,7 +24,7 @@ struct Vector2 {
 
 struct Vector3 {
 	float x, y, z;
-	float length() const;
+	inline float length() const { return std::sqrt(x * x + y * y + z * z); }
 	bool is_valid() const;
 
 	Vector3& operator*=(const float& a);
@@ -41,7 +41,7 @@ struct Vector3 {
 	static Vector3 euler_angles(const Quaternion<float>& q);
 };
 
-struct Vector4 {
+struct alignas(16) Vector4 {
 	float x, y, z, w;
 	float length() const;
 
@@ -71,11 +71,11 @@ struct IndexTriple {
 	inline unsigned int* data() { return reinterpret_cast<unsigned int*>(this); }
 };
 
-static_assert(std::is_pod_v<Vector4>, "Vector4 needs to be POD, but it's not");
-static_assert(std::is_pod_v<Vector3>, "Vector3 needs to be POD, but it's not");
-static_assert(std::is_pod_v<Vector2>, "Vector2 needs to be POD, but it's not");
-static_assert(std::is_pod_v<IndexPair>, "IndexPair needs to be POD, but it's not");
-static_assert(std::is_pod_v<IndexTriple>, "IndexTriple needs to be POD, but it's not");
+static_assert(std::is_standard_layout_v<Vector4> && std::is_trivial_v<Vector4>, "Vector4 needs to be POD, but it's not");
+static_assert(std::is_standard_layout_v<Vector3> && std::is_trivial_v<Vector3>, "Vector3 needs to be POD, but it's not");
+static_assert(std::is_standard_layout_v<Vector2> && std::is_trivial_v<Vector2>, "Vector2 needs to be POD, but it's not");
+static_assert(std::is_standard_layout_v<IndexPair> && std::is_trivial_v<IndexPair>, "IndexPair needs to be POD, but it's not");
+static_assert(std::is_standard_layout_v<IndexTriple> && std::is_trivial_v<IndexTriple>, "IndexTriple needs to be POD, but it's not");
 
 struct Matrix3x3 {
 	static const int DIMENSION = 3;
@@ -92,7 +92,7 @@ struct Matrix3x3 {
 	static Matrix3x3 rotation_angle_axis(const Vector3& axis, float angle_rad);
 };
 
-struct Matrix4x4 {
+struct alignas(16) Matrix4x4 {
 	static const int DIMENSION = 4;
 	float elem[DIMENSION][DIMENSION];
 
@@ -155,32 +155,44 @@ struct Range {
 	bool contains(T val) { return val >= from && val <= to; }
 };
 
-Vector4 operator*(const Matrix4x4& mat, const Vector4& vec);
-Vector4 operator*(const float& x, const Vector4& vec);
-Vector4 operator+(const Vector4& vec1, const Vector4& vec2);
-Vector4 operator-(const Vector4& vec1, const Vector4& vec2);
+#include "algebra_kernels.h"
+
+// Hot operators are defined inline, so that they can be inlined into every
+// translation unit.
+inline Vector4 operator*(const Matrix4x4& mat, const Vector4& vec) { return kernels::mul(mat, vec); }
+inline Vector4 operator*(const float& x, const Vector4& vec) { return kernels::scale(x, vec); }
+inline Vector4 operator+(const Vector4& vec1, const Vector4& vec2) { return kernels::add(vec1, vec2); }
+inline Vector4 operator-(const Vector4& vec1, const Vector4& vec2) { return kernels::sub(vec1, vec2); }
 Vector4 operator-(const Vector4& vec);
 bool operator==(const Vector4& vec1, const Vector4& vec2);
 bool operator!=(const Vector4& vec1, const Vector4& vec2);
 
 Matrix3x3 operator*(const Matrix3x3& mat1, const Matrix3x3& mat2);
-Matrix4x4 operator*(const Matrix4x4& mat1, const Matrix4x4& mat2);
+inline Matrix4x4 operator*(const Matrix4x4& mat1, const Matrix4x4& mat2) { return kernels::mul(mat1, mat2); }
+
+inline Matrix4x4 mul_with_first_transposed(const Matrix4x4& mat1, const Matrix4x4& mat2) { return kernels::mul_with_first_transposed(mat1, mat2); }
 
-Matrix4x4 mul_with_first_transposed(const Matrix4x4& mat1, const Matrix4x4& mat2);
+inline float dot(const Vector4& vec1, const Vector4& vec2) { return kernels::dot(vec1, vec2); }
 
-float dot(const Vector4& vec1, const Vector4& vec2);
-float dot(const Vector3& vec1, const Vector3& vec2);
+inline float dot(const Vector3& vec1, const Vector3& vec2) {
+	return vec1.x * vec2.x + vec1.y * vec2.y + vec1.z * vec2.z;
+}
 
-Vector3 cross(const Vector3& vec1, const Vector3& vec2);
+inline Vector3 cross(const Vector3& vec1, const Vector3& vec2) {
+	return { vec1.y * vec2.z - vec1.z * vec2.y, vec1.z * vec2.x - vec1.x * vec2.z, vec1.x * vec2.y - vec1.y * vec2.x };
+}
 
-Vector3 normalize(const Vector3& vec);
+inline Vector3 normalize(const Vector3& vec) {
+	const float inv_l = 1.0f / vec.length();
+	return { vec.x * inv_l, vec.y * inv_l, vec.z * inv_l };
+}
 
-Vector3 operator+(const Vector3& vec1, const Vector3& vec2);
-Vector3 operator-(const Vector3& vec1, const Vector3& vec2);
-Vector3 operator-(const Vector3& vec);
-Vector3 operator*(const float& x, const Vector3& vec);
-Vector3 operator/(const Vector3& vec, const float& x);
-Vector3 operator*(const Vector3& vec1, const Vector3& vec2);
+inline Vector3 operator+(const Vector3& vec1, const Vector3& vec2) { return { vec1.x + vec2.x, vec1.y + vec2.y, vec1.z + vec2.z }; }
+inline Vector3 operator-(const Vector3& vec1, const Vector3& vec2) { return { vec1.x - vec2.x, vec1.y - vec2.y, vec1.z - vec2.z }; }
+inline Vector3 operator-(const Vector3& vec) { return { -vec.x, -vec.y, -vec.z }; }
+inline Vector3 operator*(const float& x, const Vector3& vec) { return { vec.x * x, vec.y * x, vec.z * x }; }
+inline Vector3 operator/(const Vector3& vec, const float& x) { return { vec.x / x, vec.y / x, vec.z / x }; }
+inline Vector3 operator*(const Vector3& vec1, const Vector3& vec2) { return { vec1.x * vec2.x, vec1.y * vec2.y, vec1.z * vec2.z }; }
 bool operator==(const Vector3& vec1, const Vector3& vec2);
 bool operator!=(const Vector3& vec1, const Vector3& vec2);
 
@@ -194,7 +206,7 @@ bool operator==(const Vector2& vec1, const Vector2& vec2);
 bool operator!=(const Vector2& vec1, const Vector2& vec2);
 
 Matrix3x3 transpose(const Matrix3x3& mat);
-Matrix4x4 transpose(const Matrix4x4& mat);
+inline Matrix4x4 transpose(const Matrix4x4& mat) { return kernels::transpose(mat); }
 
 template <class V, class Number>
 inline constexpr V lerp(const V& from, const V& to, const Number& percent) {
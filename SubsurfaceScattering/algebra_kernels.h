@@ -0,0 +1,167 @@
+#pragma once
+
+// Kernels behind Matrix4x4 and Vector4 operators from algebra.h. Scalar kernels
+// are always compiled (benchmarks compare against them), SSE kernels are used
+// on every x86-64 target. Define ALGEBRA_NO_SIMD to force scalar code.
+// This header is included by algebra.h, don't include it directly.
+
+#if !defined(ALGEBRA_NO_SIMD) &&                                               \
+	(defined(__SSE2__) || defined(_M_X64) ||                                   \
+	 (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define ALGEBRA_USE_SSE
+#include <immintrin.h>
+#endif
+
+namespace scalar_kernels {
+
+inline Vector4 mul(const Matrix4x4& mat, const Vector4& vec) {
+	return {
+		vec.x * mat.elem[0][0] + vec.y * mat.elem[0][1] + vec.z * mat.elem[0][2] + vec.w * mat.elem[0][3],
+		vec.x * mat.elem[1][0] + vec.y * mat.elem[1][1] + vec.z * mat.elem[1][2] + vec.w * mat.elem[1][3],
+		vec.x * mat.elem[2][0] + vec.y * mat.elem[2][1] + vec.z * mat.elem[2][2] + vec.w * mat.elem[2][3],
+		vec.x * mat.elem[3][0] + vec.y * mat.elem[3][1] + vec.z * mat.elem[3][2] + vec.w * mat.elem[3][3]
+	};
+}
+
+inline Matrix4x4 mul(const Matrix4x4& mat1, const Matrix4x4& mat2) {
+	Matrix4x4 result;
+	for (int i = 0; i < Matrix4x4::DIMENSION; ++i) {
+		for (int j = 0; j < Matrix4x4::DIMENSION; ++j) {
+			result.elem[i][j] = mat1.elem[i][0] * mat2.elem[0][j] + mat1.elem[i][1] * mat2.elem[1][j] + mat1.elem[i][2] * mat2.elem[2][j] + mat1.elem[i][3] * mat2.elem[3][j];
+		}
+	}
+	return result;
+}
+
+inline Matrix4x4 mul_with_first_transposed(const Matrix4x4& mat1, const Matrix4x4& mat2) {
+	Matrix4x4 result;
+	for (int i = 0; i < Matrix4x4::DIMENSION; ++i) {
+		for (int j = 0; j < Matrix4x4::DIMENSION; ++j) {
+			result.elem[i][j] = mat1.elem[0][i] * mat2.elem[0][j] + mat1.elem[1][i] * mat2.elem[1][j] + mat1.elem[2][i] * mat2.elem[2][j] + mat1.elem[3][i] * mat2.elem[3][j];
+		}
+	}
+	return result;
+}
+
+inline Matrix4x4 transpose(const Matrix4x4& mat) {
+	Matrix4x4 res;
+	for (int i = 0; i < Matrix4x4::DIMENSION; ++i)
+		for (int j = 0; j < Matrix4x4::DIMENSION; ++j)
+			res.elem[i][j] = mat.elem[j][i];
+	return res;
+}
+
+inline Vector4 add(const Vector4& vec1, const Vector4& vec2) {
+	return { vec1.x + vec2.x, vec1.y + vec2.y, vec1.z + vec2.z, vec1.w + vec2.w };
+}
+
+inline Vector4 sub(const Vector4& vec1, const Vector4& vec2) {
+	return { vec1.x - vec2.x, vec1.y - vec2.y, vec1.z - vec2.z, vec1.w - vec2.w };
+}
+
+inline Vector4 scale(const float& x, const Vector4& vec) {
+	return { x * vec.x, x * vec.y, x * vec.z, x * vec.w };
+}
+
+inline float dot(const Vector4& vec1, const Vector4& vec2) {
+	return vec1.x * vec2.x + vec1.y * vec2.y + vec1.z * vec2.z + vec1.w * vec2.w;
+}
+
+} // namespace scalar_kernels
+
+#ifdef ALGEBRA_USE_SSE
+namespace sse_kernels {
+
+// a * b + c, fused when the target has FMA
+inline __m128 madd(__m128 a, __m128 b, __m128 c) {
+#if defined(__FMA__) || defined(__AVX2__)
+	return _mm_fmadd_ps(a, b, c);
+#else
+	return _mm_add_ps(_mm_mul_ps(a, b), c);
+#endif
+}
+
+inline __m128 load(const Vector4& vec) { return _mm_load_ps(&vec.x); }
+
+inline Vector4 store(__m128 v) {
+	Vector4 res;
+	_mm_store_ps(&res.x, v);
+	return res;
+}
+
+inline Vector4 mul(const Matrix4x4& mat, const Vector4& vec) {
+	const __m128 v = load(vec);
+	__m128 r0 = _mm_mul_ps(_mm_load_ps(mat.elem[0]), v);
+	__m128 r1 = _mm_mul_ps(_mm_load_ps(mat.elem[1]), v);
+	__m128 r2 = _mm_mul_ps(_mm_load_ps(mat.elem[2]), v);
+	__m128 r3 = _mm_mul_ps(_mm_load_ps(mat.elem[3]), v);
+	// horizontal sums of all four rows at once
+	_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+	return store(_mm_add_ps(_mm_add_ps(r0, r1), _mm_add_ps(r2, r3)));
+}
+
+// row i of the result is sum over k of coeffs[i][k] * mat2 row k
+inline Matrix4x4 combine_rows(const float (&coeffs)[4][4], const Matrix4x4& mat2) {
+	const __m128 b0 = _mm_load_ps(mat2.elem[0]);
+	const __m128 b1 = _mm_load_ps(mat2.elem[1]);
+	const __m128 b2 = _mm_load_ps(mat2.elem[2]);
+	const __m128 b3 = _mm_load_ps(mat2.elem[3]);
+
+	Matrix4x4 result;
+	for (int i = 0; i < Matrix4x4::DIMENSION; ++i) {
+		__m128 row = _mm_mul_ps(_mm_set1_ps(coeffs[i][0]), b0);
+		row = madd(_mm_set1_ps(coeffs[i][1]), b1, row);
+		row = madd(_mm_set1_ps(coeffs[i][2]), b2, row);
+		row = madd(_mm_set1_ps(coeffs[i][3]), b3, row);
+		_mm_store_ps(result.elem[i], row);
+	}
+	return result;
+}
+
+inline Matrix4x4 transpose(const Matrix4x4& mat) {
+	__m128 r0 = _mm_load_ps(mat.elem[0]);
+	__m128 r1 = _mm_load_ps(mat.elem[1]);
+	__m128 r2 = _mm_load_ps(mat.elem[2]);
+	__m128 r3 = _mm_load_ps(mat.elem[3]);
+	_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+	Matrix4x4 res;
+	_mm_store_ps(res.elem[0], r0);
+	_mm_store_ps(res.elem[1], r1);
+	_mm_store_ps(res.elem[2], r2);
+	_mm_store_ps(res.elem[3], r3);
+	return res;
+}
+
+inline Matrix4x4 mul(const Matrix4x4& mat1, const Matrix4x4& mat2) {
+	return combine_rows(mat1.elem, mat2);
+}
+
+inline Matrix4x4 mul_with_first_transposed(const Matrix4x4& mat1, const Matrix4x4& mat2) {
+	return combine_rows(transpose(mat1).elem, mat2);
+}
+
+inline Vector4 add(const Vector4& vec1, const Vector4& vec2) {
+	return store(_mm_add_ps(load(vec1), load(vec2)));
+}
+
+inline Vector4 sub(const Vector4& vec1, const Vector4& vec2) {
+	return store(_mm_sub_ps(load(vec1), load(vec2)));
+}
+
+inline Vector4 scale(const float& x, const Vector4& vec) {
+	return store(_mm_mul_ps(_mm_set1_ps(x), load(vec)));
+}
+
+inline float dot(const Vector4& vec1, const Vector4& vec2) {
+	const __m128 p = _mm_mul_ps(load(vec1), load(vec2));
+	const __m128 s = _mm_add_ps(p, _mm_movehl_ps(p, p));
+	return _mm_cvtss_f32(_mm_add_ss(s, _mm_shuffle_ps(s, s, 1)));
+}
+
+} // namespace sse_kernels
+
+namespace kernels = sse_kernels;
+#else
+namespace kernels = scalar_kernels;
+#endif
@@ -0,0 +1,157 @@
+#include "bernstein_weights.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+// vertices per pool job, smaller meshes are deformed on the calling thread
+constexpr size_t MIN_CHUNK = 8192;
+// how far rest positions may leave the unit cube, e.g. by rounding
+constexpr float OUTSIDE_TOLERANCE = 1e-3f;
+
+// cubic Bernstein polynomials at t and their derivatives
+void bernstein(float t, float (&b)[4], float (&db)[4]) {
+	const float s = 1.0f - t;
+	b[0] = s * s * s;
+	b[1] = 3.0f * t * s * s;
+	b[2] = 3.0f * t * t * s;
+	b[3] = t * t * t;
+	db[0] = -3.0f * s * s;
+	db[1] = 3.0f * s * s - 6.0f * t * s;
+	db[2] = 6.0f * t * s - 3.0f * t * t;
+	db[3] = 3.0f * t * t;
+}
+
+int16_t quantize(float value, float scale) {
+	return static_cast<int16_t>(std::clamp(std::lround(value * scale), -32767l, 32767l));
+}
+
+// Position and normal from the weighted sums: lane 0 of x, y and z is the
+// position, lanes 1 to 3 the derivatives along x, y and z.
+void finish_vertex(const float (&x)[4], const float (&y)[4], const float (&z)[4], const Vector3 &rest_normal,
+				   Vector3 &position, Vector3 *normal) {
+	position = {x[0], y[0], z[0]};
+	if (!normal)
+		return;
+	const Vector3 dx = {x[1], y[1], z[1]}, dy = {x[2], y[2], z[2]}, dz = {x[3], y[3], z[3]};
+	// the inverse transpose of the Jacobian is its cofactor matrix divided
+	// by its determinant, only the sign of which matters after normalizing
+	const Vector3 yz = cross(dy, dz);
+	Vector3 n = rest_normal.x * yz + rest_normal.y * cross(dz, dx) + rest_normal.z * cross(dx, dy);
+	if (dot(dx, yz) < 0.0f)
+		n = -n;
+	const float length = n.length();
+	*normal = length > 0.0f ? n / length : n;
+}
+} // namespace
+
+BernsteinWeights::BernsteinWeights(const Vector3 *rest_positions, const Vector3 *rest_normals, size_t count,
+								   float tolerance)
+	: rest_normals(rest_normals, rest_normals + count) {
+	offsets.reserve(count + 1);
+	struct Entry {
+		int point;
+		float weight, dx, dy, dz;
+	};
+	Entry kept[LATTICE_POINT_COUNT];
+
+	for (size_t v = 0; v < count; ++v) {
+		const Vector3 &p = rest_positions[v];
+		float b[3][4], db[3][4];
+		const float t[3] = {p.x, p.y, p.z};
+		for (int a = 0; a < 3; ++a) {
+			if (!(t[a] >= -OUTSIDE_TOLERANCE && t[a] <= 1.0f + OUTSIDE_TOLERANCE))
+				throw std::invalid_argument("BernsteinWeights: rest position outside the unit cube");
+			bernstein(std::clamp(t[a], 0.0f, 1.0f), b[a], db[a]);
+		}
+
+		int kept_count = 0;
+		float weight_sum = 0.0f;
+		for (int k = 0; k < 4; ++k)
+			for (int j = 0; j < 4; ++j)
+				for (int i = 0; i < 4; ++i) {
+					const Entry e = {i + 4 * j + 16 * k, b[0][i] * b[1][j] * b[2][k], db[0][i] * b[1][j] * b[2][k],
+									 b[0][i] * db[1][j] * b[2][k], b[0][i] * b[1][j] * db[2][k]};
+					const float largest =
+						std::max({std::abs(e.weight), std::abs(e.dx) / 3.0f, std::abs(e.dy) / 3.0f, std::abs(e.dz) / 3.0f});
+					if (largest < tolerance)
+						continue;
+					kept[kept_count++] = e;
+					weight_sum += e.weight;
+				}
+
+		// the kept weights sum to 1 again, so translating the lattice still
+		// translates the vertex
+		const float normalization = weight_sum > 0.0f ? 1.0f / weight_sum : 1.0f;
+		for (int e = 0; e < kept_count; ++e) {
+			points.push_back(static_cast<uint8_t>(kept[e].point));
+			weights.push_back({quantize(kept[e].weight * normalization, WEIGHT_SCALE),
+							   quantize(kept[e].dx, DERIVATIVE_SCALE), quantize(kept[e].dy, DERIVATIVE_SCALE),
+							   quantize(kept[e].dz, DERIVATIVE_SCALE)});
+		}
+		offsets.push_back(static_cast<uint32_t>(points.size()));
+	}
+}
+
+void BernsteinWeights::deform_range(const Vector3 *lattice, Vector3 *positions, Vector3 *normals, size_t begin,
+									size_t end) const {
+#ifdef ALGEBRA_USE_SSE
+	// the four weights of an entry are one pack, multiplied with each
+	// coordinate of its lattice point
+	const __m128 scale = _mm_setr_ps(1.0f / WEIGHT_SCALE, 1.0f / DERIVATIVE_SCALE, 1.0f / DERIVATIVE_SCALE,
+									 1.0f / DERIVATIVE_SCALE);
+	const auto accumulate = [&](uint32_t e, __m128 &sx, __m128 &sy, __m128 &sz) {
+		const __m128i q = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(weights[e].data()));
+		// sign extension of 16 to 32 bits
+		const __m128 w = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(q, q), 16));
+		const Vector3 &c = lattice[points[e]];
+		sx = sse_kernels::madd(w, _mm_set1_ps(c.x), sx);
+		sy = sse_kernels::madd(w, _mm_set1_ps(c.y), sy);
+		sz = sse_kernels::madd(w, _mm_set1_ps(c.z), sz);
+	};
+	for (size_t v = begin; v < end; ++v) {
+		// two sets of sums halve the chains of dependent additions
+		__m128 sx0 = _mm_setzero_ps(), sy0 = _mm_setzero_ps(), sz0 = _mm_setzero_ps();
+		__m128 sx1 = _mm_setzero_ps(), sy1 = _mm_setzero_ps(), sz1 = _mm_setzero_ps();
+		uint32_t e = offsets[v];
+		for (; e + 1 < offsets[v + 1]; e += 2) {
+			accumulate(e, sx0, sy0, sz0);
+			accumulate(e + 1, sx1, sy1, sz1);
+		}
+		if (e < offsets[v + 1])
+			accumulate(e, sx0, sy0, sz0);
+		float x[4], y[4], z[4];
+		_mm_storeu_ps(x, _mm_mul_ps(_mm_add_ps(sx0, sx1), scale));
+		_mm_storeu_ps(y, _mm_mul_ps(_mm_add_ps(sy0, sy1), scale));
+		_mm_storeu_ps(z, _mm_mul_ps(_mm_add_ps(sz0, sz1), scale));
+		finish_vertex(x, y, z, rest_normals[v], positions[v], normals ? normals + v : nullptr);
+	}
+#else
+	const float scale[4] = {1.0f / WEIGHT_SCALE, 1.0f / DERIVATIVE_SCALE, 1.0f / DERIVATIVE_SCALE,
+							1.0f / DERIVATIVE_SCALE};
+	for (size_t v = begin; v < end; ++v) {
+		float x[4] = {}, y[4] = {}, z[4] = {};
+		for (uint32_t e = offsets[v]; e < offsets[v + 1]; ++e) {
+			const Vector3 &c = lattice[points[e]];
+			for (int l = 0; l < 4; ++l) {
+				x[l] += weights[e][l] * c.x;
+				y[l] += weights[e][l] * c.y;
+				z[l] += weights[e][l] * c.z;
+			}
+		}
+		for (int l = 0; l < 4; ++l) {
+			x[l] *= scale[l];
+			y[l] *= scale[l];
+			z[l] *= scale[l];
+		}
+		finish_vertex(x, y, z, rest_normals[v], positions[v], normals ? normals + v : nullptr);
+	}
+#endif
+}
+
+void BernsteinWeights::deform(const Vector3 *lattice, Vector3 *positions, Vector3 *normals) const {
+	ThreadPool::shared().parallel_chunks(vertex_count(), MIN_CHUNK, 1, [&](size_t, size_t begin, size_t end) {
+		deform_range(lattice, positions, normals, begin, end);
+	});
+}
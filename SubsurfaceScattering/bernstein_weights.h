@@ -0,0 +1,54 @@
+#pragma once
+
+#include "algebra.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Deformation of mesh vertices by a 4x4x4 Bezier lattice as a sparse weighted
+// sum over lattice points. The trivariate cubic Bernstein weights of a vertex
+// only depend on its rest position, so they are computed once: for every
+// vertex the lattice points it depends on, with the weight and its
+// derivatives along x, y and z quantized to 16 bits. Weights below a
+// tolerance are pruned, which leaves vertices on the faces and edges of the
+// lattice with half or a quarter of the 64 points.
+//
+// Rest positions are lattice coordinates in [0, 1]^3 as in
+// phong_deformed_vertex_shader.glsl, lattice points are indexed
+// i + 4j + 16k like the control points of BezierCube.
+class BernsteinWeights {
+  public:
+	static constexpr int LATTICE_POINT_COUNT = 64;
+	// weight, d/dx, d/dy, d/dz
+	using Quantized = std::array<int16_t, 4>;
+	static constexpr float WEIGHT_SCALE = 32767.0f;
+	// derivatives of cubic Bernstein polynomials are within [-3, 3]
+	static constexpr float DERIVATIVE_SCALE = 32767.0f / 3.0f;
+
+  private:
+	// entries of vertex v are [offsets[v], offsets[v + 1])
+	std::vector<uint32_t> offsets = {0};
+	std::vector<uint8_t> points;
+	std::vector<Quantized> weights;
+	std::vector<Vector3> rest_normals;
+
+	void deform_range(const Vector3 *lattice, Vector3 *positions, Vector3 *normals, size_t begin, size_t end) const;
+
+  public:
+	BernsteinWeights() = default;
+	// Keeps the lattice points of a vertex whose weight or a derivative
+	// divided by 3 reaches tolerance. Throws std::invalid_argument for rest
+	// positions outside the unit cube.
+	BernsteinWeights(const Vector3 *rest_positions, const Vector3 *rest_normals, size_t count,
+					 float tolerance = 1e-4f);
+
+	size_t vertex_count() const { return rest_normals.size(); }
+	// kept lattice points of all vertices
+	size_t entry_count() const { return points.size(); }
+
+	// Positions and normals of the vertices deformed by lattice, normals may
+	// be null. Normals follow the inverse transpose of the deformation's
+	// Jacobian like normal mode 0 of the shader.
+	void deform(const Vector3 *lattice, Vector3 *positions, Vector3 *normals) const;
+};
@@ -2,12 +2,14 @@
 
 #include "vertex_array.h"
 #include "buffer.h"
+#include "streaming_buffer.h"
 #include "texture.h"
 #include "frame_buffer.h"
 #include "algebra.h"
 #include "quaternion.h"
 #include "camera.h"
 #include "shader.h"
+#include "mass_spring_lattice.h"
 #include <vector>
 
 static constexpr int SIDE_DIM = 4;
@@ -17,7 +19,8 @@ static constexpr int ODE_DIM = 2 * CONFIGURATION_SPACE_DIM;
 
 class BezierCube {
 	VertexArray vao;
-	VertexBuffer vbo;
+	// points of the last REGION_COUNT set_data calls
+	StreamingBuffer points;
 	ElementBuffer line_ebo;
 	ElementBuffer patch_ebo;
 	Shader simple_shader;
@@ -29,6 +32,13 @@ class BezierCube {
 		return i + SIDE_DIM * j + SIDE_DIM * SIDE_DIM * k;
 	}
 
+	void use_points(GLintptr offset) {
+		points.flush();
+		vao.bind();
+		glBindVertexBuffer(0, points.get_id(), offset, sizeof(Vector3));
+		vao.unbind();
+	}
+
 	void fill_ebos() {
 		line_count = SIDE_DIM * (SIDE_DIM - 1) * 3 * SIDE_DIM;
 
@@ -97,13 +107,15 @@ public:
 		points_visible = true,
 		patches_visible = true;
 
-	BezierCube() : vao(), vbo() {
+	BezierCube() : vao() {
 		vao.init();
 		vao.bind();
-		vbo.init();
-		vbo.bind();
+		points.init(GL_ARRAY_BUFFER, CUBE_POINT_COUNT * sizeof(Vector3));
+		// the offset of the points changes with every set_data
 		glEnableVertexAttribArray(0);
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
+		glVertexAttribFormat(0, 3, GL_FLOAT, GL_FALSE, 0);
+		glVertexAttribBinding(0, 0);
+		glBindVertexBuffer(0, points.get_id(), 0, sizeof(Vector3));
 		line_ebo.init();
 		patch_ebo.init();
 		vao.unbind();
@@ -117,13 +129,22 @@ public:
 	~BezierCube() {
 		simple_shader.dispose();
 		line_ebo.dispose();
-		vbo.dispose();
+		points.dispose();
 		vao.dispose();
 	}
 
+	// Points of the frame, at most one call per frame.
 	void set_data(const Vector3* data) {
-		vbo.bind();
-		vbo.set_static_data(reinterpret_cast<const float*>(data), CUBE_POINT_COUNT * sizeof(Vector3));
+		points.begin_frame();
+		use_points(points.write(data, CUBE_POINT_COUNT));
+	}
+
+	// Writes the lattice points straight into the streaming buffer.
+	void set_data(const MassSpringLattice<SIDE_DIM>& lattice) {
+		points.begin_frame();
+		const auto allocation = points.allocate(CUBE_POINT_COUNT * sizeof(Vector3));
+		lattice.get_positions(static_cast<Vector3*>(allocation.data));
+		use_points(allocation.offset);
 	}
 
 	void render_points(const Camera& camera, int width, int height)
@@ -131,7 +152,7 @@ public:
 		if (!points_visible)
 			return;
 
-		auto pv = camera.get_projection_matrix(width, height) * camera.get_view_matrix();
+		auto pv = camera.get_projection_view_matrix(width, height);
 
 		simple_shader.use();
 		simple_shader.set_pv(pv);
@@ -150,7 +171,7 @@ public:
 		if (!line_visible)
 			return;
 
-		auto pv = camera.get_projection_matrix(width, height) * camera.get_view_matrix();
+		auto pv = camera.get_projection_view_matrix(width, height);
 
 		simple_shader.use();
 		simple_shader.set_pv(pv);
@@ -169,7 +190,7 @@ public:
 		if (!patches_visible)
 			return;
 
-		auto pv = camera.get_projection_matrix(width, height) * camera.get_view_matrix();
+		auto pv = camera.get_projection_view_matrix(width, height);
 
 		bezier_shader.use();
 		bezier_shader.set_pv(pv);
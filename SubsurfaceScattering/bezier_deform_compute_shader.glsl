@@ -0,0 +1,60 @@
+#version 430 core
+
+// Deforms the rest vertices of a mesh by the Bezier lattice of every
+// instance, with the same bezier_lattice.glsl as
+// phong_deformed_vertex_shader.glsl, and writes the results once for all
+// passes of a frame. Invocation x is the vertex, y the instance.
+layout(local_size_x = 64) in;
+
+// 4x4x4 control points of every instance, w unused
+layout(std430, binding = 3) readonly buffer lattice_data {
+	vec4 lattices[];
+};
+
+// tightly packed vec3, as in the vertex buffers
+layout(std430, binding = 4) readonly buffer rest_position_data {
+	float rest_positions[];
+};
+layout(std430, binding = 5) readonly buffer rest_normal_data {
+	float rest_normals[];
+};
+layout(std430, binding = 6) writeonly buffer deformed_position_data {
+	float deformed_positions[];
+};
+layout(std430, binding = 7) writeonly buffer deformed_normal_data {
+	float deformed_normals[];
+};
+
+uniform uint vertex_count;
+uniform int normal_mode;
+uniform float normal_scale;
+
+int lattice_offset;
+
+vec3 bezier(int i)
+{
+	return lattices[lattice_offset + i].xyz;
+}
+
+#include "bezier_lattice.glsl"
+
+void main() {
+	uint vertex = gl_GlobalInvocationID.x;
+	if (vertex >= vertex_count)
+		return;
+	lattice_offset = 64 * int(gl_GlobalInvocationID.y);
+
+	vec3 input_pos = vec3(rest_positions[3 * vertex], rest_positions[3 * vertex + 1], rest_positions[3 * vertex + 2]);
+	vec3 input_normal = vec3(rest_normals[3 * vertex], rest_normals[3 * vertex + 1], rest_normals[3 * vertex + 2]);
+
+	vec3 normal;
+	vec3 world_pos = deform_vertex(input_pos, input_normal, normal_mode, normal_scale, normal);
+
+	uint out_index = 3 * (gl_GlobalInvocationID.y * vertex_count + vertex);
+	deformed_positions[out_index] = world_pos.x;
+	deformed_positions[out_index + 1] = world_pos.y;
+	deformed_positions[out_index + 2] = world_pos.z;
+	deformed_normals[out_index] = normal.x;
+	deformed_normals[out_index + 1] = normal.y;
+	deformed_normals[out_index + 2] = normal.z;
+}
@@ -26,6 +26,16 @@ public:
 		glBufferData(TARGET, data_size, data, GL_DYNAMIC_DRAW);
 	}
 
+	// Overwrites part of the storage allocated by set_*_data.
+	void update_data(const T* data, GLsizeiptr data_size, GLintptr offset = 0) {
+		glBufferSubData(TARGET, offset, data_size, data);
+	}
+
+	// Fills the whole buffer with zeros without reallocating it.
+	void clear_data(GLenum internal_format, GLenum format) const {
+		glClearBufferData(TARGET, internal_format, format, TYPE, nullptr);
+	}
+
 	void attrib_buffer(GLuint index, GLint size) const {
 		glEnableVertexAttribArray(index);
 		glVertexAttribPointer(index, size, TYPE, GL_FALSE, 0, nullptr);
@@ -35,6 +45,12 @@ public:
 		glBindBufferBase(TARGET, index, id);
 	}
 
+	// binds to an indexed target other than TARGET, e.g. a vertex buffer as
+	// shader storage
+	void bind_base(GLenum indexed_target, GLuint index) const {
+		glBindBufferBase(indexed_target, index, id);
+	}
+
 	void dispose() {
 		glDeleteBuffers(1, &id);
 	}
@@ -42,4 +58,5 @@ public:
 
 using VertexBuffer = GlBuffer<GLfloat, GL_FLOAT, GL_ARRAY_BUFFER>;
 using ElementBuffer = GlBuffer<GLuint, GL_UNSIGNED_INT, GL_ELEMENT_ARRAY_BUFFER>;
-using ShaderStorageBuffer = GlBuffer<GLfloat, GL_FLOAT, GL_SHADER_STORAGE_BUFFER>;
\ No newline at end of file
+using ShaderStorageBuffer = GlBuffer<GLfloat, GL_FLOAT, GL_SHADER_STORAGE_BUFFER>;
+using ShaderStorageUintBuffer = GlBuffer<GLuint, GL_UNSIGNED_INT, GL_SHADER_STORAGE_BUFFER>;
\ No newline at end of file
@@ -3,72 +3,27 @@
 #include <cmath>
 //#include "application_settings.h"
 
-Matrix4x4 Camera::get_view_matrix() const {
+void Camera::update_view() {
 	Matrix3x3 rot3 = Matrix3x3::get_rotation(rotx, roty, rotz);
-	auto n_dir = scale * normalize(rot3 * direction);
-	auto n_up = scale * normalize(rot3 * up);
-	auto right = scale * normalize(cross(n_dir, n_up));
-	Matrix4x4 rot4(right, n_up, n_dir);
-	rot4.elem[3][3] = 1;
+	rotated_direction = rot3 * direction;
+	unit_direction = normalize(rotated_direction);
+	unit_up = normalize(rot3 * up);
+	unit_right = normalize(cross(unit_direction, unit_up));
 
-	Matrix4x4 trt, trd;
-	trt.elem[0][0] = 1;
-	trt.elem[1][1] = 1;
-	trt.elem[2][2] = 1;
-	trt.elem[3][3] = 1;
-
-	trt.elem[0][3] = -target.x;
-	trt.elem[1][3] = -target.y;
-	trt.elem[2][3] = -target.z;
-
-	trd.elem[0][0] = 1;
-	trd.elem[1][1] = 1;
-	trd.elem[2][2] = 1;
-	trd.elem[3][3] = 1;
-
-	/*trd.elem[0][3] = direction.x;
-	trd.elem[1][3] = direction.y;
-	trd.elem[2][3] = direction.z;*/
-	trd.elem[0][3] = 0;
-	trd.elem[1][3] = 0;
-	trd.elem[2][3] = distance_to_target;
-
-	return trd * rot4 * trt;
-}
-
-Matrix4x4 Camera::get_inverse_view_matrix() const
-{
-	Matrix3x3 rot3 = Matrix3x3::get_rotation(rotx, roty, rotz);
-	auto n_dir = (1 / scale) * normalize(rot3 * direction);
-	auto n_up = (1 / scale) * normalize(rot3 * up);
-	auto right = (1 / scale) * normalize(cross(n_dir, n_up));
-	Matrix4x4 rot4(right, n_up, n_dir);
+	Matrix4x4 rot4(scale * unit_right, scale * unit_up, scale * unit_direction);
 	rot4.elem[3][3] = 1;
-	Matrix4x4 rot4_inv = transpose(rot4);
-
-	Matrix4x4 trt, trd;
-	trt.elem[0][0] = 1;
-	trt.elem[1][1] = 1;
-	trt.elem[2][2] = 1;
-	trt.elem[3][3] = 1;
+	const float inv_scale = 1 / scale;
+	Matrix4x4 rot4_inv = transpose(Matrix4x4(inv_scale * unit_right, inv_scale * unit_up, inv_scale * unit_direction));
+	rot4_inv.elem[3][3] = 1;
 
-	trt.elem[0][3] = target.x;
-	trt.elem[1][3] = target.y;
-	trt.elem[2][3] = target.z;
+	const Vector3 to_eye = { 0, 0, distance_to_target };
 
-	trd.elem[0][0] = 1;
-	trd.elem[1][1] = 1;
-	trd.elem[2][2] = 1;
-	trd.elem[3][3] = 1;
+	view = Matrix4x4::translation(to_eye) * rot4 * Matrix4x4::translation(-target);
+	inverse_view = Matrix4x4::translation(target) * rot4_inv * Matrix4x4::translation(-to_eye);
+	world_position = target - (distance_to_target / scale) * rotated_direction;
+	cached_projection.projection_view = cached_projection.projection * view;
 
-	/*trd.elem[0][3] = -direction.x;
-	trd.elem[1][3] = -direction.y;
-	trd.elem[2][3] = -direction.z;*/
-	trd.elem[0][3] = 0;
-	trd.elem[1][3] = 0;
-	trd.elem[2][3] = -distance_to_target;
-
-	return trt * rot4_inv * trd;
+	++version;
 }
 
 Matrix4x4 Camera::get_bilinear_form_transformation_matrix() const
@@ -105,7 +60,7 @@ Matrix4x4 Camera::get_bilinear_form_transformation_matrix() const
 	return trt * rot4 * trd;
 }
 
-Matrix4x4 Camera::get_projection_matrix(int width, int height) const
+Matrix4x4 Camera::calculate_projection_matrix(int width, int height) const
 {
 	if (eye_distance == 0)
 	{
@@ -132,7 +87,7 @@ Matrix4x4 Camera::get_projection_matrix(int width, int height) const
 	return result * Matrix4x4::translation({ -eye_distance * 0.5f,0.0f,0.0f });
 }
 
-Matrix4x4 Camera::get_inverse_projection_matrix(int width, int height) const
+Matrix4x4 Camera::calculate_inverse_projection_matrix(int width, int height) const
 {
 	Matrix4x4 result;
 	float tgfov2 = tanf(0.5f * fov_rad);
@@ -145,20 +100,69 @@ Matrix4x4 Camera::get_inverse_projection_matrix(int width, int height) const
 	return result;
 }
 
-void Camera::move_by(const Vector3& vec)
+void Camera::update_projection()
 {
-	Matrix3x3 rot3 = Matrix3x3::get_rotation(rotx, roty, rotz);
-	auto n_dir = (1 / scale) * normalize(rot3 * direction);
-	auto n_up = (1 / scale) * normalize(rot3 * up);
-	auto right = (1 / scale) * normalize(cross(n_dir, n_up));
+	auto& c = cached_projection;
+	if (c.width <= 0 || c.height <= 0)
+		return;
+	c.near = near;
+	c.far = far;
+	c.fov_rad = fov_rad;
+	c.eye_distance = eye_distance;
+	c.focus_plane = focus_plane;
+	c.projection = calculate_projection_matrix(c.width, c.height);
+	c.inverse_projection = calculate_inverse_projection_matrix(c.width, c.height);
+	c.projection_view = c.projection * view;
+}
+
+bool Camera::is_projection_cached(int width, int height) const
+{
+	const auto& c = cached_projection;
+	return width > 0 && height > 0 && c.width == width && c.height == height && c.near == near && c.far == far &&
+		c.fov_rad == fov_rad && c.eye_distance == eye_distance && c.focus_plane == focus_plane;
+}
+
+void Camera::set_viewport(int width, int height)
+{
+	cached_projection.width = width;
+	cached_projection.height = height;
+	update_projection();
+}
+
+Matrix4x4 Camera::get_projection_matrix(int width, int height) const
+{
+	if (is_projection_cached(width, height))
+		return cached_projection.projection;
+	return calculate_projection_matrix(width, height);
+}
+
+Matrix4x4 Camera::get_inverse_projection_matrix(int width, int height) const
+{
+	if (is_projection_cached(width, height))
+		return cached_projection.inverse_projection;
+	return calculate_inverse_projection_matrix(width, height);
+}
+
+Matrix4x4 Camera::get_projection_view_matrix(int width, int height) const
+{
+	if (is_projection_cached(width, height))
+		return cached_projection.projection_view;
+	return calculate_projection_matrix(width, height) * view;
+}
 
-	target += vec.x * right + vec.y * n_up + vec.z * n_dir;
+void Camera::move_by(const Vector3& vec)
+{
+	target += (1 / scale) * (vec.x * unit_right + vec.y * unit_up + vec.z * unit_direction);
+	update_view();
 }
 
 void Camera::zoom(float factor)
 {
 	if (scale * factor <= 10000 && scale * factor >= 0.0001)
+	{
 		scale *= factor;
+		update_view();
+	}
 }
 
 void Camera::rotate(float ang_x, float ang_y, float ang_z)
@@ -166,6 +170,7 @@ void Camera::rotate(float ang_x, float ang_y, float ang_z)
 	rotx += ang_x;
 	roty += ang_y;
 	rotz += ang_z;
+	update_view();
 }
 
 Vector3 Camera::get_rotation_deg() const
@@ -177,28 +182,26 @@ Vector3 Camera::screen_to_world(const Vector3& screen, int width, int height) co
 {
 	float w = -2.0f * far * near / (screen.z * (far - near) - far - near);
 	Vector4 scr4{ screen.x * w, screen.y * w,screen.z * w, w };
-	Vector4 res4 = get_inverse_view_matrix() * (get_inverse_projection_matrix(width, height) * scr4);
+	Vector4 res4 = inverse_view * (get_inverse_projection_matrix(width, height) * scr4);
 	return { res4.x, res4.y, res4.z };
 }
 
 Vector3 Camera::world_to_screen(const Vector3& world, int width, int height) const
 {
 	Vector4 src4 = Vector4::extend(world, 1.0f);
-	Vector4 res4 = get_projection_matrix(width, height) * (get_view_matrix() * src4);
+	Vector4 res4 = get_projection_view_matrix(width, height) * src4;
 	return { res4.x / res4.w,res4.y / res4.w,res4.z / res4.w };
 }
 
-Vector3 Camera::get_world_position() const
-{
-	Matrix3x3 rot3 = Matrix3x3::get_rotation(rotx, roty, rotz);
-	return target - (distance_to_target / scale) * (rot3 * direction);
-}
-
 void Camera::look_from_at(const Vector3 &from, const Vector3 &at) 
 {
 	float d = (at - from).length();
 	if (d < 1e-5)
 		return;
+	// the light camera is pointed every frame, keep the version if nothing moved
+	if (at == target && d == distance_to_target && normalize(at - from) == direction &&
+		rotx == 0 && roty == 0 && rotz == 0)
+		return;
 	target = at;
 	direction = normalize(at - from);
 	distance_to_target = d;
@@ -209,17 +212,23 @@ void Camera::look_from_at(const Vector3 &from, const Vector3 &at)
 	else
 		up = normalize(up_candidate);
 	rotx = roty = rotz = 0;
+	update_view();
 }
 
 void Camera::look_from_at_box(const Vector3 &from, const Box &box, const Matrix4x4& transform) 
 {
 	const auto at = box.center(transform);
 	look_from_at(from, at);
-	fov_rad = 2.0f * atanf(0.5f * box.diameter(transform) / (from - at).length());
+	const float new_fov_rad = 2.0f * atanf(0.5f * box.diameter(transform) / (from - at).length());
+	if (new_fov_rad != fov_rad) {
+		fov_rad = new_fov_rad;
+		update_projection();
+	}
 }
 
 Camera::Camera() {
 	direction = { 0,0,1 };
 	target = { 0,0,0 };
 	up = { 0,-1,0 };
+	update_view();
 }
\ No newline at end of file
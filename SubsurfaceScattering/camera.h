@@ -15,6 +15,34 @@ class Camera {
 	float rotx = 0.25f * PI, roty = 0.25f * PI, rotz = 0.0f;
 	float scale = 1;
 	float distance_to_target = 5.0f;
+
+	// Everything derived from the private state above is recomputed eagerly by
+	// update_view, so const getters only read. version is bumped on each change.
+	unsigned int version = 0;
+	Vector3 rotated_direction;
+	Vector3 unit_direction, unit_up, unit_right;
+	Matrix4x4 view;
+	Matrix4x4 inverse_view;
+	Vector3 world_position;
+
+	// Projection also depends on the public fields and the viewport size.
+	// update_projection computes it eagerly for the viewport of set_viewport,
+	// getters for another size or after the fields were changed directly
+	// compute it on the fly, so const getters never write.
+	struct Projection {
+		int width = 0, height = 0;
+		float near, far, fov_rad, eye_distance, focus_plane;
+		Matrix4x4 projection;
+		Matrix4x4 inverse_projection;
+		Matrix4x4 projection_view;
+	};
+	Projection cached_projection;
+
+	void update_view();
+	void update_projection();
+	bool is_projection_cached(int width, int height) const;
+	Matrix4x4 calculate_projection_matrix(int width, int height) const;
+	Matrix4x4 calculate_inverse_projection_matrix(int width, int height) const;
 public:
 	float near = 0.1f, far = 100.0f;
 	float fov_rad = 0.25f * PI;
@@ -23,21 +51,27 @@ public:
 
 	float eye_distance = 0, focus_plane = 10.0f;
 
-	Matrix4x4 get_view_matrix() const;
-	Matrix4x4 get_inverse_view_matrix() const;
+	const Matrix4x4& get_view_matrix() const { return view; }
+	const Matrix4x4& get_inverse_view_matrix() const { return inverse_view; }
 	Matrix4x4 get_projection_matrix(int width, int height) const;
 	Matrix4x4 get_inverse_projection_matrix(int width, int height) const;
+	Matrix4x4 get_projection_view_matrix(int width, int height) const;
+	// viewport the projection is precomputed for, once per frame before the
+	// passes, also after changing near, far, fov_rad, eye_distance or
+	// focus_plane
+	void set_viewport(int width, int height);
+	unsigned int get_version() const { return version; }
 	Matrix4x4 get_bilinear_form_transformation_matrix() const;
 	void move_by(const Vector3& vec);
 	void zoom(float factor);
 	void rotate(float ang_x, float ang_y, float ang_z);
 	float get_scale() const { return scale; }
 	Vector3 get_rotation_deg() const;
-	void reset_scale() { scale = 1.0f; }
+	void reset_scale() { scale = 1.0f; update_view(); }
 	Vector3 screen_to_world(const Vector3& screen, int width, int height) const;
 	Vector3 world_to_screen(const Vector3& world, int width, int height) const;
-	Vector3 get_world_position() const;
-	void look_at(const Vector3& vector) { target = vector; }
+	const Vector3& get_world_position() const { return world_position; }
+	void look_at(const Vector3& vector) { target = vector; update_view(); }
 	void look_from_at(const Vector3 &from, const Vector3 &at);
 	void look_from_at_box(const Vector3 &from, const Box &box, const Matrix4x4& transform);
 	Camera();
@@ -0,0 +1,199 @@
+#pragma once
+
+#include "thread_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include <utility>
+
+// Task written as a coroutine instead of a SingleTaskStep state machine:
+//
+//	CoroutineTask bake(Mesh& mesh) {
+//		co_await worker_thread();	// heavy part off the UI thread
+//		...
+//		co_await next_frame();		// back on the UI thread, e.g. for GL
+//		for (...) {
+//			...
+//			co_await budget(std::chrono::milliseconds(2));
+//		}
+//	}
+//
+// TaskManager starts it on the frame after add_coroutine and resumes it on
+// the UI thread within its per-frame coroutine budget.
+class CoroutineTask {
+public:
+	using Clock = std::chrono::steady_clock;
+
+	enum class Location : unsigned char {
+		// suspended, resumed by TaskManager on the UI thread
+		Frame,
+		// running or queued on the thread pool
+		Worker,
+		Done,
+	};
+
+	// outlives the coroutine frame, the final suspension publishes Done
+	// through it after which the frame may be destroyed at any time
+	struct Status {
+		std::atomic<Location> location{ Location::Frame };
+	};
+
+	struct promise_type {
+		std::shared_ptr<Status> status = std::make_shared<Status>();
+		StopSource stop;
+		ThreadPool* pool = nullptr;
+		// set by TaskManager before every resume on the UI thread
+		Clock::time_point resume_time, frame_deadline;
+		std::exception_ptr error;
+
+		CoroutineTask get_return_object() { return CoroutineTask(std::coroutine_handle<promise_type>::from_promise(*this)); }
+		std::suspend_always initial_suspend() noexcept { return {}; }
+
+		auto final_suspend() noexcept {
+			struct FinalAwaiter {
+				bool await_ready() noexcept { return false; }
+				void await_suspend(std::coroutine_handle<promise_type> handle) noexcept {
+					// the frame must not be touched once Done is visible
+					auto status = handle.promise().status;
+					status->location = Location::Done;
+					status->location.notify_all();
+				}
+				void await_resume() noexcept {}
+			};
+			return FinalAwaiter{};
+		}
+
+		void return_void() {}
+		void unhandled_exception() { error = std::current_exception(); }
+	};
+
+	using Handle = std::coroutine_handle<promise_type>;
+
+private:
+	friend class TaskManager;
+
+	Handle handle;
+	std::shared_ptr<Status> status;
+
+	explicit CoroutineTask(Handle handle) : handle(handle), status(handle.promise().status) {}
+
+	// Resumes the coroutine if it waits for a frame. Returns false if it
+	// didn't run.
+	bool resume(ThreadPool& pool, Clock::time_point frame_deadline) {
+		if (!handle || status->location != Location::Frame)
+			return false;
+		auto& promise = handle.promise();
+		if (promise.stop.stop_requested()) {
+			// suspended on the UI thread, safe to drop here
+			status->location = Location::Done;
+			return false;
+		}
+		promise.pool = &pool;
+		promise.resume_time = Clock::now();
+		promise.frame_deadline = frame_deadline;
+		handle.resume();
+		return true;
+	}
+
+	// Rethrows what the coroutine threw, once it is done.
+	void rethrow_error() {
+		if (handle && handle.promise().error)
+			std::rethrow_exception(std::exchange(handle.promise().error, nullptr));
+	}
+
+public:
+	CoroutineTask(CoroutineTask&& task) noexcept
+		: handle(std::exchange(task.handle, nullptr)), status(std::move(task.status)) {}
+
+	CoroutineTask& operator=(CoroutineTask&&) = delete;
+
+	bool ended() const { return !handle || status->location == Location::Done; }
+
+	// Asks the coroutine to stop. It is dropped at its next suspension on the
+	// UI thread; work on the pool can poll co_await stop_token() to get there
+	// sooner.
+	void cancel() {
+		if (handle)
+			handle.promise().stop.request_stop();
+	}
+
+	~CoroutineTask() {
+		if (!handle)
+			return;
+		cancel();
+		// a worker may still run the coroutine
+		status->location.wait(Location::Worker);
+		handle.destroy();
+	}
+};
+
+// Suspends until the next frame, where the coroutine continues on the UI
+// thread, also when it was moved to a worker before.
+inline auto next_frame() {
+	struct Awaiter {
+		bool await_ready() noexcept { return false; }
+		void await_suspend(CoroutineTask::Handle handle) noexcept {
+			// the UI thread may destroy the frame as soon as it sees Frame
+			auto status = handle.promise().status;
+			status->location = CoroutineTask::Location::Frame;
+			status->location.notify_all();
+		}
+		void await_resume() noexcept {}
+	};
+	return Awaiter{};
+}
+
+// Suspends until the next frame if the coroutine has run for slice since it
+// was resumed, or the coroutine budget of the frame is used up. Doesn't
+// suspend on a worker.
+inline auto budget(std::chrono::steady_clock::duration slice) {
+	struct Awaiter {
+		std::chrono::steady_clock::duration slice;
+
+		bool await_ready() noexcept { return false; }
+		bool await_suspend(CoroutineTask::Handle handle) noexcept {
+			auto& promise = handle.promise();
+			if (promise.status->location == CoroutineTask::Location::Worker)
+				return false;
+			const auto deadline = std::min(promise.resume_time + slice, promise.frame_deadline);
+			return CoroutineTask::Clock::now() >= deadline;
+		}
+		void await_resume() noexcept {}
+	};
+	return Awaiter{ slice };
+}
+
+// Continues the coroutine on the thread pool, until it awaits next_frame().
+inline auto worker_thread() {
+	struct Awaiter {
+		bool await_ready() noexcept { return false; }
+		bool await_suspend(CoroutineTask::Handle handle) {
+			auto& promise = handle.promise();
+			if (promise.status->location == CoroutineTask::Location::Worker)
+				return false;
+			promise.status->location = CoroutineTask::Location::Worker;
+			promise.pool->submit([handle]() { handle.resume(); });
+			return true;
+		}
+		void await_resume() noexcept {}
+	};
+	return Awaiter{};
+}
+
+// Token of the coroutine's stop request, without suspending.
+inline auto stop_token() {
+	struct Awaiter {
+		StopToken token;
+
+		bool await_ready() noexcept { return false; }
+		bool await_suspend(CoroutineTask::Handle handle) noexcept {
+			token = handle.promise().stop.get_token();
+			return false;
+		}
+		StopToken await_resume() noexcept { return token; }
+	};
+	return Awaiter{};
+}
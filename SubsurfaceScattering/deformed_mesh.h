@@ -2,30 +2,225 @@
 
 #include "mesh.h"
 #include "bezier_cube.h"
+#include "bernstein_weights.h"
+#include "streaming_buffer.h"
+#include <stdexcept>
+#include <vector>
 
+// Mesh deformed by Bezier lattices of CUBE_POINT_COUNT control points. The
+// lattices of a frame go to a shader storage buffer, one per instance, and
+// a single instanced draw renders the mesh deformed by each of them.
+//
+// Frames with several passes deform once instead: deform() writes the
+// deformed vertices of all instances to vertex buffers with a compute
+// shader, render_deformed() then draws them as plain geometry with any
+// shader, e.g. Phong or DepthMap. With BernsteinWeights of the rest vertices
+// deform() can also run on the CPU.
 template <GLenum MODE>
 class DeformedMesh : public Mesh<MODE> {
-	GLint bezier_location;
+	static constexpr GLuint LATTICE_BINDING = 3;
+	static constexpr GLuint REST_POSITION_BINDING = 4, REST_NORMAL_BINDING = 5;
+	static constexpr GLuint DEFORMED_POSITION_BINDING = 6, DEFORMED_NORMAL_BINDING = 7;
+	// local size of bezier_deform_compute_shader.glsl
+	static constexpr GLuint DEFORM_GROUP_SIZE = 64;
+
 	GLint normal_mode_location;
 	GLint normal_scale_location;
+	GLint deform_vertex_count_location;
+	GLint deform_normal_mode_location;
+	GLint deform_normal_scale_location;
+
+	// deformed vertices, instance after instance
+	VertexArray deformed_vao;
+	VertexBuffer deformed_positions;
+	VertexBuffer deformed_normals;
+	// in vertices
+	size_t deformed_capacity = 0;
+	// instances deform() wrote, 0 until the next deform() after set_lattices
+	size_t deformed_instances = 0;
+	// arguments of the multi draw, kept between frames
+	std::vector<GLsizei> draw_counts;
+	std::vector<const void*> draw_offsets;
+	std::vector<GLint> draw_base_vertices;
+	// results of the CPU deformation before the upload
+	std::vector<Vector3> cpu_positions, cpu_normals;
+
+	void reserve_deformed(size_t vertex_total) {
+		if (vertex_total <= deformed_capacity)
+			return;
+		deformed_positions.bind();
+		deformed_positions.set_dynamic_data(nullptr, vertex_total * sizeof(Vector3));
+		deformed_normals.bind();
+		deformed_normals.set_dynamic_data(nullptr, vertex_total * sizeof(Vector3));
+		deformed_capacity = vertex_total;
+	}
+	size_t max_instances;
+	StreamingBuffer lattices;
+	// range of the lattices set for the frame
+	GLintptr lattices_offset = 0;
+	size_t instance_count = 0;
 public:
-	DeformedMesh() : Mesh<MODE>(ShaderType::PhongDeformed) {
+	explicit DeformedMesh(size_t max_instances = 64) : Mesh<MODE>(ShaderType::PhongDeformed), max_instances(max_instances) {
 		Shader& shader = ShaderLibrary::get_shader(ShaderType::PhongDeformed);
-		bezier_location = shader.get_uniform_location("bezier");
 		normal_mode_location = shader.get_uniform_location("normal_mode");
 		normal_scale_location = shader.get_uniform_location("normal_scale");
+		lattices.init(GL_SHADER_STORAGE_BUFFER, max_instances * CUBE_POINT_COUNT * sizeof(Vector4));
+
+		Shader& deform_shader = ShaderLibrary::get_shader(ShaderType::BezierDeform);
+		deform_vertex_count_location = deform_shader.get_uniform_location("vertex_count");
+		deform_normal_mode_location = deform_shader.get_uniform_location("normal_mode");
+		deform_normal_scale_location = deform_shader.get_uniform_location("normal_scale");
+
+		deformed_vao.init();
+		deformed_vao.bind();
+		deformed_positions.init();
+		deformed_positions.bind();
+		deformed_positions.attrib_buffer(0, 3);
+		deformed_normals.init();
+		deformed_normals.bind();
+		deformed_normals.attrib_buffer(1, 3);
+		this->ebo.bind();
+		deformed_vao.unbind();
 	}
 
-	void render(const Camera& camera, int width, int height, const Vector3* bezier, const int normal_mode = 0, const float normal_scale = 1.1f);
+	~DeformedMesh() {
+		deformed_normals.dispose();
+		deformed_positions.dispose();
+		deformed_vao.dispose();
+		lattices.dispose();
+	}
+
+	// Lattices of the frame, count * CUBE_POINT_COUNT points, at most once
+	// per frame and before the draws using them.
+	void set_lattices(const Vector3* points, size_t count);
+
+	// draws one instance per lattice set for the frame
+	void render_instances(const Camera& camera, int width, int height, const int normal_mode = 0, const float normal_scale = 1.1f);
+
+	// Deforms the mesh by the lattices set for the frame, once for all
+	// render_deformed calls of the frame.
+	void deform(const int normal_mode = 0, const float normal_scale = 1.1f);
+	// Same as deform() with normal mode 0, on the CPU from weights of the
+	// vertices set with set_data, for count lattices of CUBE_POINT_COUNT
+	// points.
+	void deform(const BernsteinWeights& weights, const Vector3* lattices, size_t count);
+
+	// draws the instances deform() wrote with the shader of the given type
+	void render_deformed(const Camera& camera, const ScatteringParameters& parameters, int width, int height,
+		ShaderType type = ShaderType::Phong);
+
+	// single lattice, sets it for the frame
+	void render(const Camera& camera, int width, int height, const Vector3* bezier, const int normal_mode = 0, const float normal_scale = 1.1f) {
+		set_lattices(bezier, 1);
+		render_instances(camera, width, height, normal_mode, normal_scale);
+	}
 };
 
 template<GLenum MODE>
-void DeformedMesh<MODE>::render(const Camera& camera, int width, int height, const Vector3* bezier, const int normal_mode, const float normal_scale)
+void DeformedMesh<MODE>::set_lattices(const Vector3* points, size_t count)
+{
+	if (count > max_instances)
+		throw std::invalid_argument("DeformedMesh::set_lattices: more lattices than max_instances");
+
+	// std430 arrays of vec3 have a stride of vec4
+	lattices.begin_frame();
+	const size_t point_count = count * CUBE_POINT_COUNT;
+	const auto allocation = lattices.allocate(point_count * sizeof(Vector4), lattices.get_block_alignment());
+	Vector4* data = static_cast<Vector4*>(allocation.data);
+	for (size_t i = 0; i < point_count; ++i)
+		data[i] = { points[i].x, points[i].y, points[i].z, 1.0f };
+	lattices.flush();
+	lattices_offset = allocation.offset;
+	instance_count = count;
+	deformed_instances = 0;
+}
+
+template<GLenum MODE>
+void DeformedMesh<MODE>::deform(const int normal_mode, const float normal_scale)
+{
+	deformed_instances = 0;
+	if (instance_count == 0 || this->vertex_count == 0)
+		return;
+
+	reserve_deformed(instance_count * this->vertex_count);
+
+	Shader& shader = ShaderLibrary::get_shader(ShaderType::BezierDeform);
+	shader.use();
+	glUniform1ui(deform_vertex_count_location, static_cast<GLuint>(this->vertex_count));
+	glUniform1i(deform_normal_mode_location, normal_mode);
+	glUniform1f(deform_normal_scale_location, normal_scale);
+	lattices.bind_range(GL_SHADER_STORAGE_BUFFER, LATTICE_BINDING, lattices_offset,
+		instance_count * CUBE_POINT_COUNT * sizeof(Vector4));
+	this->vbo.bind_base(GL_SHADER_STORAGE_BUFFER, REST_POSITION_BINDING);
+	this->normal_vbo.bind_base(GL_SHADER_STORAGE_BUFFER, REST_NORMAL_BINDING);
+	deformed_positions.bind_base(GL_SHADER_STORAGE_BUFFER, DEFORMED_POSITION_BINDING);
+	deformed_normals.bind_base(GL_SHADER_STORAGE_BUFFER, DEFORMED_NORMAL_BINDING);
+
+	glDispatchCompute(static_cast<GLuint>((this->vertex_count + DEFORM_GROUP_SIZE - 1) / DEFORM_GROUP_SIZE),
+		static_cast<GLuint>(instance_count), 1);
+	// the passes read the results as vertex attributes
+	glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+	deformed_instances = instance_count;
+}
+
+template<GLenum MODE>
+void DeformedMesh<MODE>::deform(const BernsteinWeights& weights, const Vector3* lattices, size_t count)
+{
+	if (weights.vertex_count() != this->vertex_count)
+		throw std::invalid_argument("DeformedMesh::deform: weights of a different mesh");
+	deformed_instances = 0;
+	const size_t vertex_total = count * this->vertex_count;
+	if (vertex_total == 0)
+		return;
+
+	cpu_positions.resize(vertex_total);
+	cpu_normals.resize(vertex_total);
+	for (size_t i = 0; i < count; ++i)
+		weights.deform(lattices + i * CUBE_POINT_COUNT, cpu_positions.data() + i * this->vertex_count,
+			cpu_normals.data() + i * this->vertex_count);
+
+	reserve_deformed(vertex_total);
+	deformed_positions.bind();
+	deformed_positions.update_data(reinterpret_cast<const float*>(cpu_positions.data()), vertex_total * sizeof(Vector3));
+	deformed_normals.bind();
+	deformed_normals.update_data(reinterpret_cast<const float*>(cpu_normals.data()), vertex_total * sizeof(Vector3));
+	deformed_instances = count;
+}
+
+template<GLenum MODE>
+void DeformedMesh<MODE>::render_deformed(const Camera& camera, const ScatteringParameters& parameters, int width,
+	int height, ShaderType type)
+{
+	if (!this->visible || deformed_instances == 0)
+		return;
+
+	Shader& shader = this->use_shader(type, camera, parameters, width, height);
+	// deformed vertices are in world space already
+	shader.set_m(Matrix4x4::identity());
+
+	// every instance is the mesh drawn again, its vertices vertex_count
+	// further in the buffers
+	const LodLevel& level = this->lods[this->lod];
+	const GLsizei draw_count = static_cast<GLsizei>(deformed_instances);
+	draw_counts.assign(draw_count, static_cast<GLsizei>(level.index_count));
+	draw_offsets.assign(draw_count, reinterpret_cast<const void*>(level.first_index * sizeof(GLuint)));
+	draw_base_vertices.resize(draw_count);
+	for (GLsizei i = 0; i < draw_count; ++i)
+		draw_base_vertices[i] = static_cast<GLint>(i * this->vertex_count);
+
+	deformed_vao.bind();
+	glMultiDrawElementsBaseVertex(MODE, draw_counts.data(), GL_UNSIGNED_INT, draw_offsets.data(), draw_count,
+		draw_base_vertices.data());
+	deformed_vao.unbind();
+}
+
+template<GLenum MODE>
+void DeformedMesh<MODE>::render_instances(const Camera& camera, int width, int height, const int normal_mode, const float normal_scale)
 {
-	if (!this->visible)
+	if (!this->visible || instance_count == 0)
 		return;
 
-	auto pv = camera.get_projection_matrix(width, height) * camera.get_view_matrix();
+	auto pv = camera.get_projection_view_matrix(width, height);
 
 	glEnable(GL_CULL_FACE);
 
@@ -36,13 +231,13 @@ void DeformedMesh<MODE>::render(const Camera& camera, int width, int height, con
 	shader.set_m(this->model);
 	shader.set_color(this->color.x, this->color.y, this->color.z, this->color.w);
 	shader.set_camera_position(camera.get_world_position());
-	glUniform3fv(bezier_location, CUBE_POINT_COUNT, reinterpret_cast<const float*>(bezier));
 	glUniform1i(normal_mode_location, normal_mode);
 	glUniform1f(normal_scale_location, normal_scale);
+	lattices.bind_range(GL_SHADER_STORAGE_BUFFER, LATTICE_BINDING, lattices_offset,
+		instance_count * CUBE_POINT_COUNT * sizeof(Vector4));
 
 	this->vao.bind();
-	glDrawElements(MODE, this->indices_count, GL_UNSIGNED_INT, nullptr);
-	//glDrawArrays(MODE, 0, point_count);
+	this->draw_elements_instanced(static_cast<GLsizei>(instance_count));
 	this->vao.unbind();
 }
 
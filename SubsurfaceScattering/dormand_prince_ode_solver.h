@@ -0,0 +1,188 @@
+#pragma once
+
+#include "generic_vector.h"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+// Adaptive solver for x' = f(t, x): embedded Runge-Kutta 5(4) pair of Dormand
+// and Prince. Every step estimates its local error from the difference of the
+// two orders and the step size follows it, so calm phases take long steps and
+// fast ones short steps without choosing delta by hand. The last derivative
+// of a step is the first one of the next (FSAL), an accepted step costs six
+// evaluations of f.
+//
+// Steps don't land on given times, value_at interpolates within the last step
+// with the solver's 4th order dense output, e.g. to render at frame times.
+template <class T, size_t DIM>
+class DormandPrinceODESolver {
+public:
+	using State = Vector<T, DIM>;
+	using Function = std::function<State(T, const State&)>;
+	// applied to every accepted state and interpolated value, e.g. to
+	// renormalize a quaternion
+	using Projection = std::function<void(State&)>;
+
+	struct Statistics {
+		long long evaluations = 0;
+		long long accepted_steps = 0;
+		long long rejected_steps = 0;
+	};
+
+private:
+	Function f;
+	Projection projection;
+	T start_argument;
+	State start_value;
+
+	T absolute_tolerance = T(1e-5), relative_tolerance = T(1e-5);
+	T initial_step, min_step, max_step;
+
+	// the last step went from previous_argument to argument
+	T previous_argument, argument, step;
+	State value, derivative;
+	// dense output coefficients of the last step
+	State dense[5];
+	Statistics statistics;
+
+	// error norm of the last accepted step
+	T previous_norm = T(1e-4);
+
+	// safety factor and bounds of the step size change after a step
+	static constexpr T SAFETY = T(0.9), MIN_SCALE = T(0.2), MAX_SCALE = T(5);
+	// weight of the previous error in the step size control, damps the
+	// oscillation between accepted and rejected steps
+	static constexpr T BETA = T(0.04);
+
+	State evaluate(T t, const State& x) {
+		++statistics.evaluations;
+		return f(t, x);
+	}
+
+	// root mean square of the error relative to the tolerances, accept <= 1
+	T error_norm(const State& error, const State& x0, const State& x1) const {
+		T sum = 0;
+		for (size_t i = 0; i < DIM; ++i) {
+			const T scale = absolute_tolerance + relative_tolerance * std::max(std::abs(x0[i]), std::abs(x1[i]));
+			const T e = error[i] / scale;
+			sum += e * e;
+		}
+		return std::sqrt(sum / DIM);
+	}
+
+public:
+	DormandPrinceODESolver(Function f, T start_argument, const State& start_value, T initial_step,
+		T max_step = T(INFINITY), Projection projection = {})
+		: f(std::move(f)), projection(std::move(projection)), start_argument(start_argument), start_value(start_value),
+		  initial_step(initial_step), min_step(initial_step * T(1e-6)), max_step(max_step) {
+		reset();
+	}
+
+	void set_tolerances(T absolute, T relative) {
+		absolute_tolerance = absolute;
+		relative_tolerance = relative;
+	}
+
+	State& get_start_value() { return start_value; }
+
+	void reset() {
+		previous_argument = argument = start_argument;
+		step = initial_step;
+		previous_norm = T(1e-4);
+		value = start_value;
+		if (projection)
+			projection(value);
+		derivative = evaluate(argument, value);
+		dense[0] = value;
+		for (int i = 1; i < 5; ++i)
+			dense[i] = State();
+	}
+
+	const State& current() const { return value; }
+	const State& current_derivative() const { return derivative; }
+	T current_argument() const { return argument; }
+	// step size the next step will try
+	T current_step() const { return step; }
+	const Statistics& get_statistics() const { return statistics; }
+
+	// Takes one accepted step, retrying smaller steps while the error is too
+	// large.
+	void next() {
+		const T t = argument;
+		const State& x = value;
+		const State& k1 = derivative;
+		while (true) {
+			const T h = step;
+			const State k2 = evaluate(t + h * T(1.0 / 5), State(x + (h * T(1.0 / 5)) * k1));
+			const State k3 = evaluate(t + h * T(3.0 / 10), State(x + (h * T(3.0 / 40)) * k1 + (h * T(9.0 / 40)) * k2));
+			const State k4 = evaluate(t + h * T(4.0 / 5),
+				State(x + (h * T(44.0 / 45)) * k1 - (h * T(56.0 / 15)) * k2 + (h * T(32.0 / 9)) * k3));
+			const State k5 = evaluate(t + h * T(8.0 / 9),
+				State(x + (h * T(19372.0 / 6561)) * k1 - (h * T(25360.0 / 2187)) * k2 + (h * T(64448.0 / 6561)) * k3
+					- (h * T(212.0 / 729)) * k4));
+			const State k6 = evaluate(t + h,
+				State(x + (h * T(9017.0 / 3168)) * k1 - (h * T(355.0 / 33)) * k2 + (h * T(46732.0 / 5247)) * k3
+					+ (h * T(49.0 / 176)) * k4 - (h * T(5103.0 / 18656)) * k5));
+			const State x1 = x + (h * T(35.0 / 384)) * k1 + (h * T(500.0 / 1113)) * k3 + (h * T(125.0 / 192)) * k4
+				- (h * T(2187.0 / 6784)) * k5 + (h * T(11.0 / 84)) * k6;
+			const State k7 = evaluate(t + h, x1);
+
+			// difference of the 5th and the embedded 4th order solution
+			const State error = (h * T(71.0 / 57600)) * k1 - (h * T(71.0 / 16695)) * k3 + (h * T(71.0 / 1920)) * k4
+				- (h * T(17253.0 / 339200)) * k5 + (h * T(22.0 / 525)) * k6 - (h * T(1.0 / 40)) * k7;
+			const T norm = error_norm(error, x, x1);
+			if (norm > 1 && h > min_step) {
+				++statistics.rejected_steps;
+				step = std::max(h * std::max(SAFETY * std::pow(norm, T(-0.2)), MIN_SCALE), min_step);
+				continue;
+			}
+			++statistics.accepted_steps;
+			const T scale = norm > 0
+				? std::clamp(SAFETY * std::pow(norm, BETA * T(0.75) - T(0.2)) * std::pow(previous_norm, BETA), MIN_SCALE, MAX_SCALE)
+				: MAX_SCALE;
+			previous_norm = std::max(norm, T(1e-4));
+
+			// Hairer's continuous extension of order 4
+			const State difference = x1 - x;
+			dense[0] = x;
+			dense[1] = difference;
+			dense[2] = h * k1 - difference;
+			dense[3] = difference - h * k7 - dense[2];
+			dense[4] = (h * T(-12715105075.0 / 11282082432)) * k1 + (h * T(87487479700.0 / 32700410799)) * k3
+				+ (h * T(-10690763975.0 / 1880347072)) * k4 + (h * T(701980252875.0 / 199316789632)) * k5
+				+ (h * T(-1453857185.0 / 822651844)) * k6 + (h * T(69997945.0 / 29380423)) * k7;
+
+			previous_argument = t;
+			argument = t + h;
+			step = std::clamp(h * scale, min_step, max_step);
+			value = x1;
+			derivative = k7;
+			// the derivative stays the one before the projection, which only
+			// moves the state by about the tolerance
+			if (projection)
+				projection(value);
+			return;
+		}
+	}
+
+	// Steps until the current argument reaches t, value_at(t) is then
+	// available.
+	void advance_to(T t) {
+		while (argument < t)
+			next();
+	}
+
+	// Value at t within the last step, from previous_argument to
+	// current_argument().
+	State value_at(T t) const {
+		const T h = argument - previous_argument;
+		if (h <= 0)
+			return value;
+		const T theta = std::clamp((t - previous_argument) / h, T(0), T(1));
+		const T theta1 = 1 - theta;
+		State result = dense[0] + theta * (dense[1] + theta1 * (dense[2] + theta * (dense[3] + theta1 * dense[4])));
+		if (projection)
+			projection(result);
+		return result;
+	}
+};
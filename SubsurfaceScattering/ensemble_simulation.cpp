@@ -0,0 +1,342 @@
+#include "ensemble_simulation.h"
+#include "simd_pack.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <cmath>
+#include <concepts>
+#include <type_traits>
+
+namespace {
+
+using namespace simd;
+
+// packs integrated together, so that the dependency chains of short steps
+// overlap
+constexpr size_t GROUP = 4;
+
+// every array is padded to this, enough for a group of the widest packs
+constexpr size_t PADDING = 64;
+static_assert(PADDING % (GROUP * WIDTH) == 0);
+
+// a pack integrated over all steps of a run costs about as much as a few
+// thousand members stepped once, smaller ensembles run on the calling thread
+constexpr size_t MIN_CHUNK = 256;
+
+// Grows arrays to hold member i, padding members copy fill.
+template <class T> void grow(std::vector<T> &array, size_t i, T fill) {
+	if (array.size() <= i)
+		array.resize(i / PADDING * PADDING + PADDING, fill);
+	array[i] = fill;
+}
+
+// Calls kernel(i) for the first member i of every group of size packs,
+// groups split over threads.
+template <size_t size = 1, class F> void for_each_pack(size_t count, F &&kernel) {
+	ThreadPool::shared().parallel_chunks(count, MIN_CHUNK, size * WIDTH, [&](size_t, size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i += size * WIDTH)
+			kernel(i);
+	});
+}
+
+// Adds a run's per-lane sums to the member sums, in double so that means of
+// long runs stay accurate.
+void add_sums(double *sums, Pack pack) {
+	float lanes[WIDTH];
+	store(lanes, pack);
+	for (size_t l = 0; l < WIDTH; ++l)
+		sums[l] += lanes[l];
+}
+
+EnsembleMemberStatistics statistics(float min, float max, double sum, long long steps) {
+	if (steps == 0)
+		return {};
+	return {min, max, static_cast<float>(sum / steps)};
+}
+
+} // namespace
+
+SpringEnsemble::SpringEnsemble(float delta, Forcing w, Forcing h) : delta(delta), w(std::move(w)), h(std::move(h)) {}
+
+void SpringEnsemble::add(const Member &member) {
+	const size_t i = count++;
+	grow(invm, i, 1.0f / member.m);
+	grow(c, i, member.c);
+	grow(k, i, member.k);
+	grow(x0, i, member.x0);
+	grow(v0, i, member.v0);
+	grow(x, i, member.x0);
+	grow(v, i, member.v0);
+	grow(min_x, i, member.x0);
+	grow(max_x, i, member.x0);
+	grow(sum_x, i, 0.0);
+}
+
+void SpringEnsemble::reset() {
+	time = 0.0f;
+	steps = 0;
+	x = x0;
+	v = v0;
+	min_x = x0;
+	max_x = x0;
+	std::fill(sum_x.begin(), sum_x.end(), 0.0);
+}
+
+void SpringEnsemble::run(int steps) {
+	if (steps <= 0)
+		return;
+	// the forcing is the same for every member, sampled once per step
+	w_samples.resize(steps);
+	h_samples.resize(steps);
+	for (int s = 0; s < steps; ++s) {
+		const float t = time + s * delta;
+		w_samples[s] = w ? w(t) : 0.0f;
+		h_samples[s] = h ? h(t) : 0.0f;
+	}
+
+	for_each_pack<GROUP>(count, [&](size_t first) {
+		const Pack dt = splat(delta);
+		Pack pinvm[GROUP], pc[GROUP], pk[GROUP], px[GROUP], pv[GROUP], pmin[GROUP], pmax[GROUP], psum[GROUP];
+		for (size_t g = 0; g < GROUP; ++g) {
+			const size_t i = first + g * WIDTH;
+			pinvm[g] = load(&invm[i]);
+			pc[g] = load(&c[i]);
+			pk[g] = load(&k[i]);
+			px[g] = load(&x[i]);
+			pv[g] = load(&v[i]);
+			pmin[g] = load(&min_x[i]);
+			pmax[g] = load(&max_x[i]);
+			psum[g] = splat(0.0f);
+		}
+		for (int s = 0; s < steps; ++s) {
+			const Pack pw = splat(w_samples[s]), ph = splat(h_samples[s]);
+			for (size_t g = 0; g < GROUP; ++g) {
+				// m a = c (w - x) - k v + h
+				const Pack force = madd(pc[g], sub(pw, px[g]), sub(ph, mul(pk[g], pv[g])));
+				px[g] = madd(dt, pv[g], px[g]);
+				pv[g] = madd(dt, mul(force, pinvm[g]), pv[g]);
+				pmin[g] = min(pmin[g], px[g]);
+				pmax[g] = max(pmax[g], px[g]);
+				psum[g] = simd::add(psum[g], px[g]);
+			}
+		}
+		for (size_t g = 0; g < GROUP; ++g) {
+			const size_t i = first + g * WIDTH;
+			store(&x[i], px[g]);
+			store(&v[i], pv[g]);
+			store(&min_x[i], pmin[g]);
+			store(&max_x[i], pmax[g]);
+			add_sums(&sum_x[i], psum[g]);
+		}
+	});
+	time += steps * delta;
+	this->steps += steps;
+}
+
+EnsembleMemberStatistics SpringEnsemble::get_statistics(size_t i) const {
+	return statistics(min_x[i], max_x[i], sum_x[i], steps);
+}
+
+namespace {
+
+// Scalar versions of the pack operations for SpinningTopModel, which hide
+// the ones of simd_pack.h here. With ALGEBRA_NO_SIMD those are picked for
+// floats as non-templates.
+using simd::add, simd::sub, simd::mul, simd::madd;
+template <std::floating_point T> T add(T a, T b) { return a + b; }
+template <std::floating_point T> T sub(T a, T b) { return a - b; }
+template <std::floating_point T> T mul(T a, T b) { return a * b; }
+template <std::floating_point T> T madd(T a, T b, T c) { return a * b + c; }
+
+template <class T> T constant(float a) {
+	if constexpr (std::is_floating_point_v<T>)
+		return a;
+	else
+		return splat(a);
+}
+
+// Derivative of body angular velocity and orientation quaternion (w, x, y, z)
+// for Pack in the ensemble and float or double in SpinningTopModel. gravity_torque is
+// m g d, with d the distance of the centre of mass from the corner.
+template <class T>
+void top_derivative(const T (&inertia)[3], const T (&inv_inertia)[3], T gravity_torque, const T (&s)[7],
+					T (&d)[7]) {
+	const T &wx = s[0], &wy = s[1], &wz = s[2], &qw = s[3], &qx = s[4], &qy = s[5], &qz = s[6];
+	const T zero = constant<T>(0.0f), minus_two = constant<T>(-2.0f), half = constant<T>(0.5f);
+	// world down in the body frame, -(row y of the rotation matrix)
+	const T down_x = mul(minus_two, madd(qx, qy, mul(qw, qz)));
+	const T down_z = mul(minus_two, sub(mul(qy, qz), mul(qw, qx)));
+	// torque of gravity at (0, d, 0): d x F
+	const T nx = mul(gravity_torque, down_z);
+	const T nz = sub(zero, mul(gravity_torque, down_x));
+
+	// Euler's equations, I w' = N + (I w) x w
+	const T lx = mul(inertia[0], wx), ly = mul(inertia[1], wy), lz = mul(inertia[2], wz);
+	d[0] = mul(inv_inertia[0], add(nx, sub(mul(ly, wz), mul(lz, wy))));
+	d[1] = mul(inv_inertia[1], sub(mul(lz, wx), mul(lx, wz)));
+	d[2] = mul(inv_inertia[2], add(nz, sub(mul(lx, wy), mul(ly, wx))));
+
+	// q' = q (0, w) / 2
+	d[3] = mul(half, sub(zero, madd(qx, wx, madd(qy, wy, mul(qz, wz)))));
+	d[4] = mul(half, madd(qw, wx, sub(mul(qy, wz), mul(qz, wy))));
+	d[5] = mul(half, madd(qw, wy, sub(mul(qz, wx), mul(qx, wz))));
+	d[6] = mul(half, madd(qw, wz, sub(mul(qx, wy), mul(qy, wx))));
+}
+
+struct TopState {
+	// body angular velocity, orientation quaternion
+	Pack c[7];
+};
+
+struct TopParameters {
+	Pack inertia[3], inv_inertia[3];
+	Pack gravity_torque;
+};
+
+inline TopState add_states(const TopState &x, const TopState &y) {
+	TopState r;
+	for (int i = 0; i < 7; ++i)
+		r.c[i] = add(x.c[i], y.c[i]);
+	return r;
+}
+
+inline TopState axpy(Pack a, const TopState &x, const TopState &y) {
+	TopState r;
+	for (int i = 0; i < 7; ++i)
+		r.c[i] = madd(a, x.c[i], y.c[i]);
+	return r;
+}
+
+TopState derivative(const TopParameters &p, const TopState &s) {
+	TopState d;
+	top_derivative(p.inertia, p.inv_inertia, p.gravity_torque, s.c, d.c);
+	return d;
+}
+
+} // namespace
+
+namespace {
+template <class T> Vector<T, 7> model_derivative(const SpinningTopModel &model, const Vector<T, 7> &state) {
+	T inertia[3], inv_inertia[3], s[7], d[7];
+	for (int axis = 0; axis < 3; ++axis) {
+		inertia[axis] = model.inertia[axis];
+		inv_inertia[axis] = T(1) / inertia[axis];
+	}
+	for (int i = 0; i < 7; ++i)
+		s[i] = state[i];
+	top_derivative(inertia, inv_inertia, T(model.gravity_torque), s, d);
+	return {d[0], d[1], d[2], d[3], d[4], d[5], d[6]};
+}
+} // namespace
+
+SpinningTopModel::State SpinningTopModel::derivative(const State &state) const {
+	return model_derivative(*this, state);
+}
+
+Vector<double, 7> SpinningTopModel::derivative(const Vector<double, 7> &state) const {
+	return model_derivative(*this, state);
+}
+
+SpinningTopEnsemble::SpinningTopEnsemble(float delta, const float (&unit_inv_inertia)[3], bool gravity_present)
+	: delta(delta), gravity_present(gravity_present),
+	  unit_inv_inertia{unit_inv_inertia[0], unit_inv_inertia[1], unit_inv_inertia[2]} {}
+
+void SpinningTopEnsemble::add(const Member &member) {
+	const size_t i = count++;
+	members.push_back(member);
+	const float a = member.cube_dim;
+	const float mass = member.cube_density * a * a * a;
+	for (int axis = 0; axis < 3; ++axis) {
+		grow(inv_inertia[axis], i, unit_inv_inertia[axis] / (mass * a * a));
+		grow(inertia[axis], i, mass * a * a / unit_inv_inertia[axis]);
+	}
+	grow(half_diagonal, i, a * std::sqrt(3.0f) / 2.0f);
+	grow(gravity_torque, i, gravity_present ? mass * GRAVITY * half_diagonal[i] : 0.0f);
+	for (auto &component : state)
+		grow(component, i, 0.0f);
+	grow(min_h, i, 0.0f);
+	grow(max_h, i, 0.0f);
+	grow(sum_h, i, 0.0);
+	// padding members get a valid orientation, so renormalization stays finite
+	std::fill(state[3].begin() + count, state[3].end(), 1.0f);
+	reset_member(i);
+}
+
+void SpinningTopEnsemble::reset_member(size_t i) {
+	// spinning about the diagonal, tilted about z
+	const auto &member = members[i];
+	const float angle = member.initial_z_rotation_deg * PI / 180.0f;
+	state[0][i] = 0.0f;
+	state[1][i] = member.angular_velocity_deg * PI / 180.0f;
+	state[2][i] = 0.0f;
+	state[3][i] = std::cos(angle / 2.0f);
+	state[4][i] = 0.0f;
+	state[5][i] = 0.0f;
+	state[6][i] = std::sin(angle / 2.0f);
+	min_h[i] = max_h[i] = half_diagonal[i] * std::cos(angle);
+	sum_h[i] = 0.0;
+}
+
+void SpinningTopEnsemble::reset() {
+	time = 0.0f;
+	steps = 0;
+	for (size_t i = 0; i < count; ++i)
+		reset_member(i);
+}
+
+void SpinningTopEnsemble::run(int steps) {
+	if (steps <= 0)
+		return;
+	for_each_pack(count, [&](size_t i) {
+		TopParameters p;
+		for (int axis = 0; axis < 3; ++axis) {
+			p.inertia[axis] = load(&inertia[axis][i]);
+			p.inv_inertia[axis] = load(&inv_inertia[axis][i]);
+		}
+		p.gravity_torque = load(&gravity_torque[i]);
+		const Pack d = load(&half_diagonal[i]);
+		const Pack dt = splat(delta), half_dt = splat(delta / 2.0f), sixth_dt = splat(delta / 6.0f), two = splat(2.0f);
+
+		TopState s;
+		for (int c = 0; c < 7; ++c)
+			s.c[c] = load(&state[c][i]);
+		Pack pmin = load(&min_h[i]), pmax = load(&max_h[i]), psum = splat(0.0f);
+		for (int step = 0; step < steps; ++step) {
+			const TopState k1 = derivative(p, s);
+			const TopState k2 = derivative(p, axpy(half_dt, k1, s));
+			const TopState k3 = derivative(p, axpy(half_dt, k2, s));
+			const TopState k4 = derivative(p, axpy(dt, k3, s));
+			// k1 + 2 k2 + 2 k3 + k4
+			const TopState sum = axpy(two, add_states(k2, k3), add_states(k1, k4));
+			s = axpy(sixth_dt, sum, s);
+
+			Pack &qw = s.c[3], &qx = s.c[4], &qy = s.c[5], &qz = s.c[6];
+			const Pack inv_length = rsqrt(madd(qw, qw, madd(qx, qx, madd(qy, qy, mul(qz, qz)))));
+			qw = mul(qw, inv_length);
+			qx = mul(qx, inv_length);
+			qy = mul(qy, inv_length);
+			qz = mul(qz, inv_length);
+
+			// centre of mass height, d times the world y of the body y axis
+			const Pack up = sub(splat(1.0f), mul(two, madd(qx, qx, mul(qz, qz))));
+			const Pack height = mul(d, up);
+			pmin = min(pmin, height);
+			pmax = max(pmax, height);
+			psum = simd::add(psum, height);
+		}
+		for (int c = 0; c < 7; ++c)
+			store(&state[c][i], s.c[c]);
+		store(&min_h[i], pmin);
+		store(&max_h[i], pmax);
+		add_sums(&sum_h[i], psum);
+	});
+	time += steps * delta;
+	this->steps += steps;
+}
+
+SpinningTopModel SpinningTopEnsemble::get_model(size_t i) const {
+	return {{inertia[0][i], inertia[1][i], inertia[2][i]}, gravity_torque[i]};
+}
+
+EnsembleMemberStatistics SpinningTopEnsemble::get_statistics(size_t i) const {
+	return statistics(min_h[i], max_h[i], sum_h[i], steps);
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include "generic_vector.h"
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+// Ensembles step many independent variants of a simulation in lockstep, for
+// parameter studies. Member states are kept as structure of arrays and
+// integrated a SIMD pack of members at a time (AVX-512, AVX or SSE, whatever
+// the target has), each pack staying in registers for all steps of run().
+// Large ensembles are split into chunks integrated on all hardware threads.
+
+// Statistics of a member's observable over all steps since reset().
+struct EnsembleMemberStatistics {
+	float min = 0.0f;
+	float max = 0.0f;
+	float mean = 0.0f;
+};
+
+// Variants of SpringSimulation: explicit Euler on (x, v) with
+// m v' = c (w(t) - x) - k v + h(t), the observable is x.
+class SpringEnsemble {
+  public:
+	struct Member {
+		float m = 1.0f, c = 1.0f, k = 2.0f;
+		float x0 = 0.0f, v0 = 0.0f;
+	};
+
+	// w and h are shared by all members, sampled once per step
+	using Forcing = std::function<float(float)>;
+
+  private:
+	float delta;
+	Forcing w, h;
+	float time = 0.0f;
+	long long steps = 0;
+	size_t count = 0;
+	// padded to whole packs
+	std::vector<float> invm, c, k, x0, v0, x, v, min_x, max_x;
+	std::vector<double> sum_x;
+	std::vector<float> w_samples, h_samples;
+
+  public:
+	explicit SpringEnsemble(float delta = 0.005f, Forcing w = {}, Forcing h = {});
+
+	void add(const Member &member);
+	size_t size() const { return count; }
+	float get_time() const { return time; }
+
+	// Puts every member back at its start state and clears the statistics.
+	void reset();
+	void run(int steps);
+
+	float get_position(size_t i) const { return x[i]; }
+	float get_velocity(size_t i) const { return v[i]; }
+	EnsembleMemberStatistics get_statistics(size_t i) const;
+};
+
+// Equations of motion integrated by SpinningTopEnsemble, evaluated for a
+// single state. Runs the same code as the ensemble's SIMD kernel, on floats
+// instead of packs, as the reference to check and time it against.
+struct SpinningTopModel {
+	// body angular velocity (3) and orientation quaternion w, x, y, z (4)
+	using State = Vector<float, 7>;
+
+	// about the axes through the corner
+	float inertia[3];
+	// m g d, with d the distance of the centre of mass from the corner
+	float gravity_torque;
+
+	State derivative(const State &state) const;
+	// in double precision, as a reference for float integrators
+	Vector<double, 7> derivative(const Vector<double, 7> &state) const;
+};
+
+// Variants of SpinningTopSimulation: RK4 on the body angular velocity and the
+// orientation quaternion of a cube spinning about its fixed corner, with the
+// quaternion renormalized after every step. The body y axis is the diagonal
+// through the corner, the observable is the height of the centre of mass
+// above the corner.
+class SpinningTopEnsemble {
+  public:
+	struct Member {
+		float angular_velocity_deg = 180.0f;
+		float initial_z_rotation_deg = 30.0f;
+		float cube_dim = 1.0f;
+		float cube_density = 1.0f;
+	};
+
+	static constexpr float GRAVITY = 9.81f;
+
+  private:
+	float delta;
+	bool gravity_present;
+	// of a unit cube with unit mass, about the axes through the corner
+	float unit_inv_inertia[3];
+	float time = 0.0f;
+	long long steps = 0;
+	size_t count = 0;
+	std::vector<Member> members;
+	// padded to whole packs
+	std::vector<float> inertia[3], inv_inertia[3], gravity_torque, half_diagonal;
+	std::vector<float> state[7], min_h, max_h;
+	std::vector<double> sum_h;
+
+	void reset_member(size_t i);
+
+  public:
+	// unit_inv_inertia as SpinningTopSimulation::initial_inv_inertia
+	SpinningTopEnsemble(float delta, const float (&unit_inv_inertia)[3], bool gravity_present = true);
+
+	void add(const Member &member);
+	size_t size() const { return count; }
+	float get_time() const { return time; }
+
+	void reset();
+	void run(int steps);
+
+	// angular velocity (3) and quaternion w, x, y, z (4), as in
+	// SpinningTopSimulation::get_current_state
+	float get_state(size_t i, int component) const { return state[component][i]; }
+	SpinningTopModel get_model(size_t i) const;
+	EnsembleMemberStatistics get_statistics(size_t i) const;
+};
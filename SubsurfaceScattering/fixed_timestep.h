@@ -0,0 +1,95 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+
+// Turns elapsed real time into a whole number of fixed simulation steps.
+// Time left over is kept for the next update, its fraction of a step is the
+// interpolation alpha between the last two states. When the simulation can't
+// keep up, at most max_catch_up steps are run per update and the rest of the
+// backlog is dropped instead of growing forever.
+class FixedTimestep {
+	using Clock = std::chrono::steady_clock;
+
+	double step;
+	int max_catch_up;
+	// less than a step, the fraction of the next one
+	double accumulator = 0.0;
+	// steps returned by update() and given back, due at the next update
+	int backlog = 0;
+	Clock::time_point previous_time = Clock::now();
+
+	// steps per second, measured over windows of at least STATS_WINDOW
+	static constexpr double STATS_WINDOW = 0.5;
+	double window_time = 0.0;
+	long long window_steps = 0;
+	double measured_rate = 0.0;
+	long long dropped = 0;
+
+public:
+	// step <= 0 runs one step per update, as fast as updates come
+	FixedTimestep(double step, int max_catch_up = 8) : step(step), max_catch_up(std::max(max_catch_up, 1)) {}
+
+	void set_step(double step) { this->step = step; }
+	double get_step() const { return step; }
+
+	// Forgets the time since the last update, e.g. after the task was paused.
+	void restart() {
+		accumulator = 0.0;
+		backlog = 0;
+		previous_time = Clock::now();
+	}
+
+	// Number of steps to run for the real time elapsed since the last update.
+	int update() {
+		const auto time = Clock::now();
+		const double elapsed = std::chrono::duration<double>(time - previous_time).count();
+		previous_time = time;
+		return update(elapsed);
+	}
+
+	int update(double elapsed) {
+		// the window closes before this update's steps, so that steps given
+		// back are taken off the window they were counted in
+		window_time += elapsed;
+		if (window_time >= STATS_WINDOW) {
+			measured_rate = window_steps / window_time;
+			window_time = 0.0;
+			window_steps = 0;
+		}
+
+		int steps = 1;
+		if (step > 0.0) {
+			accumulator += elapsed;
+			const int due = static_cast<int>(accumulator / step);
+			accumulator = std::max(accumulator - due * step, 0.0);
+			steps = backlog + due;
+			backlog = 0;
+			if (steps > max_catch_up) {
+				dropped += steps - max_catch_up;
+				steps = max_catch_up;
+			}
+		}
+		window_steps += steps;
+		return steps;
+	}
+
+	// Puts back steps returned by update() that weren't run, they are due
+	// again at the next update and don't count as run.
+	void give_back(int steps) {
+		backlog += steps;
+		window_steps -= steps;
+	}
+
+	// How far the current time is between the last state and the next one,
+	// in [0, 1).
+	float get_alpha() const { return step > 0.0 ? static_cast<float>(accumulator / step) : 0.0f; }
+
+	// Real time until the next step is due, 0 with steps given back.
+	double get_time_to_next_step() const { return backlog > 0 ? 0.0 : std::max(step - accumulator, 0.0); }
+
+	double get_target_rate() const { return step > 0.0 ? 1.0 / step : 0.0; }
+	double get_measured_rate() const { return measured_rate; }
+	// steps skipped because the simulation fell too far behind
+	long long get_dropped_steps() const { return dropped; }
+};
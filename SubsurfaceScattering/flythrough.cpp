@@ -0,0 +1,445 @@
+#include "flythrough.h"
+#include "gl_application.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+// GL_NVX_gpu_memory_info and GL_ATI_meminfo, not part of the loaded GL headers
+constexpr GLenum GPU_MEMORY_INFO_TOTAL_AVAILABLE_MEMORY_NVX = 0x9048;
+constexpr GLenum GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX = 0x9049;
+constexpr GLenum TEXTURE_FREE_MEMORY_ATI = 0x87FC;
+
+const char *PASS_NAMES[] = {"diffuse", "depth_map", "scene"};
+static_assert(sizeof(PASS_NAMES) / sizeof(PASS_NAMES[0]) == static_cast<size_t>(FramePass::COUNT),
+			  "Every FramePass needs a name");
+
+// Calls f(name, field_of_a, field_of_b) for every recorded parameter.
+template <class F> void for_each_parameter(ScatteringParameters &a, ScatteringParameters &b, F &&f) {
+	f("light.position", a.light.position, b.light.position);
+	f("light.color", a.light.color, b.light.color);
+	f("light.ambient", a.light.ambient, b.light.ambient);
+	f("light.diffuse", a.light.diffuse, b.light.diffuse);
+	f("light.specular", a.light.specular, b.light.specular);
+	f("light.m", a.light.m, b.light.m);
+	f("rendered_mesh_idx", a.rendered_mesh_idx, b.rendered_mesh_idx);
+	f("wrap", a.wrap, b.wrap);
+	f("scatter_width", a.scatter_width, b.scatter_width);
+	f("scatter_power", a.scatter_power, b.scatter_power);
+	f("scatter_color", a.scatter_color, b.scatter_color);
+	f("scatter_falloff", a.scatter_falloff, b.scatter_falloff);
+	f("angle_scatter", a.angle_scatter, b.angle_scatter);
+	f("translucency", a.translucency, b.translucency);
+	f("sigma_t", a.sigma_t, b.sigma_t);
+	f("grow", a.grow, b.grow);
+	f("diffuse_blur", a.diffuse_blur, b.diffuse_blur);
+	f("visibility_culling", a.visibility_culling, b.visibility_culling);
+	f("amortised_diffuse", a.amortised_diffuse, b.amortised_diffuse);
+	f("diffuse_budget_ms", a.diffuse_budget_ms, b.diffuse_budget_ms);
+	f("diffuse_blend", a.diffuse_blend, b.diffuse_blend);
+	f("diffuse_invalidate_threshold", a.diffuse_invalidate_threshold, b.diffuse_invalidate_threshold);
+	f("use_lods", a.use_lods, b.use_lods);
+	f("lod_error_pixels", a.lod_error_pixels, b.lod_error_pixels);
+	f("depth_map_lod_error_pixels", a.depth_map_lod_error_pixels, b.depth_map_lod_error_pixels);
+}
+
+template <class T> bool equal(const T &a, const T &b) { return a == b; }
+bool equal(const Vector3 &a, const Vector3 &b) { return a.x == b.x && a.y == b.y && a.z == b.z; }
+
+template <class T> void write_value(std::ostream &s, const T &value) { s << value; }
+void write_value(std::ostream &s, const bool &value) { s << (value ? 1 : 0); }
+void write_value(std::ostream &s, const Vector3 &value) { s << value.x << ' ' << value.y << ' ' << value.z; }
+
+template <class T> void read_value(std::istream &s, T &value) { s >> value; }
+void read_value(std::istream &s, bool &value) {
+	int i;
+	s >> i;
+	value = i != 0;
+}
+void read_value(std::istream &s, Vector3 &value) { s >> value.x >> value.y >> value.z; }
+
+bool has_extension(const char *name) {
+	GLint count = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+	for (GLint i = 0; i < count; ++i)
+		if (std::strcmp(reinterpret_cast<const char *>(glGetStringi(GL_EXTENSIONS, i)), name) == 0)
+			return true;
+	return false;
+}
+
+// in kilobytes, -1 if the driver doesn't tell
+long long gpu_memory_total() {
+	if (!has_extension("GL_NVX_gpu_memory_info"))
+		return -1;
+	GLint kb = 0;
+	glGetIntegerv(GPU_MEMORY_INFO_TOTAL_AVAILABLE_MEMORY_NVX, &kb);
+	return kb;
+}
+
+long long gpu_memory_available() {
+	GLint kb[4] = {-1, -1, -1, -1};
+	if (has_extension("GL_NVX_gpu_memory_info"))
+		glGetIntegerv(GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX, kb);
+	else if (has_extension("GL_ATI_meminfo"))
+		glGetIntegerv(TEXTURE_FREE_MEMORY_ATI, kb);
+	return kb[0];
+}
+
+std::string json_escape(const std::string &text) {
+	std::string res;
+	for (char c : text) {
+		if (c == '"' || c == '\\')
+			res += '\\';
+		if (static_cast<unsigned char>(c) >= 0x20)
+			res += c;
+	}
+	return res;
+}
+
+// Writes mean, percentiles and extremes of values without the first skip ones.
+void write_summary(FILE *file, std::vector<float> values, size_t skip) {
+	if (values.size() > 2 * skip)
+		values.erase(values.begin(), values.begin() + skip);
+	if (values.empty()) {
+		fprintf(file, "null");
+		return;
+	}
+	std::sort(values.begin(), values.end());
+	double sum = 0.0, sum_sq = 0.0;
+	for (float v : values) {
+		sum += v;
+		sum_sq += double(v) * v;
+	}
+	const double mean = sum / values.size();
+	const double stddev = std::sqrt(std::max(0.0, sum_sq / values.size() - mean * mean));
+	const auto percentile = [&values](double p) { return values[std::min(values.size() - 1, size_t(p * values.size()))]; };
+	fprintf(file,
+			"{\"samples\": %zu, \"mean\": %.4f, \"stddev\": %.4f, \"min\": %.4f, \"median\": %.4f, "
+			"\"p90\": %.4f, \"p99\": %.4f, \"max\": %.4f}",
+			values.size(), mean, stddev, values.front(), percentile(0.5), percentile(0.9), percentile(0.99),
+			values.back());
+}
+
+} // namespace
+
+FlythroughScript FlythroughScript::load(const char *filename) {
+	std::ifstream s(filename);
+	if (!s.good())
+		throw std::invalid_argument("Couldn't open file");
+
+	FlythroughScript script;
+	std::string line;
+	int line_number = 0;
+	const auto error = [&](const char *message) {
+		return std::runtime_error(std::string(filename) + ":" + std::to_string(line_number) + ": " + message);
+	};
+
+	while (std::getline(s, line)) {
+		++line_number;
+		std::istringstream ls(line);
+		std::string keyword;
+		if (!(ls >> keyword) || keyword[0] == '#')
+			continue;
+
+		if (keyword == "frame") {
+			FlythroughFrame frame;
+			if (!(ls >> frame.time))
+				throw error("expected frame time");
+			script.frames.push_back(std::move(frame));
+			continue;
+		}
+		if (script.frames.empty())
+			throw error("event before the first frame");
+
+		if (keyword == "repeat") {
+			int count;
+			if (!(ls >> count) || count < 0)
+				throw error("expected repeat count");
+			const FlythroughFrame last = script.frames.back();
+			const float interval = script.frames.size() > 1
+									   ? last.time - script.frames[script.frames.size() - 2].time
+									   : 1.0f / 60.0f;
+			for (int i = 1; i <= count; ++i)
+				script.frames.push_back({last.time + i * interval, last.events});
+			continue;
+		}
+
+		FlythroughEvent event;
+		if (keyword == "move_by" || keyword == "rotate") {
+			event.type = keyword == "move_by" ? FlythroughEvent::Type::MoveBy : FlythroughEvent::Type::Rotate;
+			if (!(ls >> event.value.x >> event.value.y >> event.value.z))
+				throw error("expected three numbers");
+		} else if (keyword == "zoom") {
+			event.type = FlythroughEvent::Type::Zoom;
+			if (!(ls >> event.value.x))
+				throw error("expected zoom factor");
+		} else if (keyword == "set") {
+			event.type = FlythroughEvent::Type::Set;
+			if (!(ls >> event.parameter))
+				throw error("expected parameter name");
+			std::getline(ls >> std::ws, event.parameter_value);
+			bool known = false;
+			ScatteringParameters p;
+			for_each_parameter(p, p, [&](const char *name, auto &, auto &) { known |= event.parameter == name; });
+			if (!known)
+				throw error("unknown parameter");
+		} else {
+			throw error("unknown event");
+		}
+		script.frames.back().events.push_back(std::move(event));
+	}
+	return script;
+}
+
+void FlythroughScript::save(const char *filename) const {
+	std::ofstream s(filename);
+	if (!s.good())
+		throw std::invalid_argument("Couldn't open file");
+
+	// enough digits to replay exactly what was recorded
+	s << std::setprecision(9);
+	for (const auto &frame : frames) {
+		s << "frame " << frame.time << '\n';
+		for (const auto &event : frame.events) {
+			switch (event.type) {
+			case FlythroughEvent::Type::MoveBy:
+				s << "move_by " << event.value.x << ' ' << event.value.y << ' ' << event.value.z << '\n';
+				break;
+			case FlythroughEvent::Type::Zoom:
+				s << "zoom " << event.value.x << '\n';
+				break;
+			case FlythroughEvent::Type::Rotate:
+				s << "rotate " << event.value.x << ' ' << event.value.y << ' ' << event.value.z << '\n';
+				break;
+			case FlythroughEvent::Type::Set:
+				s << "set " << event.parameter << ' ' << event.parameter_value << '\n';
+				break;
+			}
+		}
+	}
+}
+
+Flythrough::Flythrough(ScatteringParameters &parameters) : parameters(parameters) { pass_timer.init(); }
+
+Flythrough::~Flythrough() { pass_timer.dispose(); }
+
+void Flythrough::start_recording() {
+	if (mode != Mode::Idle)
+		return;
+	mode = Mode::Recording;
+	restart_pending = true;
+	recording = {};
+	status = "Recording";
+}
+
+void Flythrough::stop_recording(const char *filename) {
+	if (mode != Mode::Recording)
+		return;
+	mode = Mode::Idle;
+	if (!deferred_camera_events.empty())
+		recording.frames.push_back({recording.frames.empty() ? 0.0f : recording.frames.back().time,
+									std::move(deferred_camera_events)});
+	try {
+		recording.save(filename);
+		status = "Saved " + std::to_string(recording.frames.size()) + " frames to " + filename;
+	} catch (const std::exception &e) {
+		status = std::string("Couldn't save recording: ") + e.what();
+	}
+}
+
+void Flythrough::start_replay(const char *script_file, const char *output, int frame_count, bool exit_when_done) {
+	if (mode != Mode::Idle)
+		return;
+	this->exit_when_done = exit_when_done;
+	try {
+		script = FlythroughScript::load(script_file);
+		if (script.frames.empty())
+			throw std::runtime_error("script has no frames");
+	} catch (const std::exception &e) {
+		status = std::string("Couldn't load script: ") + e.what();
+		fprintf(stderr, "%s\n", status.c_str());
+		if (exit_when_done)
+			glfwSetWindowShouldClose(glfwGetCurrentContext(), GLFW_TRUE);
+		return;
+	}
+
+	script_name = script_file;
+	output_name = output;
+	this->frame_count = frame_count > 0 ? frame_count : static_cast<int>(script.frames.size());
+	frame = 0;
+	frame_times.clear();
+	for (auto &times : pass_times)
+		times.clear();
+	mode = Mode::Replaying;
+	restart_pending = true;
+	status = "Replaying " + script_name;
+
+	glfwSwapInterval(0);
+}
+
+void Flythrough::begin_frame(Camera &camera) {
+	if (restart_pending) {
+		restart_pending = false;
+		camera = Camera();
+		if (mode == Mode::Replaying) {
+			parameters = ScatteringParameters();
+			gpu_memory_available_start = gpu_memory_available();
+		} else {
+			// the first recorded frame sets everything that isn't default
+			recorded_parameters = ScatteringParameters();
+			camera_events.clear();
+			deferred_camera_events.clear();
+			recording_start = Clock::now();
+		}
+	}
+
+	if (mode == Mode::Replaying) {
+		for (const auto &event : script.frames[frame % script.frames.size()].events)
+			apply(event, camera);
+	}
+}
+
+void Flythrough::end_frame(int width, int height) {
+	const auto now = Clock::now();
+
+	if (mode == Mode::Recording) {
+		FlythroughFrame finished;
+		finished.time = std::chrono::duration<float>(now - recording_start).count();
+		finished.events = std::move(deferred_camera_events);
+		record_parameter_changes(finished.events);
+		recording.frames.push_back(std::move(finished));
+		deferred_camera_events = std::move(camera_events);
+		camera_events.clear();
+	} else if (mode == Mode::Replaying) {
+		if (frame > 0)
+			frame_times.push_back(std::chrono::duration<float, std::milli>(now - last_frame_end).count());
+		last_frame_end = now;
+		this->width = width;
+		this->height = height;
+		pass_timer.end_frame([this](size_t pass, float ms) { pass_times[pass].push_back(ms); });
+		if (++frame >= frame_count)
+			finish_replay();
+	}
+}
+
+void Flythrough::move_by(Camera &camera, const Vector3 &vec) {
+	if (mode == Mode::Replaying)
+		return;
+	camera.move_by(vec);
+	record({FlythroughEvent::Type::MoveBy, vec});
+}
+
+void Flythrough::zoom(Camera &camera, float factor) {
+	if (mode == Mode::Replaying)
+		return;
+	camera.zoom(factor);
+	record({FlythroughEvent::Type::Zoom, {factor, 0.0f, 0.0f}});
+}
+
+void Flythrough::rotate(Camera &camera, float ang_x, float ang_y, float ang_z) {
+	if (mode == Mode::Replaying)
+		return;
+	camera.rotate(ang_x, ang_y, ang_z);
+	record({FlythroughEvent::Type::Rotate, {ang_x, ang_y, ang_z}});
+}
+
+void Flythrough::begin_pass(FramePass pass) {
+	if (mode == Mode::Replaying)
+		pass_timer.begin(static_cast<size_t>(pass));
+}
+
+void Flythrough::end_pass(FramePass pass) {
+	if (mode == Mode::Replaying)
+		pass_timer.end(static_cast<size_t>(pass));
+}
+
+void Flythrough::record(const FlythroughEvent &event) {
+	if (mode == Mode::Recording)
+		camera_events.push_back(event);
+}
+
+void Flythrough::record_parameter_changes(std::vector<FlythroughEvent> &events) {
+	// the parameters window is built after the view, so a change is first
+	// drawn in the frame after it was made, which is when it gets detected
+	for_each_parameter(parameters, recorded_parameters, [&events](const char *name, auto &value, auto &recorded) {
+		if (equal(value, recorded))
+			return;
+		recorded = value;
+		std::ostringstream s;
+		s << std::setprecision(9);
+		write_value(s, value);
+		FlythroughEvent event{FlythroughEvent::Type::Set};
+		event.parameter = name;
+		event.parameter_value = s.str();
+		events.push_back(std::move(event));
+	});
+}
+
+void Flythrough::apply(const FlythroughEvent &event, Camera &camera) {
+	switch (event.type) {
+	case FlythroughEvent::Type::MoveBy:
+		camera.move_by(event.value);
+		break;
+	case FlythroughEvent::Type::Zoom:
+		camera.zoom(event.value.x);
+		break;
+	case FlythroughEvent::Type::Rotate:
+		camera.rotate(event.value.x, event.value.y, event.value.z);
+		break;
+	case FlythroughEvent::Type::Set:
+		for_each_parameter(parameters, parameters, [&event](const char *name, auto &value, auto &) {
+			if (event.parameter != name)
+				return;
+			std::istringstream s(event.parameter_value);
+			read_value(s, value);
+		});
+		break;
+	}
+}
+
+void Flythrough::finish_replay() {
+	pass_timer.flush([this](size_t pass, float ms) { pass_times[pass].push_back(ms); });
+	glfwSwapInterval(ENABLE_VSYNC ? 1 : 0);
+	mode = Mode::Idle;
+
+	write_report();
+	status = "Replay of " + script_name + " written to " + output_name;
+	fprintf(stderr, "%s\n", status.c_str());
+	if (exit_when_done)
+		glfwSetWindowShouldClose(glfwGetCurrentContext(), GLFW_TRUE);
+}
+
+void Flythrough::write_report() const {
+	FILE *file = fopen(output_name.c_str(), "w");
+	if (!file) {
+		fprintf(stderr, "Couldn't open %s\n", output_name.c_str());
+		return;
+	}
+
+	const auto *renderer = reinterpret_cast<const char *>(glGetString(GL_RENDERER));
+	fprintf(file, "{\n");
+	fprintf(file, "  \"script\": \"%s\",\n", json_escape(script_name).c_str());
+	fprintf(file, "  \"renderer\": \"%s\",\n", json_escape(renderer ? renderer : "").c_str());
+	fprintf(file, "  \"frames\": %d,\n", frame_count);
+	fprintf(file, "  \"warmup_frames\": %d,\n", WARMUP_FRAMES);
+	fprintf(file, "  \"viewport\": [%d, %d],\n", width, height);
+	fprintf(file, "  \"frame_time_ms\": ");
+	write_summary(file, frame_times, WARMUP_FRAMES);
+	fprintf(file, ",\n  \"passes_ms\": {\n");
+	for (size_t pass = 0; pass < static_cast<size_t>(FramePass::COUNT); ++pass) {
+		fprintf(file, "    \"%s\": ", PASS_NAMES[pass]);
+		write_summary(file, pass_times[pass], WARMUP_FRAMES);
+		fprintf(file, pass + 1 < static_cast<size_t>(FramePass::COUNT) ? ",\n" : "\n");
+	}
+	fprintf(file, "  },\n");
+	fprintf(file, "  \"gpu_memory_kb\": {\"total\": %lld, \"available_start\": %lld, \"available_end\": %lld}\n",
+			gpu_memory_total(), gpu_memory_available_start, gpu_memory_available());
+	fprintf(file, "}\n");
+	fclose(file);
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "camera.h"
+#include "gpu_timer.h"
+#include "scattering_parameters.h"
+#include <chrono>
+#include <string>
+#include <vector>
+
+// Text script of a recorded session. Every frame starts with a
+// "frame <seconds>" line followed by its events, one per line:
+//   move_by <x> <y> <z>
+//   zoom <factor>
+//   rotate <x> <y> <z>
+//   set <parameter> <values...>
+//   repeat <count>      (repeats the events of the previous frame)
+// Lines starting with # are comments. Replays start from a default Camera
+// and default ScatteringParameters.
+struct FlythroughEvent {
+	enum class Type { MoveBy, Zoom, Rotate, Set };
+
+	Type type;
+	Vector3 value = {0.0f, 0.0f, 0.0f};
+	std::string parameter = {}, parameter_value = {};
+};
+
+struct FlythroughFrame {
+	float time = 0.0f;
+	std::vector<FlythroughEvent> events;
+};
+
+class FlythroughScript {
+  public:
+	std::vector<FlythroughFrame> frames;
+
+	static FlythroughScript load(const char *filename);
+	void save(const char *filename) const;
+};
+
+enum class FramePass { Diffuse, DepthMap, Scene, COUNT };
+
+// Records camera moves and parameter changes made in the view, or replays a
+// script with vsync off and writes frame statistics as JSON.
+class Flythrough {
+  public:
+	enum class Mode { Idle, Recording, Replaying };
+
+	// first frames of a replay, left out of the statistics unless the replay
+	// is too short to afford it
+	static constexpr int WARMUP_FRAMES = 10;
+
+	explicit Flythrough(ScatteringParameters &parameters);
+	~Flythrough();
+
+	void start_recording();
+	void stop_recording(const char *filename);
+	// frame_count of 0 replays the script once, larger values loop it
+	void start_replay(const char *script, const char *output, int frame_count = 0,
+					  bool exit_when_done = false);
+
+	Mode get_mode() const { return mode; }
+	int get_frame() const { return frame; }
+	int get_frame_count() const { return frame_count; }
+	const std::string &get_status() const { return status; }
+
+	// Called by the view at the start and end of every frame.
+	void begin_frame(Camera &camera);
+	void end_frame(int width, int height);
+
+	// Camera input from the view goes through these, so it can be recorded.
+	// Input is ignored while replaying.
+	void move_by(Camera &camera, const Vector3 &vec);
+	void zoom(Camera &camera, float factor);
+	void rotate(Camera &camera, float ang_x, float ang_y, float ang_z);
+
+	void begin_pass(FramePass pass);
+	void end_pass(FramePass pass);
+
+  private:
+	using Clock = std::chrono::steady_clock;
+
+	ScatteringParameters &parameters;
+	Mode mode = Mode::Idle;
+	bool restart_pending = false;
+	std::string status;
+
+	// recording
+	FlythroughScript recording;
+	// camera input is handled after the view is drawn, so it is replayed at
+	// the start of the next frame
+	std::vector<FlythroughEvent> camera_events, deferred_camera_events;
+	ScatteringParameters recorded_parameters;
+	Clock::time_point recording_start;
+
+	// replay
+	FlythroughScript script;
+	std::string script_name, output_name;
+	bool exit_when_done = false;
+	int frame = 0, frame_count = 0;
+	int width = 0, height = 0;
+	Clock::time_point last_frame_end;
+	std::vector<float> frame_times;
+	std::vector<float> pass_times[static_cast<int>(FramePass::COUNT)];
+	long long gpu_memory_available_start = -1;
+	GpuPassTimer<static_cast<size_t>(FramePass::COUNT)> pass_timer;
+
+	void record(const FlythroughEvent &event);
+	void record_parameter_changes(std::vector<FlythroughEvent> &events);
+	void apply(const FlythroughEvent &event, Camera &camera);
+	void finish_replay();
+	void write_report() const;
+};
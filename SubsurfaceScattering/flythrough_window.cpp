@@ -0,0 +1,55 @@
+#include "flythrough_window.h"
+#include <algorithm>
+#include <cstdio>
+
+namespace {
+const char *CANONICAL_SCENES[] = {
+	"flythroughs/cube.txt",
+	"flythroughs/salt_lamp.txt",
+	"flythroughs/head_close_up.txt",
+	"flythroughs/head_far_away.txt",
+};
+}
+
+FlythroughWindow::FlythroughWindow(Flythrough &flythrough)
+	: flythrough(flythrough) {
+	name = "Flythrough";
+}
+
+void FlythroughWindow::build() {
+	ImGui::Begin(get_name());
+
+	const auto mode = flythrough.get_mode();
+
+	ImGui::InputText("Script", script_file, sizeof(script_file));
+	ImGui::InputText("Report", report_file, sizeof(report_file));
+
+	ImGui::SeparatorText("Record");
+	ImGui::BeginDisabled(mode == Flythrough::Mode::Replaying);
+	if (mode == Flythrough::Mode::Recording) {
+		if (ImGui::Button("Stop and save"))
+			flythrough.stop_recording(script_file);
+	} else if (ImGui::Button("Start recording")) {
+		flythrough.start_recording();
+	}
+	ImGui::EndDisabled();
+
+	ImGui::SeparatorText("Replay");
+	ImGui::BeginDisabled(mode != Flythrough::Mode::Idle);
+	if (ImGui::Combo("Scene", &scene_idx,
+					 "Cube\0Salt lamp\0Head close-up\0Head far away\0"))
+		snprintf(script_file, sizeof(script_file), "%s",
+				 CANONICAL_SCENES[scene_idx]);
+	ImGui::InputInt("Frames (0 = script)", &frame_count);
+	frame_count = std::max(frame_count, 0);
+	if (ImGui::Button("Replay"))
+		flythrough.start_replay(script_file, report_file, frame_count);
+	ImGui::EndDisabled();
+
+	if (mode == Flythrough::Mode::Replaying)
+		ImGui::ProgressBar(static_cast<float>(flythrough.get_frame()) /
+						   flythrough.get_frame_count());
+	ImGui::TextWrapped("%s", flythrough.get_status().c_str());
+
+	ImGui::End();
+}
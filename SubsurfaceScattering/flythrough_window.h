@@ -0,0 +1,17 @@
+#pragma once
+
+#include "window.h"
+#include "flythrough.h"
+
+class FlythroughWindow : public Window {
+	Flythrough &flythrough;
+
+	char script_file[256] = "flythroughs/recording.txt";
+	char report_file[256] = "flythrough_report.json";
+	int scene_idx = 0;
+	int frame_count = 0;
+
+  public:
+	FlythroughWindow(Flythrough& flythrough);
+	virtual void build() override;
+};
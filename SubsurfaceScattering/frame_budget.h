@@ -0,0 +1,103 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+
+enum class TaskPriority {
+	// input response, animations: runs every frame
+	High,
+	// runs unless the frame is already expected to miss its deadline
+	Normal,
+	// background work: only runs in frames with time to spare
+	Low,
+};
+
+struct FrameBudgetStatistics {
+	long long frames = 0;
+	// frames that took longer than the target frame time
+	long long missed_deadlines = 0;
+	// task steps skipped to keep frames within the deadline
+	long long deferred_steps = 0;
+	float target_frame_ms = 0.0f;
+	float last_frame_ms = 0.0f;
+	// moving estimates of the time spent on tasks and on the rest of a frame
+	float tasks_ms = 0.0f;
+	float rest_ms = 0.0f;
+};
+
+// Decides per frame which task steps fit before the frame deadline. The rest
+// of a frame (window building, rendering) and every task step get a moving
+// cost estimate; a step is deferred when its estimate doesn't fit in what is
+// left of the frame after the rest, depending on its priority. A step that
+// was deferred too many frames in a row runs anyway, so that nothing starves.
+class FrameBudget {
+	using Clock = std::chrono::steady_clock;
+
+	// weight of the newest sample in the moving estimates
+	static constexpr float SMOOTHING = 0.1f;
+	// a frame counts as missed if it takes this much longer than the target,
+	// which leaves room for timer jitter
+	static constexpr float MISS_TOLERANCE = 1.25f;
+	// Low priority steps leave this fraction of the frame free
+	static constexpr float LOW_PRIORITY_RESERVE = 0.25f;
+	static constexpr int MAX_DEFERRED_FRAMES[] = { 0, 4, 30 };
+
+	float target_frame_ms = 1000.0f / 60.0f;
+	Clock::time_point frame_start = Clock::now(), tasks_end = frame_start;
+	bool frame_started = false;
+	// estimated cost of the steps admitted in this frame so far
+	float admitted_ms = 0.0f;
+	FrameBudgetStatistics statistics;
+
+	static float milliseconds(Clock::duration duration) {
+		return std::chrono::duration<float, std::milli>(duration).count();
+	}
+
+	// the first sample is taken as is
+	static void smooth(float& estimate, float sample) {
+		estimate = estimate == 0.0f ? sample : estimate + SMOOTHING * (sample - estimate);
+	}
+
+public:
+	void set_target_frame_time(float milliseconds) { target_frame_ms = milliseconds; }
+
+	void begin_frame() {
+		const auto now = Clock::now();
+		if (frame_started) {
+			statistics.last_frame_ms = milliseconds(now - frame_start);
+			statistics.missed_deadlines += statistics.last_frame_ms > target_frame_ms * MISS_TOLERANCE;
+			++statistics.frames;
+		}
+		frame_started = true;
+		frame_start = now;
+		admitted_ms = 0.0f;
+		statistics.target_frame_ms = target_frame_ms;
+	}
+
+	// Returns whether a step with the given cost estimate runs this frame.
+	bool admit(TaskPriority priority, float cost_ms, int deferred_frames) {
+		const float left_ms = target_frame_ms - milliseconds(Clock::now() - frame_start) - statistics.rest_ms - admitted_ms;
+		const float reserve_ms = priority == TaskPriority::Low ? target_frame_ms * LOW_PRIORITY_RESERVE : 0.0f;
+		const bool fits = priority == TaskPriority::High || cost_ms <= left_ms - reserve_ms ||
+			deferred_frames >= MAX_DEFERRED_FRAMES[static_cast<int>(priority)];
+		if (fits)
+			admitted_ms += cost_ms;
+		else
+			++statistics.deferred_steps;
+		return fits;
+	}
+
+	// Called when the task steps of the frame are done.
+	void end_tasks() {
+		tasks_end = Clock::now();
+		smooth(statistics.tasks_ms, milliseconds(tasks_end - frame_start));
+	}
+
+	// Called when the frame's CPU work is done, before waiting for the swap.
+	void end_frame() { smooth(statistics.rest_ms, milliseconds(Clock::now() - tasks_end)); }
+
+	// Updates the moving cost estimate of a step.
+	static void add_cost_sample(float& estimate_ms, Clock::duration cost) { smooth(estimate_ms, milliseconds(cost)); }
+
+	const FrameBudgetStatistics& get_statistics() const { return statistics; }
+};
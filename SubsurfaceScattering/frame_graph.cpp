@@ -0,0 +1,167 @@
+#include "frame_graph.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+struct DataAccess {
+	// the last job writing the data, if any
+	size_t writer = SIZE_MAX;
+	// jobs reading it since
+	std::vector<size_t> readers;
+};
+
+double milliseconds(Clock::duration duration) {
+	return std::chrono::duration<double, std::milli>(duration).count();
+}
+} // namespace
+
+// State of one execute(), shared with the pool jobs, which may run after
+// execute() returned and then find nothing to do.
+struct FrameGraph::Execution : std::enable_shared_from_this<Execution> {
+	std::deque<FrameJob> &jobs;
+	ThreadPool &pool;
+
+	std::mutex mutex;
+	std::condition_variable changed;
+	// guarded by mutex
+	std::vector<size_t> gl_ready, worker_ready;
+	size_t remaining;
+	double work_ms = 0.0, gl_work_ms = 0.0;
+	std::exception_ptr error;
+
+	Execution(std::deque<FrameJob> &jobs, ThreadPool &pool) : jobs(jobs), pool(pool), remaining(jobs.size()) {}
+
+	void release(size_t j) {
+		const bool worker = jobs[j].affinity == JobAffinity::Worker;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			(worker ? worker_ready : gl_ready).push_back(j);
+		}
+		changed.notify_one();
+		// whoever comes first runs it, the pool or the waiting calling thread
+		if (worker)
+			pool.submit([self = shared_from_this()]() { self->run_worker_job(); });
+	}
+
+	void run_worker_job() {
+		size_t j;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (worker_ready.empty())
+				return;
+			j = worker_ready.back();
+			worker_ready.pop_back();
+		}
+		run(j);
+	}
+
+	void run(size_t j) {
+		FrameJob &job = jobs[j];
+		const auto job_start = Clock::now();
+		std::exception_ptr job_error;
+		try {
+			job.body();
+		} catch (...) {
+			job_error = std::current_exception();
+		}
+		const double ms = milliseconds(Clock::now() - job_start);
+
+		for (size_t dependent : job.dependents)
+			if (--jobs[dependent].pending_dependencies == 0)
+				release(dependent);
+
+		std::lock_guard<std::mutex> lock(mutex);
+		work_ms += ms;
+		if (job.affinity == JobAffinity::Gl)
+			gl_work_ms += ms;
+		if (job_error && !error)
+			error = job_error;
+		if (--remaining == 0)
+			changed.notify_one();
+	}
+};
+
+void FrameGraph::execute() {
+	statistics = {};
+	statistics.jobs = jobs.size();
+	if (jobs.empty())
+		return;
+
+	// edges in declaration order, every job depends on earlier ones only
+	std::unordered_map<const void *, DataAccess> accesses;
+	std::vector<size_t> dependencies;
+	for (size_t j = 0; j < jobs.size(); ++j) {
+		FrameJob &job = jobs[j];
+		dependencies.clear();
+		for (const void *data : job.read_data) {
+			auto &access = accesses[data];
+			if (access.writer != SIZE_MAX)
+				dependencies.push_back(access.writer);
+			access.readers.push_back(j);
+		}
+		for (const void *data : job.written_data) {
+			auto &access = accesses[data];
+			if (access.writer != SIZE_MAX)
+				dependencies.push_back(access.writer);
+			for (size_t reader : access.readers)
+				if (reader != j)
+					dependencies.push_back(reader);
+			access.writer = j;
+			access.readers.clear();
+		}
+		std::sort(dependencies.begin(), dependencies.end());
+		dependencies.erase(std::unique(dependencies.begin(), dependencies.end()), dependencies.end());
+		job.pending_dependencies = static_cast<int>(dependencies.size());
+		for (size_t dependency : dependencies)
+			jobs[dependency].dependents.push_back(j);
+	}
+
+	// collected first, released jobs may already release their dependents
+	std::vector<size_t> roots;
+	for (size_t j = 0; j < jobs.size(); ++j)
+		if (jobs[j].pending_dependencies == 0)
+			roots.push_back(j);
+
+	const auto start = Clock::now();
+	auto execution = std::make_shared<Execution>(jobs, pool);
+	for (size_t j : roots)
+		execution->release(j);
+
+	// the calling thread runs the GL jobs, and the worker jobs the pool
+	// hasn't picked up yet, until everything is done
+	std::unique_lock<std::mutex> lock(execution->mutex);
+	while (true) {
+		execution->changed.wait(lock, [&]() {
+			return execution->remaining == 0 || !execution->gl_ready.empty() || !execution->worker_ready.empty();
+		});
+		if (!execution->gl_ready.empty()) {
+			const size_t j = execution->gl_ready.back();
+			execution->gl_ready.pop_back();
+			lock.unlock();
+			execution->run(j);
+			lock.lock();
+		} else if (!execution->worker_ready.empty()) {
+			lock.unlock();
+			execution->run_worker_job();
+			lock.lock();
+		} else {
+			break;
+		}
+	}
+	lock.unlock();
+
+	statistics.wall_ms = milliseconds(Clock::now() - start);
+	statistics.work_ms = execution->work_ms;
+	statistics.gl_work_ms = execution->gl_work_ms;
+	jobs.clear();
+	if (execution->error)
+		std::rethrow_exception(execution->error);
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "thread_pool.h"
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+
+enum class JobAffinity {
+	// may touch GL, runs on the thread calling FrameGraph::execute
+	Gl,
+	// runs on the thread pool
+	Worker,
+};
+
+// Job of a frame graph. The data a job reads and writes are identified by
+// their address; a job runs after every job added before it that writes what
+// it reads, or reads or writes what it writes.
+class FrameJob {
+	friend class FrameGraph;
+
+	std::string name;
+	JobAffinity affinity;
+	std::function<void()> body;
+	std::vector<const void *> read_data, written_data;
+
+	// filled by FrameGraph::execute
+	std::vector<size_t> dependents;
+	std::atomic<int> pending_dependencies{0};
+
+  public:
+	FrameJob(std::string name, JobAffinity affinity, std::function<void()> body)
+		: name(std::move(name)), affinity(affinity), body(std::move(body)) {}
+
+	FrameJob &reads(const void *data) {
+		read_data.push_back(data);
+		return *this;
+	}
+
+	FrameJob &writes(const void *data) {
+		written_data.push_back(data);
+		return *this;
+	}
+
+	const std::string &get_name() const { return name; }
+};
+
+struct FrameGraphStatistics {
+	size_t jobs = 0;
+	// from the first job started to the last one finished
+	double wall_ms = 0.0;
+	// time spent in jobs, summed over all threads
+	double work_ms = 0.0;
+	double gl_work_ms = 0.0;
+};
+
+// Jobs of one frame, executed in dependency order: GL jobs on the calling
+// thread, the others on the pool in parallel. Jobs are added every frame and
+// dropped by execute().
+class FrameGraph {
+	ThreadPool &pool;
+	// deque, so that references returned by add stay valid
+	std::deque<FrameJob> jobs;
+	FrameGraphStatistics statistics;
+
+	struct Execution;
+
+  public:
+	explicit FrameGraph(ThreadPool &pool = ThreadPool::shared()) : pool(pool) {}
+
+	FrameJob &add(std::string name, JobAffinity affinity, std::function<void()> body) {
+		return jobs.emplace_back(std::move(name), affinity, std::move(body));
+	}
+
+	bool empty() const { return jobs.empty(); }
+
+	// Runs all jobs and returns when they are done. The first exception
+	// thrown by a job is rethrown once the others have finished.
+	void execute();
+
+	const FrameGraphStatistics &get_statistics() const { return statistics; }
+};
@@ -1,55 +1,149 @@
 #pragma once
 
+#include <cstddef>
+#include <type_traits>
+
+// Arithmetic on Vector<T, DIM> is built from expression templates: +, * and /
+// return lightweight expression objects and the whole chain (for example
+// a + h / 6 * (k1 + 2 * k2 + 2 * k3 + k4)) is evaluated in a single loop when
+// it is assigned to a Vector, without temporary vectors.
+//
+// Expressions keep references to Vector operands, so don't store them in auto
+// variables outliving the operands - assign them to a Vector instead.
+
+template <class T, size_t DIM>
+struct Vector;
+
+template <class E>
+struct is_vector_expression : std::false_type {};
+
+template <class E>
+inline constexpr bool is_vector_expression_v = is_vector_expression<std::decay_t<E>>::value;
+
+// Vectors are referenced by expressions, nested expressions are copied.
+template <class E>
+using expression_operand_t = std::conditional_t<std::is_same_v<E, Vector<typename E::value_type, E::dimension>>, const E&, const E>;
+
+template <class L, class R>
+struct VectorSum {
+	using value_type = typename L::value_type;
+	static constexpr size_t dimension = L::dimension;
+	static_assert(dimension == R::dimension, "Vector dimensions don't match");
+
+	expression_operand_t<L> l;
+	expression_operand_t<R> r;
+
+	inline value_type operator[](const size_t& idx) const { return l[idx] + r[idx]; }
+};
+
+template <class L, class R>
+struct VectorDifference {
+	using value_type = typename L::value_type;
+	static constexpr size_t dimension = L::dimension;
+	static_assert(dimension == R::dimension, "Vector dimensions don't match");
+
+	expression_operand_t<L> l;
+	expression_operand_t<R> r;
+
+	inline value_type operator[](const size_t& idx) const { return l[idx] - r[idx]; }
+};
+
+template <class E>
+struct VectorScaled {
+	using value_type = typename E::value_type;
+	static constexpr size_t dimension = E::dimension;
+
+	value_type a;
+	expression_operand_t<E> e;
+
+	inline value_type operator[](const size_t& idx) const { return a * e[idx]; }
+};
+
+template <class E>
+struct VectorDivided {
+	using value_type = typename E::value_type;
+	static constexpr size_t dimension = E::dimension;
+
+	expression_operand_t<E> e;
+	value_type a;
+
+	inline value_type operator[](const size_t& idx) const { return e[idx] / a; }
+};
+
+template <class T, size_t DIM>
+struct is_vector_expression<Vector<T, DIM>> : std::true_type {};
+template <class L, class R>
+struct is_vector_expression<VectorSum<L, R>> : std::true_type {};
+template <class L, class R>
+struct is_vector_expression<VectorDifference<L, R>> : std::true_type {};
+template <class E>
+struct is_vector_expression<VectorScaled<E>> : std::true_type {};
+template <class E>
+struct is_vector_expression<VectorDivided<E>> : std::true_type {};
+
 template <class T, size_t DIM>
 struct Vector
 {
 private:
 	T elem[DIM];
 public:
-	template <class... Ts>
+	using value_type = T;
+	static constexpr size_t dimension = DIM;
+
+	template <class... Ts, class = std::enable_if_t<(sizeof...(Ts) > 0) && (std::is_arithmetic_v<Ts> && ...)>>
 	inline Vector(Ts... args) : elem{ args... } {}
 	inline Vector() : elem{ 0 } {}
+
+	template <class E, class = std::enable_if_t<is_vector_expression_v<E>>>
+	inline Vector(const E& e) { *this = e; }
+
 	inline T& operator[](const int& idx) { return elem[idx]; }
 	inline const T& operator[](const int& idx) const { return elem[idx]; }
 
-	Vector<T, DIM>& operator +=(const Vector<T, DIM>& v) {
-		for (int i = 0; i < DIM; ++i)
-			elem[i] += v[i];
+	template <class E, class = std::enable_if_t<is_vector_expression_v<E>>>
+	inline Vector<T, DIM>& operator =(const E& e) {
+		static_assert(E::dimension == DIM, "Vector dimensions don't match");
+		for (size_t i = 0; i < DIM; ++i)
+			elem[i] = e[i];
 		return *this;
 	}
 
-	Vector<T, DIM>& operator *=(const T& a) {
-		for (int i = 0; i < DIM; ++i)
+	template <class E, class = std::enable_if_t<is_vector_expression_v<E>>>
+	inline Vector<T, DIM>& operator +=(const E& e) {
+		static_assert(E::dimension == DIM, "Vector dimensions don't match");
+		for (size_t i = 0; i < DIM; ++i)
+			elem[i] += e[i];
+		return *this;
+	}
+
+	inline Vector<T, DIM>& operator *=(const T& a) {
+		for (size_t i = 0; i < DIM; ++i)
 			elem[i] *= a;
 		return *this;
 	}
 };
 
-template <class T, size_t DIM>
-Vector<T, DIM> operator+(const Vector<T, DIM>& v1, const Vector<T, DIM>& v2) {
-	Vector<T, DIM> res;
-	for (int i = 0; i < DIM; ++i)
-		res[i] = v1[i] + v2[i];
-	return res;
+template <class L, class R, class = std::enable_if_t<is_vector_expression_v<L> && is_vector_expression_v<R>>>
+inline VectorSum<L, R> operator+(const L& v1, const R& v2) {
+	return { v1, v2 };
 }
 
-template <class T, size_t DIM>
-Vector<T, DIM> operator*(const T& a, const Vector<T, DIM>& v) {
-	Vector<T, DIM> res;
-	for (int i = 0; i < DIM; ++i)
-		res[i] = a * v[i];
-	return res;
+template <class L, class R, class = std::enable_if_t<is_vector_expression_v<L> && is_vector_expression_v<R>>>
+inline VectorDifference<L, R> operator-(const L& v1, const R& v2) {
+	return { v1, v2 };
 }
 
-template <class T, size_t DIM>
-Vector<T, DIM> operator/(const Vector<T, DIM>& v, const T& a) {
-	Vector<T, DIM> res;
-	for (int i = 0; i < DIM; ++i)
-		res[i] = v[i] / a;
-	return res;
+template <class E, class = std::enable_if_t<is_vector_expression_v<E>>>
+inline VectorScaled<E> operator*(const typename E::value_type& a, const E& v) {
+	return { a, v };
+}
+
+template <class E, class = std::enable_if_t<is_vector_expression_v<E>>>
+inline VectorDivided<E> operator/(const E& v, const typename E::value_type& a) {
+	return { v, a };
 }
 
 template <class T>
 Vector<T, 3> cross(const Vector<T, 3>& v1, const Vector<T, 3>& v2) {
 	return { v1[1] * v2[2] - v1[2] * v2[1],v1[0] * v2[2] - v1[2] * v2[0],v1[0] * v2[1] - v1[1] * v2[0] };
-}
\ No newline at end of file
+}
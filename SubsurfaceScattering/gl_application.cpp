@@ -5,8 +5,6 @@
 #include "imgui_impl_opengl3.h"
 #include "shader_library.h"
 
-constexpr bool ENABLE_VSYNC = true;
-
 static void glfw_error_callback(int error, const char* description)
 {
 	fprintf(stderr, "GLFW Error %d: %s\n", error, description);
@@ -61,6 +59,10 @@ GlApplication::GlApplication(int width, int height, const char* title, const ImV
 	if constexpr (ENABLE_VSYNC)
 		glfwSwapInterval(1); // Enable vsync
 
+	// tasks are scheduled to fit into one refresh interval
+	if (const GLFWvidmode* mode = glfwGetVideoMode(glfwGetPrimaryMonitor()); mode && mode->refreshRate > 0)
+		task_manager.set_target_frame_time(1000.0f / mode->refreshRate);
+
 	// Load GLAD
 	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
 		THROW_EXCEPTION;
@@ -133,6 +135,7 @@ void GlApplication::run() {
 
 		ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 
+		task_manager.end_frame();
 		glfwSwapBuffers(main_window);
 
 	}
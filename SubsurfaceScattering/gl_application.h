@@ -29,6 +29,9 @@
 #include "../libs/emscripten/emscripten_mainloop_stub.h"
 #endif
 
+// Flythrough replays turn vsync off for their duration and restore this.
+constexpr bool ENABLE_VSYNC = true;
+
 class GlApplication {
 public:
 	explicit GlApplication(int width, int height, const char* title, const ImVec4& clear_color, bool maximized);
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <glad/glad.h>
+
+// Measures GPU time of up to PASS_COUNT passes per frame with timestamp
+// queries (they don't conflict with GL_TIME_ELAPSED queries used elsewhere).
+// Results are read LATENCY frames later, so the CPU never waits for the GPU.
+template <size_t PASS_COUNT> class GpuPassTimer {
+	static constexpr int LATENCY = 4;
+
+	GLuint queries[LATENCY][PASS_COUNT][2] = {};
+	bool measured[LATENCY][PASS_COUNT] = {};
+	int frame = 0;
+
+	template <class F> void read_slot(int slot, F &&on_result) {
+		for (size_t pass = 0; pass < PASS_COUNT; ++pass) {
+			if (!measured[slot][pass])
+				continue;
+			GLuint64 start, end;
+			glGetQueryObjectui64v(queries[slot][pass][0], GL_QUERY_RESULT, &start);
+			glGetQueryObjectui64v(queries[slot][pass][1], GL_QUERY_RESULT, &end);
+			on_result(pass, (end - start) * 1e-6f);
+			measured[slot][pass] = false;
+		}
+	}
+
+  public:
+	void init() { glGenQueries(LATENCY * PASS_COUNT * 2, &queries[0][0][0]); }
+
+	void dispose() { glDeleteQueries(LATENCY * PASS_COUNT * 2, &queries[0][0][0]); }
+
+	void begin(size_t pass) { glQueryCounter(queries[frame % LATENCY][pass][0], GL_TIMESTAMP); }
+
+	void end(size_t pass) {
+		glQueryCounter(queries[frame % LATENCY][pass][1], GL_TIMESTAMP);
+		measured[frame % LATENCY][pass] = true;
+	}
+
+	// Calls on_result(pass, milliseconds) for passes of the frame LATENCY - 1
+	// frames ago and starts a new frame.
+	template <class F> void end_frame(F &&on_result) {
+		++frame;
+		read_slot(frame % LATENCY, on_result);
+	}
+
+	// Reads all outstanding results, oldest first.
+	template <class F> void flush(F &&on_result) {
+		for (int i = 1; i <= LATENCY; ++i)
+			read_slot((frame + i) % LATENCY, on_result);
+	}
+};
@@ -0,0 +1,348 @@
+#include "image_loader.h"
+#include "mapped_file.h"
+#include "thread_pool.h"
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#if defined(__SSSE3__) || defined(__AVX__)
+#include <tmmintrin.h>
+#define IMAGE_LOADER_USE_SSSE3
+#endif
+
+#ifdef IMAGE_LOADER_WITH_PNG
+#include <png.h>
+#endif
+
+#ifdef IMAGE_LOADER_WITH_JPEG
+#include <csetjmp>
+#include <cstdio>
+#include <jpeglib.h>
+#endif
+
+namespace {
+// conversion chunks are at least this many pixels
+constexpr size_t MIN_CHUNK_PIXELS = 1 << 16;
+
+[[noreturn]] void fail(const char *filename, const char *message) {
+	throw std::invalid_argument(std::string(filename) + ": " + message);
+}
+
+uint16_t read16(const unsigned char *p) { return p[0] | (p[1] << 8); }
+
+uint32_t read32(const unsigned char *p) {
+	return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+// Row converters to RGBA, count pixels each.
+
+void gray_to_rgba(const unsigned char *src, unsigned char *dst, size_t count) {
+	for (size_t i = 0; i < count; ++i, dst += 4) {
+		dst[0] = dst[1] = dst[2] = src[i];
+		dst[3] = 255;
+	}
+}
+
+void bgr_to_rgba(const unsigned char *src, unsigned char *dst, size_t count) {
+	size_t i = 0;
+#ifdef IMAGE_LOADER_USE_SSSE3
+	const __m128i shuffle = _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1);
+	const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xff000000));
+	// every load of 4 pixels reads 16 bytes, the last 4 of them belong to the
+	// next pixels, so stop before they would run past the row
+	for (; i + 6 <= count; i += 4) {
+		const __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 3 * i));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 4 * i), _mm_or_si128(_mm_shuffle_epi8(in, shuffle), alpha));
+	}
+#endif
+	for (; i < count; ++i) {
+		dst[4 * i + 0] = src[3 * i + 2];
+		dst[4 * i + 1] = src[3 * i + 1];
+		dst[4 * i + 2] = src[3 * i + 0];
+		dst[4 * i + 3] = 255;
+	}
+}
+
+template <bool FORCE_OPAQUE> void bgra_to_rgba(const unsigned char *src, unsigned char *dst, size_t count) {
+	size_t i = 0;
+#ifdef IMAGE_LOADER_USE_SSSE3
+	const __m128i shuffle = _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+	const __m128i alpha = _mm_set1_epi32(FORCE_OPAQUE ? static_cast<int>(0xff000000) : 0);
+	for (; i + 4 <= count; i += 4) {
+		const __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 4 * i));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 4 * i), _mm_or_si128(_mm_shuffle_epi8(in, shuffle), alpha));
+	}
+#endif
+	for (; i < count; ++i) {
+		dst[4 * i + 0] = src[4 * i + 2];
+		dst[4 * i + 1] = src[4 * i + 1];
+		dst[4 * i + 2] = src[4 * i + 0];
+		dst[4 * i + 3] = FORCE_OPAQUE ? 255 : src[4 * i + 3];
+	}
+}
+
+using RowConverter = void (*)(const unsigned char *, unsigned char *, size_t);
+
+// Fills image.pixels from rows of the source. Row y, counted from the bottom,
+// starts at bottom_row + y * stride; stride is negative for top-down sources.
+void convert_rows(Image &image, const unsigned char *bottom_row, ptrdiff_t stride, RowConverter convert) {
+	const size_t width = image.width, height = image.height;
+	image.pixels.resize(4 * width * height);
+	const size_t min_rows = MIN_CHUNK_PIXELS / width + 1;
+	ThreadPool::shared().parallel_chunks(height, min_rows, 1, [&](size_t, size_t begin, size_t end) {
+		for (size_t y = begin; y < end; ++y)
+			convert(bottom_row + static_cast<ptrdiff_t>(y) * stride, &image.pixels[4 * width * y], width);
+	});
+}
+
+void check_size(const char *filename, int64_t width, int64_t height) {
+	if (width <= 0 || height <= 0 || width > (1 << 16) || height > (1 << 16))
+		fail(filename, "invalid image size");
+}
+
+Image decode_bmp(const char *filename, const unsigned char *data, size_t size) {
+	if (size < 54)
+		fail(filename, "truncated BMP header");
+	const uint32_t offset = read32(data + 10);
+	const uint32_t info_size = read32(data + 14);
+	const int32_t width = static_cast<int32_t>(read32(data + 18));
+	const int32_t signed_height = static_cast<int32_t>(read32(data + 22));
+	const uint16_t bits = read16(data + 28);
+	const uint32_t compression = read32(data + 30);
+	const int64_t height = signed_height < 0 ? -static_cast<int64_t>(signed_height) : signed_height;
+	check_size(filename, width, height);
+
+	// BI_RGB, or BI_BITFIELDS with the usual BGRA masks
+	RowConverter convert = nullptr;
+	if (bits == 24 && compression == 0) {
+		convert = bgr_to_rgba;
+	} else if (bits == 32 && compression == 0) {
+		convert = bgra_to_rgba<true>;
+	} else if (bits == 32 && compression == 3 && size >= 14 + 40 + 12) {
+		const unsigned char *masks = data + 14 + 40;
+		if (read32(masks) == 0x00ff0000 && read32(masks + 4) == 0x0000ff00 && read32(masks + 8) == 0x000000ff) {
+			const bool has_alpha = info_size >= 56 && size >= 14 + 56 && read32(masks + 12) == 0xff000000;
+			convert = has_alpha ? bgra_to_rgba<false> : bgra_to_rgba<true>;
+		}
+	}
+	if (!convert)
+		fail(filename, "unsupported BMP format, only 24 and 32 bit BGR(A) is supported");
+
+	const size_t stride = (bits / 8 * static_cast<size_t>(width) + 3) / 4 * 4;
+	if (offset > size || (size - offset) / stride < static_cast<size_t>(height))
+		fail(filename, "truncated BMP pixel data");
+
+	Image image;
+	image.width = width;
+	image.height = static_cast<int>(height);
+	const unsigned char *pixels = data + offset;
+	// positive heights are stored bottom-up already
+	if (signed_height > 0)
+		convert_rows(image, pixels, stride, convert);
+	else
+		convert_rows(image, pixels + (height - 1) * stride, -static_cast<ptrdiff_t>(stride), convert);
+	return image;
+}
+
+Image decode_tga(const char *filename, const unsigned char *data, size_t size) {
+	if (size < 18)
+		fail(filename, "truncated TGA header");
+	const unsigned char id_length = data[0], color_map_type = data[1], type = data[2];
+	const int width = read16(data + 12), height = read16(data + 14);
+	const int bits = data[16], descriptor = data[17];
+	check_size(filename, width, height);
+
+	const bool rle = type == 10 || type == 11;
+	const bool gray = type == 3 || type == 11;
+	RowConverter convert = nullptr;
+	if (color_map_type == 0 && gray && bits == 8)
+		convert = gray_to_rgba;
+	else if (color_map_type == 0 && (type == 2 || type == 10) && bits == 24)
+		convert = bgr_to_rgba;
+	else if (color_map_type == 0 && (type == 2 || type == 10) && bits == 32)
+		convert = (descriptor & 0x0f) ? bgra_to_rgba<false> : bgra_to_rgba<true>;
+	if (!convert)
+		fail(filename, "unsupported TGA format, only 8 bit grayscale and 24 or 32 bit true color is supported");
+	if (descriptor & 0x10)
+		fail(filename, "right-to-left TGA images are not supported");
+
+	const size_t pixel_size = bits / 8;
+	const size_t stride = pixel_size * width;
+	const size_t packed_size = stride * height;
+	const size_t start = 18 + static_cast<size_t>(id_length);
+	if (start > size)
+		fail(filename, "truncated TGA header");
+
+	std::vector<unsigned char> unpacked;
+	const unsigned char *pixels = data + start;
+	if (rle) {
+		// packets may cross rows, so this part is sequential
+		unpacked.resize(packed_size);
+		const unsigned char *src = pixels, *src_end = data + size;
+		size_t written = 0;
+		while (written < packed_size) {
+			if (src >= src_end)
+				fail(filename, "truncated TGA RLE data");
+			const size_t header = *src++;
+			const size_t count = (header & 0x7f) + 1;
+			if (written + count * pixel_size > packed_size)
+				fail(filename, "TGA RLE packet runs past the image");
+			if (header & 0x80) {
+				if (static_cast<size_t>(src_end - src) < pixel_size)
+					fail(filename, "truncated TGA RLE data");
+				for (size_t i = 0; i < count; ++i, written += pixel_size)
+					std::memcpy(&unpacked[written], src, pixel_size);
+				src += pixel_size;
+			} else {
+				if (static_cast<size_t>(src_end - src) < count * pixel_size)
+					fail(filename, "truncated TGA RLE data");
+				std::memcpy(&unpacked[written], src, count * pixel_size);
+				src += count * pixel_size;
+				written += count * pixel_size;
+			}
+		}
+		pixels = unpacked.data();
+	} else if (size - start < packed_size) {
+		fail(filename, "truncated TGA pixel data");
+	}
+
+	Image image;
+	image.width = width;
+	image.height = height;
+	// bottom-up unless the top-left origin bit is set
+	if (descriptor & 0x20)
+		convert_rows(image, pixels + (height - 1) * stride, -static_cast<ptrdiff_t>(stride), convert);
+	else
+		convert_rows(image, pixels, stride, convert);
+	return image;
+}
+
+#ifdef IMAGE_LOADER_WITH_PNG
+Image decode_png(const char *filename, const unsigned char *data, size_t size) {
+	png_image png;
+	std::memset(&png, 0, sizeof(png));
+	png.version = PNG_IMAGE_VERSION;
+	if (!png_image_begin_read_from_memory(&png, data, size))
+		fail(filename, png.message);
+	png.format = PNG_FORMAT_RGBA;
+
+	Image image;
+	image.width = png.width;
+	image.height = png.height;
+	image.pixels.resize(PNG_IMAGE_SIZE(png));
+	// a negative stride makes libpng store the rows bottom to top
+	const png_int_32 stride = -static_cast<png_int_32>(PNG_IMAGE_ROW_STRIDE(png));
+	if (!png_image_finish_read(&png, nullptr, image.pixels.data(), stride, nullptr))
+		fail(filename, png.message);
+	return image;
+}
+#endif
+
+#ifdef IMAGE_LOADER_WITH_JPEG
+struct JpegError {
+	jpeg_error_mgr manager;
+	std::jmp_buf jump;
+	char message[JMSG_LENGTH_MAX];
+};
+
+// Kept apart from decode_jpeg, so no C++ object lives across the setjmp.
+bool decode_jpeg_into(const unsigned char *data, size_t size, Image &image, JpegError &error) {
+	jpeg_decompress_struct info;
+	info.err = jpeg_std_error(&error.manager);
+	error.manager.error_exit = [](j_common_ptr common) {
+		JpegError *error = reinterpret_cast<JpegError *>(common->err);
+		common->err->format_message(common, error->message);
+		std::longjmp(error->jump, 1);
+	};
+	// warnings about recoverable damage aren't printed
+	error.manager.output_message = [](j_common_ptr) {};
+	if (setjmp(error.jump)) {
+		jpeg_destroy_decompress(&info);
+		return false;
+	}
+
+	jpeg_create_decompress(&info);
+	jpeg_mem_src(&info, const_cast<unsigned char *>(data), static_cast<unsigned long>(size));
+	jpeg_read_header(&info, TRUE);
+#ifdef JCS_EXTENSIONS
+	info.out_color_space = JCS_EXT_RGBA;
+	const int components = 4;
+#else
+	info.out_color_space = JCS_RGB;
+	const int components = 3;
+#endif
+	jpeg_start_decompress(&info);
+
+	image.width = info.output_width;
+	image.height = info.output_height;
+	image.pixels.resize(4 * static_cast<size_t>(image.width) * image.height);
+	const size_t stride = static_cast<size_t>(components) * image.width;
+	// the staging row belongs to libjpeg's pool, so it is freed on errors too
+	JSAMPROW staging = components == 4 ? nullptr
+									   : info.mem->alloc_sarray(reinterpret_cast<j_common_ptr>(&info),
+																JPOOL_IMAGE, static_cast<JDIMENSION>(stride), 1)[0];
+	while (info.output_scanline < info.output_height) {
+		// JPEG rows come top to bottom
+		unsigned char *row = &image.pixels[4 * static_cast<size_t>(image.width) *
+											(image.height - 1 - info.output_scanline)];
+		JSAMPROW target = staging ? staging : row;
+		jpeg_read_scanlines(&info, &target, 1);
+		if (staging)
+			for (int x = 0; x < image.width; ++x) {
+				std::memcpy(row + 4 * x, staging + 3 * x, 3);
+				row[4 * x + 3] = 255;
+			}
+	}
+
+	jpeg_finish_decompress(&info);
+	jpeg_destroy_decompress(&info);
+	return true;
+}
+
+Image decode_jpeg(const char *filename, const unsigned char *data, size_t size) {
+	Image image;
+	JpegError error;
+	if (!decode_jpeg_into(data, size, image, error))
+		fail(filename, error.message);
+	return image;
+}
+#endif
+
+bool has_extension(const char *filename, const char *extension) {
+	const size_t length = std::strlen(filename), extension_length = std::strlen(extension);
+	if (length < extension_length)
+		return false;
+	for (size_t i = 0; i < extension_length; ++i)
+		if (std::tolower(static_cast<unsigned char>(filename[length - extension_length + i])) != extension[i])
+			return false;
+	return true;
+}
+} // namespace
+
+Image load_image(const char *filename) {
+	MappedFile file(filename);
+	const unsigned char *data = reinterpret_cast<const unsigned char *>(file.data());
+	const size_t size = file.size();
+
+	if (size >= 2 && data[0] == 'B' && data[1] == 'M')
+		return decode_bmp(filename, data, size);
+	if (size >= 8 && std::memcmp(data, "\x89PNG\r\n\x1a\n", 8) == 0) {
+#ifdef IMAGE_LOADER_WITH_PNG
+		return decode_png(filename, data, size);
+#else
+		fail(filename, "PNG support wasn't built in");
+#endif
+	}
+	if (size >= 3 && data[0] == 0xff && data[1] == 0xd8 && data[2] == 0xff) {
+#ifdef IMAGE_LOADER_WITH_JPEG
+		return decode_jpeg(filename, data, size);
+#else
+		fail(filename, "JPEG support wasn't built in");
+#endif
+	}
+	if (has_extension(filename, ".tga"))
+		return decode_tga(filename, data, size);
+	fail(filename, "unknown image format");
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <vector>
+
+// 8-bit RGBA image with rows stored bottom to top, as glTexImage2D expects
+// them.
+struct Image {
+	int width = 0, height = 0;
+	std::vector<unsigned char> pixels;
+};
+
+// Loads a BMP (24 or 32 bit), TGA (true color or grayscale, optionally RLE
+// compressed), PNG or JPEG file. The format is detected from the file
+// contents, TGA files from the extension. PNG and JPEG are decoded with
+// libpng and libjpeg when the build found them. Throws std::invalid_argument
+// when the file can't be opened or decoded.
+Image load_image(const char *filename);
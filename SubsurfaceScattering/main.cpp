@@ -1,27 +1,55 @@
 #include "scattering_view_window.h"
 #include "gl_application.h"
 #include "fullscreen_window.h"
+#include "flythrough.h"
+#include "flythrough_window.h"
 #include "scattering_parameters.h"
 #include "scattering_parameters_window.h"
+#include <cstdlib>
+#include <cstring>
 
-int main(int, char**)
+// Usage: SubsurfaceScattering [--replay <script> [--frames <n>] [--output <json>]]
+// With --replay the script is played once the window is up and the
+// application exits after writing the report.
+int main(int argc, char** argv)
 {
+	const char* replay_script = nullptr;
+	const char* replay_output = "flythrough_report.json";
+	int replay_frames = 0;
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		if (std::strcmp(argv[i], "--replay") == 0)
+			replay_script = argv[i + 1];
+		else if (std::strcmp(argv[i], "--output") == 0)
+			replay_output = argv[i + 1];
+		else if (std::strcmp(argv[i], "--frames") == 0)
+			replay_frames = std::atoi(argv[i + 1]);
+	}
+
 	GlApplication app(1280, 720, "Subsurface scattering", ImVec4(0.27f, 0.33f, 0.36f, 1.00f), true);
 
 	ScatteringParameters parameters;
+	Flythrough flythrough(parameters);
 
 	auto fullscreen = make_window<FullscreenWindow>();
-	auto view = make_window<ScatteringViewWindow>(parameters);
+	auto view = make_window<ScatteringViewWindow>(parameters, flythrough);
 	auto parameters_window = make_window<ScatteringParametersWindow>(parameters);
+	auto flythrough_window = make_window<FlythroughWindow>(flythrough);
 
 	auto& dockspace = fullscreen->get_dockspace();
 	auto split = dockspace.split(ImGuiDir_Left, 0.2f);
-	split.first->dock(*parameters_window);
+	auto left_split = split.first->split(ImGuiDir_Down, 0.25f);
+	left_split.first->dock(*flythrough_window);
+	left_split.second->dock(*parameters_window);
 	split.second->dock(*view);
 
 	app.add_window(fullscreen);
 	app.add_window(view);
 	app.add_window(parameters_window);
+	app.add_window(flythrough_window);
+
+	if (replay_script)
+		flythrough.start_replay(replay_script, replay_output, replay_frames, true);
 
 	app.run();
 
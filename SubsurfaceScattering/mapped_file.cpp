@@ -0,0 +1,75 @@
+#include "mapped_file.h"
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+
+MappedFile::MappedFile(const char *filename) {
+	file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+					   FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		file = nullptr;
+		throw std::invalid_argument("Couldn't open file");
+	}
+	LARGE_INTEGER file_size;
+	GetFileSizeEx(file, &file_size);
+	length = static_cast<size_t>(file_size.QuadPart);
+	if (length == 0)
+		return;
+
+	mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping)
+		bytes = static_cast<const char *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+	if (!bytes) {
+		this->~MappedFile();
+		throw std::invalid_argument("Couldn't map file");
+	}
+}
+
+MappedFile::~MappedFile() {
+	if (bytes)
+		UnmapViewOfFile(bytes);
+	if (mapping)
+		CloseHandle(mapping);
+	if (file)
+		CloseHandle(file);
+	bytes = nullptr;
+	mapping = file = nullptr;
+}
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile(const char *filename) {
+	fd = open(filename, O_RDONLY);
+	if (fd < 0)
+		throw std::invalid_argument("Couldn't open file");
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		close(fd);
+		throw std::invalid_argument("Couldn't open file");
+	}
+	length = static_cast<size_t>(st.st_size);
+	if (length == 0)
+		return;
+
+	void *mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (mapped == MAP_FAILED) {
+		close(fd);
+		throw std::invalid_argument("Couldn't map file");
+	}
+	madvise(mapped, length, MADV_SEQUENTIAL);
+	bytes = static_cast<const char *>(mapped);
+}
+
+MappedFile::~MappedFile() {
+	if (bytes)
+		munmap(const_cast<char *>(bytes), length);
+	if (fd >= 0)
+		close(fd);
+}
+#endif
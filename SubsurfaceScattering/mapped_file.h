@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+
+// Read-only memory mapping of a whole file. Throws std::invalid_argument when
+// the file can't be opened, like the other loaders.
+class MappedFile {
+	const char *bytes = nullptr;
+	size_t length = 0;
+#ifdef _WIN32
+	void *file = nullptr;
+	void *mapping = nullptr;
+#else
+	int fd = -1;
+#endif
+
+  public:
+	explicit MappedFile(const char *filename);
+	~MappedFile();
+
+	MappedFile(const MappedFile &) = delete;
+	MappedFile &operator=(const MappedFile &) = delete;
+
+	const char *data() const { return bytes; }
+	size_t size() const { return length; }
+};
@@ -0,0 +1,272 @@
+#pragma once
+
+#include "algebra.h"
+#include "simd_pack.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+// Soft body made of SIDE^3 point masses on a lattice, every point connected to
+// its up to 26 neighbours by damped springs: structural ones along the edges,
+// shear ones along the face diagonals and diagonal ones along the body
+// diagonals. Points are indexed i + SIDE * j + SIDE^2 * k like the control
+// points of BezierCube.
+//
+// States are kept as structure of arrays and stepped with semi-implicit Euler
+// a SIMD pack of points at a time. Each point gathers the forces of all its
+// springs, so packs are independent and large lattices are split over the
+// thread pool. Neighbours are found at fixed index offsets, springs leaving
+// the lattice are masked out, which keeps the kernel the same for every point.
+template <int SIDE>
+class MassSpringLattice {
+	static_assert(SIDE >= 2, "a lattice needs at least two points per side");
+
+public:
+	static constexpr int POINT_COUNT = SIDE * SIDE * SIDE;
+
+	struct Parameters {
+		float point_mass = 0.05f;
+		float structural_k = 50.0f, shear_k = 30.0f, diagonal_k = 20.0f;
+		// along the springs, relative velocity of their ends
+		float damping = 0.2f;
+		// pull of anchored points towards their targets and its damping
+		float anchor_k = 100.0f, anchor_damping = 1.0f;
+		Vector3 gravity = { 0.0f, -9.81f, 0.0f };
+	} parameters;
+
+private:
+	static constexpr int OFFSET_COUNT = 26;
+	static constexpr size_t round_up(size_t n, size_t m) { return (n + m - 1) / m * m; }
+	// neighbour loads of the points at the ends reach this far out of the
+	// lattice, also in the widest pack
+	static constexpr size_t MARGIN = round_up(SIDE * SIDE + SIDE + 1, 16);
+	static constexpr size_t PADDED_COUNT = round_up(POINT_COUNT, 16);
+	// points per pool job, smaller lattices are stepped on the calling thread
+	static constexpr size_t MIN_CHUNK = 2048;
+
+	struct Neighbour {
+		// index offset, spring type (0 structural, 1 shear, 2 diagonal) and
+		// rest length in edges
+		int offset;
+		int type;
+		float length;
+	};
+
+	float edge;
+	Vector3 origin;
+	std::array<Neighbour, OFFSET_COUNT> neighbours;
+
+	// double buffered, MARGIN points before and after the lattice
+	std::vector<float> position[2][3], velocity[2][3];
+	int current = 0;
+	// 1 where the spring to the neighbour exists
+	std::vector<float> masks[OFFSET_COUNT];
+	// 0 for padding, which then never moves
+	std::vector<float> inverse_mass;
+	// point mass inverse_mass was filled for
+	float filled_mass = 0.0f;
+	std::vector<float> anchor_weight, anchor_target[3];
+
+	static int index(int i, int j, int k) { return i + SIDE * j + SIDE * SIDE * k; }
+
+	void step_packs(size_t begin, size_t end, float dt);
+
+public:
+	// lattice of the given side length, from origin along the positive axes
+	explicit MassSpringLattice(float size = 1.0f, const Vector3& origin = { 0.0f, 0.0f, 0.0f });
+
+	// Back to the rest shape, at rest.
+	void reset();
+
+	// Point i is pulled towards target, e.g. a corner of a control frame.
+	void anchor(int i, const Vector3& target);
+	void release(int i);
+	// index of a lattice corner, c in [0, 8), bit 0 for i, 1 for j, 2 for k
+	static int corner(int c) { return index((c & 1) * (SIDE - 1), (c >> 1 & 1) * (SIDE - 1), (c >> 2 & 1) * (SIDE - 1)); }
+
+	void step(float dt);
+	void run(float dt, int steps) {
+		for (int s = 0; s < steps; ++s)
+			step(dt);
+	}
+
+	Vector3 get_position(int i) const {
+		const size_t p = MARGIN + i;
+		return { position[current][0][p], position[current][1][p], position[current][2][p] };
+	}
+	void get_positions(Vector3* out) const {
+		for (int i = 0; i < POINT_COUNT; ++i)
+			out[i] = get_position(i);
+	}
+	void set_position(int i, const Vector3& p) {
+		const size_t q = MARGIN + i;
+		position[current][0][q] = p.x;
+		position[current][1][q] = p.y;
+		position[current][2][q] = p.z;
+	}
+};
+
+template <int SIDE>
+MassSpringLattice<SIDE>::MassSpringLattice(float size, const Vector3& origin)
+	: edge(size / (SIDE - 1)), origin(origin) {
+	int n = 0;
+	for (int dk = -1; dk <= 1; ++dk)
+		for (int dj = -1; dj <= 1; ++dj)
+			for (int di = -1; di <= 1; ++di) {
+				const int type = std::abs(di) + std::abs(dj) + std::abs(dk) - 1;
+				if (type < 0)
+					continue;
+				neighbours[n++] = { index(di, dj, dk), type, std::sqrt(static_cast<float>(type + 1)) };
+			}
+
+	for (auto& buffer : position)
+		for (auto& axis : buffer)
+			axis.assign(MARGIN + PADDED_COUNT + MARGIN, 0.0f);
+	for (auto& buffer : velocity)
+		for (auto& axis : buffer)
+			axis.assign(MARGIN + PADDED_COUNT + MARGIN, 0.0f);
+
+	for (int o = 0; o < OFFSET_COUNT; ++o)
+		masks[o].assign(PADDED_COUNT, 0.0f);
+	inverse_mass.assign(PADDED_COUNT, 0.0f);
+	anchor_weight.assign(PADDED_COUNT, 0.0f);
+	for (auto& axis : anchor_target)
+		axis.assign(PADDED_COUNT, 0.0f);
+
+	for (int k = 0; k < SIDE; ++k)
+		for (int j = 0; j < SIDE; ++j)
+			for (int i = 0; i < SIDE; ++i) {
+				const int p = index(i, j, k);
+				int o = 0;
+				for (int dk = -1; dk <= 1; ++dk)
+					for (int dj = -1; dj <= 1; ++dj)
+						for (int di = -1; di <= 1; ++di) {
+							if (di == 0 && dj == 0 && dk == 0)
+								continue;
+							const bool inside = i + di >= 0 && i + di < SIDE && j + dj >= 0 && j + dj < SIDE &&
+								k + dk >= 0 && k + dk < SIDE;
+							masks[o++][p] = inside ? 1.0f : 0.0f;
+						}
+			}
+	reset();
+}
+
+template <int SIDE>
+void MassSpringLattice<SIDE>::reset() {
+	for (int b = 0; b < 2; ++b)
+		for (int axis = 0; axis < 3; ++axis)
+			std::fill(velocity[b][axis].begin(), velocity[b][axis].end(), 0.0f);
+	for (int k = 0; k < SIDE; ++k)
+		for (int j = 0; j < SIDE; ++j)
+			for (int i = 0; i < SIDE; ++i) {
+				const Vector3 p = origin + edge * Vector3{ static_cast<float>(i), static_cast<float>(j), static_cast<float>(k) };
+				for (int b = 0; b < 2; ++b) {
+					position[b][0][MARGIN + index(i, j, k)] = p.x;
+					position[b][1][MARGIN + index(i, j, k)] = p.y;
+					position[b][2][MARGIN + index(i, j, k)] = p.z;
+				}
+			}
+}
+
+template <int SIDE>
+void MassSpringLattice<SIDE>::anchor(int i, const Vector3& target) {
+	anchor_weight[i] = 1.0f;
+	anchor_target[0][i] = target.x;
+	anchor_target[1][i] = target.y;
+	anchor_target[2][i] = target.z;
+}
+
+template <int SIDE>
+void MassSpringLattice<SIDE>::release(int i) {
+	anchor_weight[i] = 0.0f;
+}
+
+template <int SIDE>
+void MassSpringLattice<SIDE>::step(float dt) {
+	if (parameters.point_mass != filled_mass) {
+		std::fill(inverse_mass.begin(), inverse_mass.begin() + POINT_COUNT, 1.0f / parameters.point_mass);
+		filled_mass = parameters.point_mass;
+	}
+
+	const size_t chunks = std::max<size_t>(1, std::min(PADDED_COUNT / MIN_CHUNK, ThreadPool::shared().get_worker_count() + 1));
+	const size_t chunk_size = round_up((PADDED_COUNT + chunks - 1) / chunks, 16);
+	if (chunks == 1) {
+		step_packs(0, PADDED_COUNT, dt);
+	} else {
+		ThreadPool::shared().parallel_for(chunks, [&](size_t c) {
+			step_packs(std::min(PADDED_COUNT, c * chunk_size), std::min(PADDED_COUNT, (c + 1) * chunk_size), dt);
+		});
+	}
+	current ^= 1;
+}
+
+template <int SIDE>
+void MassSpringLattice<SIDE>::step_packs(size_t begin, size_t end, float dt) {
+	using namespace simd;
+	const float* x = position[current][0].data() + MARGIN;
+	const float* y = position[current][1].data() + MARGIN;
+	const float* z = position[current][2].data() + MARGIN;
+	const float* vx = velocity[current][0].data() + MARGIN;
+	const float* vy = velocity[current][1].data() + MARGIN;
+	const float* vz = velocity[current][2].data() + MARGIN;
+	float* out_x = position[current ^ 1][0].data() + MARGIN;
+	float* out_y = position[current ^ 1][1].data() + MARGIN;
+	float* out_z = position[current ^ 1][2].data() + MARGIN;
+	float* out_vx = velocity[current ^ 1][0].data() + MARGIN;
+	float* out_vy = velocity[current ^ 1][1].data() + MARGIN;
+	float* out_vz = velocity[current ^ 1][2].data() + MARGIN;
+
+	const Pack k[3] = { splat(parameters.structural_k), splat(parameters.shear_k), splat(parameters.diagonal_k) };
+	Pack rest[OFFSET_COUNT];
+	for (int o = 0; o < OFFSET_COUNT; ++o)
+		rest[o] = splat(neighbours[o].length * edge);
+	const Pack damping = splat(parameters.damping);
+	const Pack anchor_k = splat(parameters.anchor_k), anchor_damping = splat(parameters.anchor_damping);
+	const Pack mass = splat(parameters.point_mass);
+	const Pack gx = mul(mass, splat(parameters.gravity.x)), gy = mul(mass, splat(parameters.gravity.y)),
+		gz = mul(mass, splat(parameters.gravity.z));
+	const Pack step = splat(dt);
+	// keeps the direction finite for coinciding points of masked springs
+	const Pack epsilon = splat(1e-12f);
+
+	for (size_t i = begin; i < end; i += WIDTH) {
+		const Pack px = load(x + i), py = load(y + i), pz = load(z + i);
+		const Pack pvx = load(vx + i), pvy = load(vy + i), pvz = load(vz + i);
+		Pack fx = gx, fy = gy, fz = gz;
+
+		for (int o = 0; o < OFFSET_COUNT; ++o) {
+			const size_t n = i + neighbours[o].offset;
+			const Pack dx = sub(load(x + n), px), dy = sub(load(y + n), py), dz = sub(load(z + n), pz);
+			const Pack length2 = madd(dx, dx, madd(dy, dy, madd(dz, dz, epsilon)));
+			const Pack inv_length = rsqrt(length2);
+			const Pack length = mul(length2, inv_length);
+			const Pack relative = mul(madd(sub(load(vx + n), pvx), dx,
+				madd(sub(load(vy + n), pvy), dy, mul(sub(load(vz + n), pvz), dz))), inv_length);
+			// force along the unit direction, divided by the length once more
+			// to be applied to the unnormalized difference
+			const Pack s = mul(load(&masks[o][i]),
+				mul(madd(k[neighbours[o].type], sub(length, rest[o]), mul(damping, relative)), inv_length));
+			fx = madd(s, dx, fx);
+			fy = madd(s, dy, fy);
+			fz = madd(s, dz, fz);
+		}
+
+		const Pack weight = load(&anchor_weight[i]);
+		fx = madd(weight, sub(mul(anchor_k, sub(load(&anchor_target[0][i]), px)), mul(anchor_damping, pvx)), fx);
+		fy = madd(weight, sub(mul(anchor_k, sub(load(&anchor_target[1][i]), py)), mul(anchor_damping, pvy)), fy);
+		fz = madd(weight, sub(mul(anchor_k, sub(load(&anchor_target[2][i]), pz)), mul(anchor_damping, pvz)), fz);
+
+		// semi-implicit Euler: the new velocity moves the point
+		const Pack a = mul(step, load(&inverse_mass[i]));
+		const Pack nvx = madd(a, fx, pvx), nvy = madd(a, fy, pvy), nvz = madd(a, fz, pvz);
+		store(out_vx + i, nvx);
+		store(out_vy + i, nvy);
+		store(out_vz + i, nvz);
+		store(out_x + i, madd(step, nvx, px));
+		store(out_y + i, madd(step, nvy, py));
+		store(out_z + i, madd(step, nvz, pz));
+	}
+}
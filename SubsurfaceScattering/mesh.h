@@ -6,11 +6,13 @@
 #include "camera.h"
 #include "frame_buffer.h"
 #include "light.h"
+#include "mesh_simplifier.h"
 #include "quaternion.h"
 #include "scattering_parameters.h"
 #include "shader_library.h"
 #include "texture.h"
 #include "vertex_array.h"
+#include "vertex_kernels.h"
 #include <vector>
 
 template <GLenum MODE> class Mesh {
@@ -20,13 +22,35 @@ template <GLenum MODE> class Mesh {
 	VertexBuffer normal_vbo;
 	ElementBuffer ebo;
 	size_t indices_count = 0;
+	size_t vertex_count = 0;
 	bool has_normals = false;
 
+	// levels of detail as ranges of the index buffer, the first one is the
+	// full mesh
+	std::vector<LodLevel> lods = {LodLevel{}};
+	size_t lod = 0;
+
+	// draws the selected level of detail
+	void draw_elements() const {
+		const LodLevel &level = lods[lod];
+		glDrawElements(MODE, level.index_count, GL_UNSIGNED_INT,
+					   reinterpret_cast<const void *>(level.first_index * sizeof(GLuint)));
+	}
+	void draw_elements_instanced(GLsizei instance_count) const {
+		const LodLevel &level = lods[lod];
+		glDrawElementsInstanced(MODE, level.index_count, GL_UNSIGNED_INT,
+								reinterpret_cast<const void *>(level.first_index * sizeof(GLuint)),
+								instance_count);
+	}
+
+	// Uses the shader of the given type with the uniforms of this mesh.
+	Shader &use_shader(ShaderType type, const Camera &camera,
+					   const ScatteringParameters &parameters, int width,
+					   int height);
+
 	Box bounding_box;
 	void calculate_bounding_box(const std::vector<Vector3> &vertices) {
-		bounding_box = Box::degenerate();
-		for (const auto &v : vertices)
-			bounding_box.add(v);
+		bounding_box = vertex_kernels::bounds(vertices.data(), vertices.size());
 	}
 
   public:
@@ -87,13 +111,22 @@ template <GLenum MODE> class Mesh {
 		vbo.bind();
 		vbo.set_static_data(reinterpret_cast<const float *>(points.data()),
 							points.size() * sizeof(Vector3));
+		vertex_count = points.size();
 
 		ebo.bind();
 		ebo.set_static_data(
 			reinterpret_cast<const unsigned int *>(indices.data()),
 			indices.size() * sizeof(I));
 		indices_count = indices.size() * sizeof(I) / sizeof(unsigned int);
+		lods = {{0, indices_count, 0.0f}};
+		lod = 0;
+	}
+	// levels must index the data set last, e.g. LodChain::indices
+	void set_lods(const std::vector<LodLevel> &levels) {
+		lods = levels;
+		lod = 0;
 	}
+	size_t select_lod(const Camera &camera, int height, float error_pixels);
 	void set_data(const std::vector<Vector3> &points);
 	void set_normals(const std::vector<Vector3> &normals);
 	virtual void render(const Camera &camera,
@@ -106,6 +139,8 @@ template <GLenum MODE> class Mesh {
 	void render_simple(const Camera &camera, int width, int height);
 
 	const Box &get_bounding_box() const { return bounding_box; }
+	size_t get_lod() const { return lod; }
+	const std::vector<LodLevel> &get_lods() const { return lods; }
 };
 
 template <GLenum MODE>
@@ -126,19 +161,39 @@ void Mesh<MODE>::set_normals(const std::vector<Vector3> &normals) {
 							   normals.size() * sizeof(Vector3));
 }
 
+// Selects the coarsest level of detail whose error, seen from the camera at
+// the nearest point of the bounding box, is at most error_pixels pixels of a
+// view height pixels tall. Returns the selected level.
 template <GLenum MODE>
-void Mesh<MODE>::render(const Camera &camera,
-						const ScatteringParameters &parameters, int width,
-						int height) {
-	if (!visible)
-		return;
+size_t Mesh<MODE>::select_lod(const Camera &camera, int height,
+							  float error_pixels) {
+	const float model_diameter = bounding_box.diameter();
+	const float world_diameter = bounding_box.diameter(model);
+	const float world_scale =
+		model_diameter > 0.0f ? world_diameter / model_diameter : 1.0f;
+	const float distance = std::max(
+		(bounding_box.center(model) - camera.get_world_position()).length() -
+			0.5f * world_diameter,
+		camera.near);
+	const float pixels_per_unit =
+		0.5f * height / std::tan(0.5f * camera.fov_rad) / distance;
+
+	lod = 0;
+	while (lod + 1 < lods.size() &&
+		   lods[lod + 1].error * world_scale * pixels_per_unit <= error_pixels)
+		++lod;
+	return lod;
+}
 
-	auto pv =
-		camera.get_projection_matrix(width, height) * camera.get_view_matrix();
+template <GLenum MODE>
+Shader &Mesh<MODE>::use_shader(ShaderType type, const Camera &camera,
+							   const ScatteringParameters &parameters,
+							   int width, int height) {
+	auto pv = camera.get_projection_view_matrix(width, height);
 
 	glEnable(GL_CULL_FACE);
 
-	Shader &shader = ShaderLibrary::get_shader(shader_type);
+	Shader &shader = ShaderLibrary::get_shader(type);
 
 	shader.use();
 	shader.set_pv(pv);
@@ -151,13 +206,23 @@ void Mesh<MODE>::render(const Camera &camera,
 		parameters.scatter_color, parameters.scatter_falloff,
 		parameters.angle_scatter);
 	shader.set_translucency(parameters.translucency, parameters.sigma_t,
-		parameters.light_camera.get_projection_matrix(
+		parameters.light_camera.get_projection_view_matrix(
 			ScatteringParameters::DEPTH_MAP_SIZE,
-			ScatteringParameters::DEPTH_MAP_SIZE) *
-		parameters.light_camera.get_view_matrix());
+			ScatteringParameters::DEPTH_MAP_SIZE));
+	return shader;
+}
+
+template <GLenum MODE>
+void Mesh<MODE>::render(const Camera &camera,
+						const ScatteringParameters &parameters, int width,
+						int height) {
+	if (!visible)
+		return;
+
+	use_shader(shader_type, camera, parameters, width, height);
 
 	vao.bind();
-	glDrawElements(MODE, indices_count, GL_UNSIGNED_INT, nullptr);
+	draw_elements();
 	// glDrawArrays(MODE, 0, point_count);
 	vao.unbind();
 }
@@ -177,8 +242,7 @@ void Mesh<MODE>::render_simple(const Camera &camera, int width, int height) {
 	if (!visible)
 		return;
 
-	auto pv =
-		camera.get_projection_matrix(width, height) * camera.get_view_matrix();
+	auto pv = camera.get_projection_view_matrix(width, height);
 
 	glEnable(GL_CULL_FACE);
 
@@ -191,7 +255,7 @@ void Mesh<MODE>::render_simple(const Camera &camera, int width, int height) {
 	shader.set_camera_position(camera.get_world_position());
 
 	vao.bind();
-	glDrawElements(MODE, indices_count, GL_UNSIGNED_INT, nullptr);
+	draw_elements();
 	// glDrawArrays(MODE, 0, point_count);
 	vao.unbind();
 }
@@ -0,0 +1,219 @@
+#include "mesh_file.h"
+#include "mapped_file.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+namespace {
+// files are split into line-aligned chunks of at least this many bytes
+constexpr size_t MIN_CHUNK_BYTES = 1 << 20;
+
+constexpr size_t NO_ERROR = std::numeric_limits<size_t>::max();
+
+struct ParseError {
+	size_t line = NO_ERROR, column = 0;
+	std::string message;
+};
+
+bool is_space(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+const char *skip_spaces(const char *p, const char *end) {
+	while (p < end && is_space(*p))
+		++p;
+	return p;
+}
+
+const char *line_end(const char *p, const char *end) {
+	if (p >= end)
+		return end;
+	const char *newline = static_cast<const char *>(std::memchr(p, '\n', end - p));
+	return newline ? newline : end;
+}
+
+bool is_blank(const char *begin, const char *end) { return skip_spaces(begin, end) == end; }
+
+// Parses one line, reports errors with their 1-based line and column.
+class LineParser {
+	const char *begin, *p, *end;
+	size_t line;
+	ParseError &error;
+
+  public:
+	LineParser(const char *begin, const char *end, size_t line, ParseError &error)
+		: begin(begin), p(begin), end(end), line(line), error(error) {}
+
+	bool fail(const char *at, const std::string &message) {
+		error.line = line;
+		error.column = at - begin + 1;
+		error.message = message;
+		return false;
+	}
+
+	template <class T> bool number(T &out, const char *what) {
+		p = skip_spaces(p, end);
+		const auto [next, ec] = std::from_chars(p, end, out);
+		if (ec == std::errc::result_out_of_range)
+			return fail(p, std::string(what) + " is out of range");
+		if (ec != std::errc() || (next < end && !is_space(*next)))
+			return fail(p, std::string("expected ") + what);
+		p = next;
+		return true;
+	}
+
+	bool finish(const char *what) {
+		p = skip_spaces(p, end);
+		return p == end || fail(p, std::string("unexpected text after ") + what);
+	}
+};
+
+struct Chunk {
+	const char *begin, *end;
+	// filled by the counting pass
+	size_t records = 0, lines = 0;
+	// first record and line number of the chunk
+	size_t first_record = 0, first_line = 0;
+	ParseError error = {};
+};
+
+template <class F> void for_each_chunk(std::vector<Chunk> &chunks, F &&body) {
+	ThreadPool::shared().parallel_chunks(chunks.size(), 1, 1, [&](size_t, size_t begin, size_t end) {
+		for (size_t c = begin; c < end; ++c)
+			body(chunks[c]);
+	});
+}
+
+[[noreturn]] void throw_error(const char *filename, const ParseError &error) {
+	throw std::invalid_argument(std::string(filename) + ":" + std::to_string(error.line) + ":" +
+								std::to_string(error.column) + ": " + error.message);
+}
+} // namespace
+
+// The file is one record per line: the vertex count, a line of 8 numbers per
+// vertex, the triangle count and a line of 3 indices per triangle. Blank lines
+// are skipped. After the vertex count the rest is split into line-aligned
+// chunks; a first pass counts the records of every chunk, which gives every
+// line its record index, and a second pass parses the chunks straight into
+// the output arrays.
+MeshFileData read_mesh_file(const char *filename) {
+	MappedFile file(filename);
+	const char *p = file.data(), *const end = p + file.size();
+	ParseError error;
+
+	// vertex count
+	size_t line = 1;
+	while (p < end && is_blank(p, line_end(p, end))) {
+		p = std::min(end, line_end(p, end) + 1);
+		++line;
+	}
+	const char *header_end = line_end(p, end);
+	unsigned int vertex_count = 0;
+	{
+		LineParser parser(p, header_end, line, error);
+		if (!parser.number(vertex_count, "vertex count") || !parser.finish("vertex count"))
+			throw_error(filename, error);
+	}
+	const char *body = header_end < end ? header_end + 1 : end;
+
+	// chunk borders are moved forward to the next line start
+	const size_t body_size = end - body;
+	const size_t chunk_total = ThreadPool::shared().chunk_count(body_size, MIN_CHUNK_BYTES);
+	std::vector<Chunk> chunks;
+	const char *chunk_begin = body;
+	for (size_t c = 1; c <= chunk_total && chunk_begin < end; ++c) {
+		const char *chunk_end = c == chunk_total ? end : body + body_size * c / chunk_total;
+		if (chunk_end < chunk_begin)
+			chunk_end = chunk_begin;
+		chunk_end = chunk_end < end ? std::min(end, line_end(chunk_end, end) + 1) : end;
+		chunks.push_back({chunk_begin, chunk_end});
+		chunk_begin = chunk_end;
+	}
+
+	for_each_chunk(chunks, [](Chunk &chunk) {
+		for (const char *s = chunk.begin; s < chunk.end;) {
+			const char *e = line_end(s, chunk.end);
+			chunk.records += !is_blank(s, e);
+			chunk.lines += e < chunk.end;
+			s = e + 1;
+		}
+	});
+
+	size_t records = 0, lines = line + 1;
+	for (auto &chunk : chunks) {
+		chunk.first_record = records;
+		chunk.first_line = lines;
+		records += chunk.records;
+		lines += chunk.lines;
+	}
+
+	// counts are validated before anything is allocated
+	if (records <= vertex_count) {
+		error.line = lines;
+		error.column = 1;
+		error.message = records < vertex_count ? "file ends after " + std::to_string(records) + " of " +
+													 std::to_string(vertex_count) + " vertices"
+											   : "missing triangle count";
+		throw_error(filename, error);
+	}
+	const size_t triangle_count = records - vertex_count - 1;
+
+	MeshFileData data;
+	data.vertices.resize(vertex_count);
+	data.normals.resize(vertex_count);
+	data.uvs.resize(vertex_count);
+	data.indices.resize(triangle_count);
+
+	// only the chunk holding record vertex_count writes these
+	unsigned int declared_triangles = 0;
+	size_t declared_triangles_line = 0;
+
+	for_each_chunk(chunks, [&](Chunk &chunk) {
+		size_t record = chunk.first_record, line = chunk.first_line;
+		for (const char *s = chunk.begin; s < chunk.end; ++line) {
+			const char *e = line_end(s, chunk.end);
+			if (!is_blank(s, e)) {
+				LineParser parser(s, e, line, chunk.error);
+				bool ok;
+				if (record < vertex_count) {
+					Vector3 &v = data.vertices[record], &n = data.normals[record];
+					Vector2 &uv = data.uvs[record];
+					ok = parser.number(v.x, "position") && parser.number(v.y, "position") &&
+						 parser.number(v.z, "position") && parser.number(n.x, "normal") &&
+						 parser.number(n.y, "normal") && parser.number(n.z, "normal") &&
+						 parser.number(uv.x, "uv") && parser.number(uv.y, "uv") && parser.finish("vertex");
+				} else if (record == vertex_count) {
+					ok = parser.number(declared_triangles, "triangle count") && parser.finish("triangle count");
+					declared_triangles_line = line;
+				} else {
+					IndexTriple &t = data.indices[record - vertex_count - 1];
+					ok = parser.number(t.i, "index") && parser.number(t.j, "index") &&
+						 parser.number(t.k, "index") && parser.finish("triangle");
+					if (ok && (t.i >= vertex_count || t.j >= vertex_count || t.k >= vertex_count))
+						ok = parser.fail(s, "index out of range, the mesh has " + std::to_string(vertex_count) +
+												" vertices");
+				}
+				if (!ok)
+					return;
+				++record;
+			}
+			s = e + 1;
+		}
+	});
+
+	for (const auto &chunk : chunks)
+		if (chunk.error.line != NO_ERROR)
+			throw_error(filename, chunk.error);
+
+	if (declared_triangles != triangle_count) {
+		error.line = declared_triangles_line;
+		error.column = 1;
+		error.message = "triangle count is " + std::to_string(declared_triangles) + " but the file has " +
+						std::to_string(triangle_count) + " triangles";
+		throw_error(filename, error);
+	}
+
+	return data;
+}
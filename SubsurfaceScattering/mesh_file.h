@@ -0,0 +1,19 @@
+#pragma once
+
+#include "algebra.h"
+#include <vector>
+
+// Contents of a text mesh file (models/duck.txt), one record per line: vertex
+// count, then position, normal and uv of every vertex, then triangle count and
+// index triples.
+struct MeshFileData {
+	std::vector<Vector3> vertices;
+	std::vector<Vector3> normals;
+	std::vector<Vector2> uvs;
+	std::vector<IndexTriple> indices;
+};
+
+// Large files are parsed on all hardware threads. Throws std::invalid_argument
+// when the file can't be opened, and with "file:line:column: message" when it
+// is malformed or the counts don't match its contents.
+MeshFileData read_mesh_file(const char *filename);
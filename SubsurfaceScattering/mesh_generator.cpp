@@ -1,10 +1,37 @@
 #include "mesh_generator.h"
-#include <tuple>
-#include <fstream>
+#include "image_loader.h"
+#include "mesh_file.h"
+#include "mesh_simplifier.h"
+#include "startup_stats.h"
+#include <chrono>
+#include <future>
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
-#include <bmpmini.hpp>
+
+namespace {
+// Builds the levels of detail of a loaded mesh and lists them in the startup
+// stats.
+LodChain build_lods(const char *filename, const std::vector<Vector3> &vertices,
+					const std::vector<Vector3> &normals,
+					const std::vector<Vector2> &uvs,
+					const std::vector<IndexTriple> &indices) {
+	const auto start = std::chrono::steady_clock::now();
+	LodChain chain = build_lod_chain(vertices, normals, uvs, indices);
+	const float time = std::chrono::duration<float, std::milli>(
+						   std::chrono::steady_clock::now() - start)
+						   .count();
+
+	startup_stats::add(std::string("LODs ") + filename + " (" +
+						   std::to_string(chain.levels.size()) + " levels, " +
+						   std::to_string(chain.levels.front().index_count / 3) +
+						   " to " +
+						   std::to_string(chain.levels.back().index_count / 3) +
+						   " triangles)",
+					   time);
+	return chain;
+}
+} // namespace
 
 void MeshGenerator::generate_grid(LineMesh& mesh, unsigned int half_x_count, unsigned int half_z_count, float x_length, float z_length)
 {
@@ -38,55 +65,23 @@ void MeshGenerator::generate_grid(LineMesh& mesh, unsigned int half_x_count, uns
 
 void MeshGenerator::load_from_file(TriMesh& mesh, const char* filename, bool normalize)
 {
-	std::ifstream s(filename);
-
-	if (!s.good())
-		throw std::invalid_argument("Couldn't open file");
-
-	int vertexCount;
-	s >> vertexCount;
-
-	std::vector<Vector3> vertices(vertexCount);
-	std::vector<Vector3> normals(vertexCount);
-	std::vector<Vector2> texCoords(vertexCount);
-
-	for (int i = 0; i < vertexCount; ++i)
-	{
-		s >> vertices[i].x >> vertices[i].y >> vertices[i].z
-			>> normals[i].x >> normals[i].y >> normals[i].z
-			>> texCoords[i].x >> texCoords[i].y;
-	}
-
-	int triangleCount;
-	s >> triangleCount;
-
-	std::vector<IndexTriple> indices(triangleCount);
-	for (int i = 0; i < triangleCount; ++i)
-	{
-		IndexTriple t;
-		s >> t.i >> t.j >> t.k;
-		indices[i] = t;
-	}
+	MeshFileData data = read_mesh_file(filename);
+	auto& vertices = data.vertices;
+	const auto& normals = data.normals;
+	const auto& indices = data.indices;
 
 	if (normalize)
 	{
-		float max_coord = 0.0f;
-		for (int i = 0; i < vertices.size(); ++i)
-		{
-			max_coord = std::max(std::abs(vertices[i].x), max_coord);
-			max_coord = std::max(std::abs(vertices[i].y), max_coord);
-			max_coord = std::max(std::abs(vertices[i].z), max_coord);
-		}
+		const float max_coord = vertex_kernels::max_abs_coordinate(vertices.data(), vertices.size());
 		const float scale = 0.5f / max_coord;
 		Vector3 half = { 0.5f,0.25f,0.5f }; // y is 0.25f only for duck model (normally should be 0.5f)
-		for (int i = 0; i < vertices.size(); ++i)
-		{
-			vertices[i] = scale * vertices[i] + half;
-		}
+		vertex_kernels::scale_offset(vertices.data(), vertices.data(), vertices.size(), scale, half);
 	}
 
-	mesh.set_data(vertices, indices);
-	mesh.set_normals(normals);
+	const LodChain lods = build_lods(filename, vertices, normals, {}, indices);
+	mesh.set_data(lods.vertices, lods.indices);
+	mesh.set_lods(lods.levels);
+	mesh.set_normals(lods.normals);
 }
 
 void MeshGenerator::load_from_common_file(TriMesh &mesh, const char *filename) {
@@ -121,8 +116,10 @@ void MeshGenerator::load_from_common_file(TriMesh &mesh, const char *filename) {
 		indices[i] = {face.mIndices[0], face.mIndices[1], face.mIndices[2]};
 	}
 
-	mesh.set_data(vertices, indices);
-	mesh.set_normals(normals);
+	const LodChain lods = build_lods(filename, vertices, normals, {}, indices);
+	mesh.set_data(lods.vertices, lods.indices);
+	mesh.set_lods(lods.levels);
+	mesh.set_normals(lods.normals);
 }
 
 void MeshGenerator::load_from_common_file(TexturedTriMesh &mesh,
@@ -160,39 +157,54 @@ void MeshGenerator::load_from_common_file(TexturedTriMesh &mesh,
 		indices[i] = {face.mIndices[0], face.mIndices[1], face.mIndices[2]};
 	}
 
-	mesh.set_data(vertices, indices);
-	mesh.set_normals(normals);
-	mesh.set_uvs(uvs);
-}
-
-std::tuple<int, int, std::vector<Vector4>> load_bmp(const char *filename) {
-	image::BMPMini bmp;
-	bmp.read(filename);
-	auto img = bmp.get();
-	std::vector<Vector4> imageVec(img.width * img.height);
-	for (int i = 0; i < imageVec.size(); ++i) {
-		imageVec[i] = {img.data[3 * i + 2] / 255.0f,
-					   img.data[3 * i + 1] / 255.0f, img.data[3 * i] / 255.0f,
-					   1.0f};
-	}
-	return {img.width, img.height, imageVec};
+	const LodChain lods = build_lods(filename, vertices, normals, uvs, indices);
+	mesh.set_data(lods.vertices, lods.indices);
+	mesh.set_lods(lods.levels);
+	mesh.set_normals(lods.normals);
+	mesh.set_uvs(lods.uvs);
 }
 
 void MeshGenerator::load_textures(TexturedTriMesh &mesh,
 								  const char *color_texture,
 								  const char *normal_texture) {
-	const auto colors = load_bmp(color_texture);
-	const auto cnormals = load_bmp(normal_texture);
-
-	mesh.set_color_texture(std::get<0>(colors), std::get<1>(colors),
-						   std::get<2>(colors).data());
-	mesh.set_normal_texture(std::get<0>(cnormals), std::get<1>(cnormals),
-							std::get<2>(cnormals).data());
-	}
+	using Clock = std::chrono::steady_clock;
+	const auto milliseconds = [](Clock::time_point start) {
+		return std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+	};
+	const auto start = Clock::now();
+
+	// both textures are decoded at once, the GL upload stays on this thread
+	float normals_time = 0.0f;
+	auto normals = std::async(std::launch::async, [&]() {
+		const auto normals_start = Clock::now();
+		Image image = load_image(normal_texture);
+		normals_time = milliseconds(normals_start);
+		return image;
+	});
+	const Image colors = load_image(color_texture);
+	const float colors_time = milliseconds(start);
+	const Image cnormals = normals.get();
+
+	mesh.set_color_texture(colors);
+	mesh.set_normal_texture(cnormals);
+
+	const float total_time = milliseconds(start);
+	startup_stats::add(std::string("decode ") + color_texture, colors_time);
+	startup_stats::add(std::string("decode ") + normal_texture, normals_time);
+	startup_stats::add(std::string("decode and upload ") + color_texture + ", " + normal_texture, total_time);
+}
 
 void MeshGenerator::generate_cube(TriMesh& mesh)
 {
-	std::vector<Vector3> cube_points = {
+	std::vector<Vector3> cube_points, cube_normals;
+	get_cube(cube_points, cube_normals);
+	mesh.set_data(cube_points);
+	mesh.set_normals(cube_normals);
+}
+
+void MeshGenerator::get_cube(std::vector<Vector3>& cube_points, std::vector<Vector3>& cube_normals)
+{
+	cube_points = {
 		{0.0f, 1.0f, 0.0f}, {1.0f, 1.0f, 1.0f}, {1.0f, 1.0f, 0.0f},
 		{0.0f, 1.0f, 0.0f}, {0.0f, 1.0f, 1.0f}, {1.0f, 1.0f, 1.0f},//top
 		{0.0f, 0.0f, 0.0f}, {1.0f, 0.0f, 0.0f}, {1.0f, 0.0f, 1.0f},
@@ -208,7 +220,7 @@ void MeshGenerator::generate_cube(TriMesh& mesh)
 		{0.0f, 0.0f, 1.0f}, {1.0f, 1.0f, 1.0f}, {0.0f, 1.0f, 1.0f},
 		{0.0f, 0.0f, 1.0f}, {1.0f, 0.0f, 1.0f}, {1.0f, 1.0f, 1.0f},//back
 	};
-	std::vector<Vector3> cube_normals = {
+	cube_normals = {
 		{0.0f, 1.0f, 0.0f}, {0.0f, 1.0f, 0.0f}, {0.0f, 1.0f, 0.0f},
 		{0.0f, 1.0f, 0.0f}, {0.0f, 1.0f, 0.0f}, {0.0f, 1.0f, 0.0f},//top
 		{0.0f, -1.0f, 0.0f}, {0.0f, -1.0f, 0.0f}, {0.0f, -1.0f, 0.0f},
@@ -224,8 +236,6 @@ void MeshGenerator::generate_cube(TriMesh& mesh)
 		{0.0f, 0.0f, 1.0f}, {0.0f, 0.0f, 1.0f}, {0.0f, 0.0f, 1.0f},
 		{0.0f, 0.0f, 1.0f}, {0.0f, 0.0f, 1.0f}, {0.0f, 0.0f, 1.0f},//back
 	};
-	mesh.set_data(cube_points);
-	mesh.set_normals(cube_normals);
 }
 
 void MeshGenerator::generate_inverted_cube(TriMesh& mesh)
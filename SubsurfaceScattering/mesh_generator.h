@@ -16,6 +16,9 @@ class MeshGenerator {
 	static void load_textures(TexturedTriMesh &mesh, const char *color_texture,
 							  const char *normal_texture);
 	static void generate_cube(TriMesh &mesh);
+	// vertices of generate_cube, the unit cube as separate triangles
+	static void get_cube(std::vector<Vector3> &points,
+						 std::vector<Vector3> &normals);
 	static void generate_inverted_cube(TriMesh &mesh);
 	static void generate_cylinder(TriMesh &mesh, float radius, float height,
 								  unsigned int circle_divisions);
@@ -0,0 +1,331 @@
+#include "mesh_simplifier.h"
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <numeric>
+#include <tuple>
+
+namespace {
+// Symmetric 4x4 matrix of the plane quadrics, upper triangle in row order.
+struct Quadric {
+	double a[10] = {};
+
+	static Quadric plane(double x, double y, double z, double w) {
+		return {{x * x, x * y, x * z, x * w, y * y, y * z, y * w, z * z, z * w, w * w}};
+	}
+
+	Quadric &operator+=(const Quadric &q) {
+		for (int i = 0; i < 10; ++i)
+			a[i] += q.a[i];
+		return *this;
+	}
+
+	// sum of squared distances of p to the planes
+	double error(const Vector3 &p) const {
+		const double x = p.x, y = p.y, z = p.z;
+		const double e = a[0] * x * x + 2 * a[1] * x * y + 2 * a[2] * x * z + 2 * a[3] * x + a[4] * y * y +
+						 2 * a[5] * y * z + 2 * a[6] * y + a[7] * z * z + 2 * a[8] * z + a[9];
+		return std::max(e, 0.0);
+	}
+};
+
+struct Collapse {
+	unsigned int from, to;
+	double cost;
+};
+
+// Indices of the vertices sorted with less, and the run (group) of equal
+// vertices every vertex belongs to.
+template <class Less, class Equal>
+std::vector<unsigned int> group_equal(size_t count, Less &&less, Equal &&equal, unsigned int &group_count) {
+	std::vector<unsigned int> order(count);
+	std::iota(order.begin(), order.end(), 0u);
+	std::sort(order.begin(), order.end(), less);
+
+	std::vector<unsigned int> group(count);
+	group_count = 0;
+	for (size_t i = 0; i < count; ++i) {
+		if (i > 0 && !equal(order[i - 1], order[i]))
+			++group_count;
+		group[order[i]] = group_count;
+	}
+	if (count > 0)
+		++group_count;
+	return group;
+}
+
+class Simplifier {
+	const std::vector<Vector3> &positions;
+	const std::vector<Vector2> &uvs;
+	// vertices with the same position share a group
+	std::vector<unsigned int> group;
+	// only vertices alone in their group, not on a border, may be collapsed
+	std::vector<bool> movable;
+	std::vector<Quadric> quadrics;
+
+	// vertex -> triangles, rebuilt every pass
+	std::vector<unsigned int> adjacency_offsets, adjacency;
+	// scratch space of is_valid
+	std::vector<unsigned int> from_neighbours, to_neighbours, common;
+
+	void build_adjacency(const std::vector<IndexTriple> &triangles) {
+		adjacency_offsets.assign(positions.size() + 1, 0);
+		for (const auto &t : triangles)
+			for (unsigned int v : {t.i, t.j, t.k})
+				++adjacency_offsets[v + 1];
+		std::partial_sum(adjacency_offsets.begin(), adjacency_offsets.end(), adjacency_offsets.begin());
+		adjacency.resize(3 * triangles.size());
+		std::vector<unsigned int> fill(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+		for (unsigned int t = 0; t < triangles.size(); ++t)
+			for (unsigned int v : {triangles[t].i, triangles[t].j, triangles[t].k})
+				adjacency[fill[v]++] = t;
+	}
+
+	template <class F> void for_each_adjacent(unsigned int v, F &&f) const {
+		for (unsigned int a = adjacency_offsets[v]; a < adjacency_offsets[v + 1]; ++a)
+			f(adjacency[a]);
+	}
+
+	static bool contains(const IndexTriple &t, unsigned int v) { return t.i == v || t.j == v || t.k == v; }
+
+	static IndexTriple replaced(IndexTriple t, unsigned int from, unsigned int to) {
+		for (unsigned int *v : {&t.i, &t.j, &t.k})
+			if (*v == from)
+				*v = to;
+		return t;
+	}
+
+	Vector3 normal(const IndexTriple &t) const {
+		return cross(positions[t.j] - positions[t.i], positions[t.k] - positions[t.i]);
+	}
+
+	float uv_area(const IndexTriple &t) const {
+		const Vector2 &a = uvs[t.i], &b = uvs[t.j], &c = uvs[t.k];
+		return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+	}
+
+	// Rejects collapses that make the fan of from non-manifold or flip one of
+	// its triangles.
+	bool is_valid(const std::vector<IndexTriple> &triangles, const Collapse &c) {
+		from_neighbours.clear();
+		to_neighbours.clear();
+		common.clear();
+		int shared_triangles = 0;
+		bool valid = true;
+		for_each_adjacent(c.from, [&](unsigned int t) {
+			const IndexTriple &before = triangles[t];
+			for (unsigned int v : {before.i, before.j, before.k})
+				if (v != c.from)
+					from_neighbours.push_back(group[v]);
+			if (contains(before, c.to)) {
+				++shared_triangles;
+				return;
+			}
+
+			const IndexTriple after = replaced(before, c.from, c.to);
+			const Vector3 n0 = normal(before), n1 = normal(after);
+			if (dot(n0, n1) <= 0.25f * n0.length() * n1.length() || n1.length() == 0.0f)
+				valid = false;
+			if (!uvs.empty() && uv_area(before) * uv_area(after) <= 0.0f)
+				valid = false;
+		});
+		if (!valid || shared_triangles != 2)
+			return false;
+
+		// link condition: the edge's only common neighbours are the two
+		// vertices opposite to it
+		for_each_adjacent(c.to, [&](unsigned int t) {
+			for (unsigned int v : {triangles[t].i, triangles[t].j, triangles[t].k})
+				if (v != c.to)
+					to_neighbours.push_back(group[v]);
+		});
+		std::sort(from_neighbours.begin(), from_neighbours.end());
+		from_neighbours.erase(std::unique(from_neighbours.begin(), from_neighbours.end()), from_neighbours.end());
+		std::sort(to_neighbours.begin(), to_neighbours.end());
+		to_neighbours.erase(std::unique(to_neighbours.begin(), to_neighbours.end()), to_neighbours.end());
+		std::set_intersection(from_neighbours.begin(), from_neighbours.end(), to_neighbours.begin(),
+							  to_neighbours.end(), std::back_inserter(common));
+		return common.size() == 2;
+	}
+
+  public:
+	Simplifier(const std::vector<Vector3> &positions, const std::vector<Vector2> &uvs,
+			   const std::vector<IndexTriple> &triangles)
+		: positions(positions), uvs(uvs) {
+		const size_t count = positions.size();
+		unsigned int group_count;
+		group = group_equal(
+			count,
+			[&](unsigned int a, unsigned int b) {
+				const Vector3 &p = positions[a], &q = positions[b];
+				return std::tie(p.x, p.y, p.z) < std::tie(q.x, q.y, q.z);
+			},
+			[&](unsigned int a, unsigned int b) {
+				const Vector3 &p = positions[a], &q = positions[b];
+				return p.x == q.x && p.y == q.y && p.z == q.z;
+			},
+			group_count);
+
+		// vertices sharing a position differ in uv or normal, i.e. lie on a seam
+		std::vector<unsigned int> group_size(group_count, 0);
+		for (size_t v = 0; v < count; ++v)
+			++group_size[group[v]];
+
+		// edges used by other than two triangles lock their vertices
+		std::vector<std::pair<unsigned int, unsigned int>> edges;
+		edges.reserve(3 * triangles.size());
+		for (const auto &t : triangles) {
+			const unsigned int g[3] = {group[t.i], group[t.j], group[t.k]};
+			for (int e = 0; e < 3; ++e)
+				edges.emplace_back(std::min(g[e], g[(e + 1) % 3]), std::max(g[e], g[(e + 1) % 3]));
+		}
+		std::sort(edges.begin(), edges.end());
+		std::vector<bool> locked_group(group_count, false);
+		for (size_t i = 0; i < edges.size();) {
+			size_t j = i;
+			while (j < edges.size() && edges[j] == edges[i])
+				++j;
+			if (j - i != 2)
+				locked_group[edges[i].first] = locked_group[edges[i].second] = true;
+			i = j;
+		}
+
+		movable.resize(count);
+		for (size_t v = 0; v < count; ++v)
+			movable[v] = group_size[group[v]] == 1 && !locked_group[group[v]];
+
+		quadrics.resize(group_count);
+		for (const auto &t : triangles) {
+			Vector3 n = normal(t);
+			const float length = n.length();
+			if (length == 0.0f)
+				continue;
+			n *= 1.0f / length;
+			const Quadric q = Quadric::plane(n.x, n.y, n.z, -dot(n, positions[t.i]));
+			for (unsigned int v : {t.i, t.j, t.k})
+				quadrics[group[v]] += q;
+		}
+	}
+
+	// Collapses edges of triangles, cheapest first, until at most target
+	// triangles are left or no valid collapse remains. Returns the largest
+	// error of a collapse made.
+	double simplify(std::vector<IndexTriple> &triangles, size_t target) {
+		double max_error = 0.0;
+		std::vector<Collapse> collapses;
+		std::vector<bool> locked;
+
+		while (triangles.size() > target) {
+			build_adjacency(triangles);
+
+			collapses.clear();
+			for (const auto &t : triangles) {
+				const unsigned int v[3] = {t.i, t.j, t.k};
+				for (int e = 0; e < 3; ++e) {
+					// interior edges show up in both of their triangles, once
+					// in each direction, only the cheaper one is kept
+					const unsigned int a = v[e], b = v[(e + 1) % 3];
+					if (a > b && (movable[a] || movable[b]))
+						continue;
+					Quadric q = quadrics[group[a]];
+					q += quadrics[group[b]];
+					const double a_to_b = movable[a] ? q.error(positions[b]) : INFINITY;
+					const double b_to_a = movable[b] ? q.error(positions[a]) : INFINITY;
+					if (a_to_b <= b_to_a && movable[a])
+						collapses.push_back({a, b, a_to_b});
+					else if (movable[b])
+						collapses.push_back({b, a, b_to_a});
+				}
+			}
+			std::sort(collapses.begin(), collapses.end(),
+					  [](const Collapse &a, const Collapse &b) { return a.cost < b.cost; });
+
+			// a collapse locks every vertex of the changed triangles for the
+			// rest of the pass, so that adjacency stays valid for the others
+			locked.assign(positions.size(), false);
+			size_t remaining = triangles.size();
+			bool collapsed = false;
+			for (const auto &c : collapses) {
+				if (remaining <= target)
+					break;
+				if (locked[c.from] || locked[c.to] || !is_valid(triangles, c))
+					continue;
+
+				for_each_adjacent(c.from, [&](unsigned int t) {
+					for (unsigned int v : {triangles[t].i, triangles[t].j, triangles[t].k})
+						locked[v] = true;
+					triangles[t] = replaced(triangles[t], c.from, c.to);
+				});
+				quadrics[group[c.to]] += quadrics[group[c.from]];
+				max_error = std::max(max_error, c.cost);
+				remaining -= 2;
+				collapsed = true;
+			}
+
+			triangles.erase(std::remove_if(triangles.begin(), triangles.end(),
+										   [&](const IndexTriple &t) {
+											   return group[t.i] == group[t.j] || group[t.j] == group[t.k] ||
+													  group[t.k] == group[t.i];
+										   }),
+							triangles.end());
+			if (!collapsed)
+				break;
+		}
+		return max_error;
+	}
+};
+} // namespace
+
+LodChain build_lod_chain(const std::vector<Vector3> &vertices, const std::vector<Vector3> &normals,
+						 const std::vector<Vector2> &uvs, const std::vector<IndexTriple> &indices,
+						 const LodOptions &options) {
+	const bool has_uvs = !uvs.empty();
+	const auto key = [&](unsigned int v) {
+		const Vector3 &p = vertices[v], &n = normals[v];
+		const Vector2 uv = has_uvs ? uvs[v] : Vector2{0.0f, 0.0f};
+		return std::make_tuple(p.x, p.y, p.z, n.x, n.y, n.z, uv.x, uv.y);
+	};
+
+	// merge identical vertices, importers often keep one per face corner
+	unsigned int vertex_count;
+	const auto remap = group_equal(
+		vertices.size(), [&](unsigned int a, unsigned int b) { return key(a) < key(b); },
+		[&](unsigned int a, unsigned int b) { return key(a) == key(b); }, vertex_count);
+
+	LodChain chain;
+	chain.vertices.resize(vertex_count);
+	chain.normals.resize(vertex_count);
+	if (has_uvs)
+		chain.uvs.resize(vertex_count);
+	for (size_t v = 0; v < vertices.size(); ++v) {
+		chain.vertices[remap[v]] = vertices[v];
+		chain.normals[remap[v]] = normals[v];
+		if (has_uvs)
+			chain.uvs[remap[v]] = uvs[v];
+	}
+
+	std::vector<IndexTriple> triangles;
+	triangles.reserve(indices.size());
+	for (const auto &t : indices) {
+		const IndexTriple r = {remap[t.i], remap[t.j], remap[t.k]};
+		if (r.i != r.j && r.j != r.k && r.k != r.i)
+			triangles.push_back(r);
+	}
+
+	Simplifier simplifier(chain.vertices, chain.uvs, triangles);
+	float error = 0.0f;
+	while (true) {
+		chain.levels.push_back({3 * chain.indices.size(), 3 * triangles.size(), error});
+		chain.indices.insert(chain.indices.end(), triangles.begin(), triangles.end());
+
+		if (static_cast<int>(chain.levels.size()) >= options.max_levels || triangles.size() <= options.min_triangles)
+			break;
+		const size_t previous = triangles.size();
+		const size_t target = std::max(options.min_triangles, static_cast<size_t>(previous * options.ratio));
+		error = std::max(error, static_cast<float>(std::sqrt(simplifier.simplify(triangles, target))));
+		// a level that barely shrank isn't worth its memory
+		if (triangles.size() > previous - (previous - target) / 2)
+			break;
+	}
+	return chain;
+}
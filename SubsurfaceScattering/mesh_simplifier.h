@@ -0,0 +1,42 @@
+#pragma once
+
+#include "algebra.h"
+#include <cstddef>
+#include <vector>
+
+// One level of detail, a range of the index buffer shared by all levels.
+struct LodLevel {
+	// in indices, not triangles
+	size_t first_index = 0, index_count = 0;
+	// how far the surface may have moved from the full mesh, in model units
+	float error = 0.0f;
+};
+
+struct LodChain {
+	// input vertices with identical position, normal and uv merged, used by
+	// all levels
+	std::vector<Vector3> vertices;
+	std::vector<Vector3> normals;
+	// empty if the input had no uvs
+	std::vector<Vector2> uvs;
+	// triangles of all levels, finest first
+	std::vector<IndexTriple> indices;
+	std::vector<LodLevel> levels;
+};
+
+struct LodOptions {
+	int max_levels = 5;
+	// triangle count of every level relative to the previous one
+	float ratio = 0.5f;
+	// levels aren't simplified below this many triangles
+	size_t min_triangles = 512;
+};
+
+// Builds a chain of levels of detail with quadric error metric edge
+// collapses. Vertices are only collapsed onto other vertices, never moved, so
+// every level indexes the same vertex array. Vertices on UV seams, hard
+// normal edges and mesh borders are kept in place, and collapses that flip a
+// triangle in space or in UV space are rejected. uvs may be empty.
+LodChain build_lod_chain(const std::vector<Vector3> &vertices, const std::vector<Vector3> &normals,
+						 const std::vector<Vector2> &uvs, const std::vector<IndexTriple> &indices,
+						 const LodOptions &options = {});
@@ -20,7 +20,7 @@ struct Quaternion
 	T* data() { return &w; }
 };
 
-static_assert(std::is_pod_v<Quaternion<float>>, "Quaternion needs to be POD, but it's not");
+static_assert(std::is_standard_layout_v<Quaternion<float>> && std::is_trivial_v<Quaternion<float>>, "Quaternion needs to be POD, but it's not");
 
 template <class T>
 Quaternion<T> operator+(const Quaternion<T>& q1, const Quaternion<T>& q2) {
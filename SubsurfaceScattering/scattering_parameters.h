@@ -9,6 +9,9 @@ class ScatteringParameters {
 	Light light;
 	mutable Camera light_camera;
 	int rendered_mesh_idx = 0;
+	// deformed cubes from precomputed Bernstein weights on the CPU instead
+	// of de Casteljau in the compute shader
+	bool cpu_deformation = false;
 	float wrap = 0.0f;
 	float scatter_width = 0.8f;
 	float scatter_power = 0.0f;
@@ -19,4 +22,14 @@ class ScatteringParameters {
 	float sigma_t = 1.0f;
 	float grow = 0.0f;
     float diffuse_blur = 0.0f;
+	bool visibility_culling = true;
+	bool amortised_diffuse = false;
+	float diffuse_budget_ms = 2.0f;
+	float diffuse_blend = 0.5f;
+	float diffuse_invalidate_threshold = 0.1f;
+	bool use_lods = true;
+	// largest screen space error of the selected level of detail, in pixels
+	// of the view and in texels of the depth map
+	float lod_error_pixels = 1.0f;
+	float depth_map_lod_error_pixels = 4.0f;
 };
@@ -1,4 +1,5 @@
 #include "scattering_parameters_window.h"
+#include "startup_stats.h"
 
 ScatteringParametersWindow::ScatteringParametersWindow(
 	ScatteringParameters &parameters)
@@ -28,14 +29,53 @@ void ScatteringParametersWindow::build() {
 	ImGui::SliderFloat("sigma_t", &parameters.sigma_t, 0.0f, 5.0f);
 	ImGui::DragFloat("Diffuse blur", &parameters.diffuse_blur, 0.00001f, 0.0f,
 					 0.003f, "%.5f");
+	ImGui::Checkbox("Cull invisible texels", &parameters.visibility_culling);
+	ImGui::Checkbox("Amortised diffuse pass", &parameters.amortised_diffuse);
+	if (parameters.amortised_diffuse) {
+		ImGui::SliderFloat("Diffuse budget [ms]", &parameters.diffuse_budget_ms,
+						   0.1f, 16.0f);
+		ImGui::SliderFloat("Diffuse blend", &parameters.diffuse_blend, 0.05f,
+						   1.0f);
+		ImGui::SliderFloat("Invalidate threshold",
+						   &parameters.diffuse_invalidate_threshold, 0.0f,
+						   1.0f);
+	}
 
 	ImGui::SeparatorText("Depth map");
 	ImGui::SliderFloat("Grow", &parameters.grow, 0.0f, 0.1f);
 	
 
+	ImGui::SeparatorText("Level of detail");
+	ImGui::Checkbox("Use LODs", &parameters.use_lods);
+	if (parameters.use_lods) {
+		ImGui::SliderFloat("View error [px]", &parameters.lod_error_pixels,
+						   0.1f, 16.0f);
+		ImGui::SliderFloat("Depth map error [texels]",
+						   &parameters.depth_map_lod_error_pixels, 0.1f, 32.0f);
+	}
+
 	ImGui::SeparatorText("Display");
 	ImGui::Combo("Mesh", &parameters.rendered_mesh_idx,
-				 "Cube\0Salt Lamp\0Head\0");
+				 "Cube\0Salt Lamp\0Head\0Deformed Cubes\0");
+	if (parameters.rendered_mesh_idx == 3)
+		ImGui::Checkbox("Deform on the CPU", &parameters.cpu_deformation);
+
+	ImGui::SeparatorText("Frame budget");
+	const auto &budget = get_task_manager().get_budget_statistics();
+	ImGui::Text("Target: %.2f ms, last frame: %.2f ms", budget.target_frame_ms,
+				budget.last_frame_ms);
+	ImGui::Text("Tasks: %.2f ms, rest: %.2f ms", budget.tasks_ms,
+				budget.rest_ms);
+	ImGui::Text("Missed deadlines: %lld of %lld frames",
+				budget.missed_deadlines, budget.frames);
+	ImGui::Text("Deferred steps: %lld", budget.deferred_steps);
+	for (const auto &task : get_task_manager().get_fixed_step_statistics())
+		ImGui::Text("Fixed step task: %.1f of %.1f steps/s, %lld dropped",
+					task.measured_rate, task.target_rate, task.dropped_steps);
+
+	ImGui::SeparatorText("Startup");
+	for (const auto &entry : startup_stats::entries())
+		ImGui::Text("%s: %.1f ms", entry.name.c_str(), entry.milliseconds);
 
 	ImGui::End();
 }
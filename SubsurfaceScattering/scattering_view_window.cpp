@@ -1,9 +1,15 @@
 #include "scattering_view_window.h"
 #include "mesh_generator.h"
+#include <cmath>
+
+namespace {
+constexpr size_t DEFORMED_COUNT = 4;
+constexpr float DEFORMED_SPACING = 1.5f;
+} // namespace
 
 ScatteringViewWindow::ScatteringViewWindow(
-	const ScatteringParameters &parameters)
-	: parameters(parameters), light(ShaderType::Simple),
+	const ScatteringParameters &parameters, Flythrough &flythrough)
+	: parameters(parameters), flythrough(flythrough), light(ShaderType::Simple),
 	  mesh(ShaderType::Phong), salt(), head() {
 	name = "View";
 
@@ -45,6 +51,45 @@ ScatteringViewWindow::ScatteringViewWindow(
 	head.color = {1.0f, 1.0f, 1.0f, 1.0f};
 	head.model = Matrix4x4::rotation_x(-5.0f / 12.0f * PI) *
 				 Matrix4x4::uniform_scale(0.03f);
+
+	// the rest vertices are the lattice coordinates, the unit cube
+	std::vector<Vector3> cube_points, cube_normals;
+	MeshGenerator::get_cube(cube_points, cube_normals);
+	deformed.set_data(cube_points);
+	deformed.set_normals(cube_normals);
+	deformed_weights = BernsteinWeights(cube_points.data(), cube_normals.data(), cube_points.size());
+	deformed.color = {0.2f, 0.6f, 1.0f, 1.0f};
+	lattice.patches_visible = false;
+}
+
+// Cubes in a row along x, each twisted about the y axis by an angle growing
+// with the height and swinging with time. The box holds all control points
+// and so, by the convex hull property, the deformed cubes.
+void ScatteringViewWindow::update_lattices(float time) {
+	lattices.resize(DEFORMED_COUNT * CUBE_POINT_COUNT);
+	lattices_box = {INFINITY, -INFINITY, INFINITY, -INFINITY, INFINITY, -INFINITY};
+	for (size_t c = 0; c < DEFORMED_COUNT; ++c) {
+		const float twist = 0.75f * std::sin(time + c);
+		const float x_offset = (c - 0.5f * (DEFORMED_COUNT - 1)) * DEFORMED_SPACING;
+		Vector3 *points = lattices.data() + c * CUBE_POINT_COUNT;
+		for (int k = 0; k < SIDE_DIM; ++k)
+			for (int j = 0; j < SIDE_DIM; ++j)
+				for (int i = 0; i < SIDE_DIM; ++i) {
+					const float x = i / (SIDE_DIM - 1.0f) - 0.5f, y = j / (SIDE_DIM - 1.0f) - 0.5f,
+								z = k / (SIDE_DIM - 1.0f) - 0.5f;
+					const float s = std::sin(twist * y), co = std::cos(twist * y);
+					Vector3 &point = points[i + SIDE_DIM * j + SIDE_DIM * SIDE_DIM * k];
+					point = {co * x + s * z + x_offset, y, co * z - s * x};
+					lattices_box.add(point);
+				}
+	}
+}
+
+void ScatteringViewWindow::select_lods(const Camera &camera, int height,
+									   float error_pixels) {
+	mesh.select_lod(camera, height, error_pixels);
+	salt.select_lod(camera, height, error_pixels);
+	head.select_lod(camera, height, error_pixels);
 }
 
 void ScatteringViewWindow::build() {
@@ -59,16 +104,39 @@ void ScatteringViewWindow::build() {
 		ImGui::GetContentRegionAvail(); // Resize canvas to what's available
 	int width = canvas_sz.x, height = canvas_sz.y;
 
+	flythrough.begin_frame(camera);
+	camera.set_viewport(width, height);
+
+	// the diffuse pass matches the view, so that it covers the same surface
+	const float view_lod_error =
+		parameters.use_lods ? parameters.lod_error_pixels : 0.0f;
+	const float depth_map_lod_error =
+		parameters.use_lods ? parameters.depth_map_lod_error_pixels : 0.0f;
+	select_lods(camera, height, view_lod_error);
+
+	if (parameters.rendered_mesh_idx == 3) {
+		update_lattices(static_cast<float>(ImGui::GetTime()));
+		if (parameters.cpu_deformation) {
+			deformed.deform(deformed_weights, lattices.data(), DEFORMED_COUNT);
+		} else {
+			deformed.set_lattices(lattices.data(), DEFORMED_COUNT);
+			deformed.deform();
+		}
+		lattice.set_data(lattices.data());
+	}
+
+	flythrough.begin_pass(FramePass::Diffuse);
 	switch (parameters.rendered_mesh_idx) {
 	case 0:
 		break;
 	case 1:
-		salt.render_diffuse(camera, parameters);
+		salt.render_diffuse(camera, parameters, width, height);
 		break;
 	case 2:
-		head.render_diffuse(camera, parameters);
+		head.render_diffuse(camera, parameters, width, height);
 		break;
 	}
+	flythrough.end_pass(FramePass::Diffuse);
 
 	texture.bind();
 	texture.set_size(width, height);
@@ -79,6 +147,7 @@ void ScatteringViewWindow::build() {
 	glEnable(GL_BLEND);
 
 	// render depth map
+	flythrough.begin_pass(FramePass::DepthMap);
 	depth_map_fbo.bind();
 	glViewport(0.0f, 0.0f, ScatteringParameters::DEPTH_MAP_SIZE,
 			   ScatteringParameters::DEPTH_MAP_SIZE);
@@ -87,10 +156,14 @@ void ScatteringViewWindow::build() {
 	glDepthFunc(GL_LESS);
 	ShaderLibrary::get_shader(ShaderType::DepthMap).use();
 	glUniform1f(grow_location_dms, parameters.grow);
+	parameters.light_camera.set_viewport(ScatteringParameters::DEPTH_MAP_SIZE,
+										 ScatteringParameters::DEPTH_MAP_SIZE);
 	switch (parameters.rendered_mesh_idx) {
 	case 0:
 		parameters.light_camera.look_from_at_box(parameters.light.position,
 												  mesh.get_bounding_box(), mesh.model);
+		mesh.select_lod(parameters.light_camera,
+						ScatteringParameters::DEPTH_MAP_SIZE, depth_map_lod_error);
 		mesh.render_with_other_shader(parameters.light_camera, parameters,
 									  ScatteringParameters::DEPTH_MAP_SIZE,
 									  ScatteringParameters::DEPTH_MAP_SIZE,
@@ -99,6 +172,8 @@ void ScatteringViewWindow::build() {
 	case 1:
 		parameters.light_camera.look_from_at_box(parameters.light.position,
 												 salt.get_bounding_box(), salt.model);
+		salt.select_lod(parameters.light_camera,
+						ScatteringParameters::DEPTH_MAP_SIZE, depth_map_lod_error);
 		salt.render_with_other_shader(parameters.light_camera, parameters,
 									  ScatteringParameters::DEPTH_MAP_SIZE,
 									  ScatteringParameters::DEPTH_MAP_SIZE,
@@ -107,15 +182,27 @@ void ScatteringViewWindow::build() {
 	case 2:
 		parameters.light_camera.look_from_at_box(parameters.light.position,
 												 head.get_bounding_box(), head.model);
+		head.select_lod(parameters.light_camera,
+						ScatteringParameters::DEPTH_MAP_SIZE, depth_map_lod_error);
 		head.render_with_other_shader(parameters.light_camera, parameters,
 									  ScatteringParameters::DEPTH_MAP_SIZE,
 									  ScatteringParameters::DEPTH_MAP_SIZE,
 									  ShaderType::DepthMap);
 		break;
+	case 3:
+		parameters.light_camera.look_from_at_box(parameters.light.position,
+												 lattices_box, Matrix4x4::identity());
+		deformed.render_deformed(parameters.light_camera, parameters,
+								 ScatteringParameters::DEPTH_MAP_SIZE,
+								 ScatteringParameters::DEPTH_MAP_SIZE,
+								 ShaderType::DepthMap);
+		break;
 	}
 	depth_map_fbo.unbind();
+	flythrough.end_pass(FramePass::DepthMap);
 
 	// render scene
+	flythrough.begin_pass(FramePass::Scene);
 	fbo.bind();
 	glViewport(0, 0, width, height);
 	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
@@ -131,6 +218,7 @@ void ScatteringViewWindow::build() {
 	initial_mesh_model;*/
 
 	// render other objects
+	select_lods(camera, height, view_lod_error);
 	glDepthFunc(GL_LESS);
 	glActiveTexture(GL_TEXTURE3);
 	depth_map_texture.bind();
@@ -144,6 +232,11 @@ void ScatteringViewWindow::build() {
 	case 2:
 		head.render(camera, parameters, width, height);
 		break;
+	case 3:
+		deformed.render_deformed(camera, parameters, width, height);
+		lattice.render_lines(camera, width, height);
+		lattice.render_points(camera, width, height);
+		break;
 	}
 
 	constexpr float light_size = 0.125f;
@@ -157,6 +250,7 @@ void ScatteringViewWindow::build() {
 	light.render_simple(camera, width, height);
 
 	fbo.unbind();
+	flythrough.end_pass(FramePass::Scene);
 
 	glViewport(old_viewport[0], old_viewport[1], old_viewport[2],
 			   old_viewport[3]);
@@ -166,18 +260,21 @@ void ScatteringViewWindow::build() {
 		auto &io = ImGui::GetIO();
 		// zoom using mouse wheel
 		if (io.MouseWheel != 0.0f) {
-			camera.zoom(powf(1.3f, io.MouseWheel));
+			flythrough.zoom(camera, powf(1.3f, io.MouseWheel));
 		}
 		// move scene
 		if (ImGui::IsMouseDragging(ImGuiMouseButton_Left)) {
-			camera.move_by({-io.MouseDelta.x / width * 5.0f,
-							-io.MouseDelta.y / height * 5.0f, 0});
+			flythrough.move_by(camera, {-io.MouseDelta.x / width * 5.0f,
+										-io.MouseDelta.y / height * 5.0f, 0});
 		}
 		// rotate scene
 		if (ImGui::IsMouseDown(ImGuiMouseButton_Right)) {
-			camera.rotate(io.MouseDelta.y * 0.01f, -io.MouseDelta.x * 0.01f, 0);
+			flythrough.rotate(camera, io.MouseDelta.y * 0.01f,
+							  -io.MouseDelta.x * 0.01f, 0);
 		}
 	}
 
+	flythrough.end_frame(width, height);
+
 	ImGui::End();
 }
@@ -2,17 +2,29 @@
 
 #include "window.h"
 #include "mesh.h"
+#include "deformed_mesh.h"
 #include "textured_mesh.h"
 #include "scattering_parameters.h"
+#include "flythrough.h"
 
 class ScatteringViewWindow : public Window {
 	const ScatteringParameters &parameters;
+	Flythrough &flythrough;
 
     TriMesh light;
 	TriMesh mesh;
 	TexturedTriMesh salt;
 	TexturedTriMesh head;
 
+	// cubes twisted by their own lattices, deformed once for both passes;
+	// lattice shows the control points of the first one
+	DeformedTriMesh deformed;
+	// of the rest vertices of deformed, for the CPU path
+	BernsteinWeights deformed_weights;
+	BezierCube lattice;
+	std::vector<Vector3> lattices;
+	Box lattices_box;
+
 	FrameBuffer fbo;
 	Camera camera;
 	RenderTexture texture;
@@ -21,9 +33,13 @@ class ScatteringViewWindow : public Window {
 	RenderTexMap depth_map_texture;
 	GLint grow_location_dms;
 
+	// error_pixels of 0 selects the full meshes
+	void select_lods(const Camera &camera, int height, float error_pixels);
+	void update_lattices(float time);
+
   public:
     RenderTexture diffuse_texture;
 
-	ScatteringViewWindow(const ScatteringParameters& parameters);
+	ScatteringViewWindow(const ScatteringParameters& parameters, Flythrough& flythrough);
 	virtual void build() override;
 };
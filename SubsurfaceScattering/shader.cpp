@@ -1,26 +1,40 @@
 #include "shader.h"
 #include <fstream>
-#include <sstream>
 #include <stdexcept>
 #include <string>
 #include <vector>
 
-GLuint Shader::load_shader(const char *filename, GLenum shader_type) {
-	GLuint id = glCreateShader(shader_type);
-
-	std::string shader_code;
+namespace {
+// Reads the shader code with every line #include "file" replaced by the code
+// of the file, so that shaders can share functions.
+std::string read_shader_code(const std::string &filename) {
 	std::ifstream ifstr(filename);
-
-	// read code
 	if (!ifstr.good()) {
-		throw std::runtime_error(std::string("Cannot open shader file: ") +
-								 filename);
+		throw std::runtime_error("Cannot open shader file: " + filename);
 	}
 
-	std::stringstream sstr;
-	sstr << ifstr.rdbuf();
-	shader_code = sstr.str();
-	ifstr.close();
+	const std::string directive = "#include \"";
+	std::string code, line;
+	for (int number = 1; std::getline(ifstr, line); ++number) {
+		if (line.compare(0, directive.size(), directive) != 0) {
+			code += line + '\n';
+			continue;
+		}
+		const size_t end = line.find('"', directive.size());
+		if (end == std::string::npos)
+			throw std::runtime_error(filename + ":" + std::to_string(number) + ": unterminated #include");
+		code += read_shader_code(line.substr(directive.size(), end - directive.size()));
+		// compile errors after the include keep their line numbers
+		code += "#line " + std::to_string(number + 1) + "\n";
+	}
+	return code;
+}
+} // namespace
+
+GLuint Shader::load_shader(const char *filename, GLenum shader_type) {
+	GLuint id = glCreateShader(shader_type);
+
+	const std::string shader_code = read_shader_code(filename);
 
 	// compile code
 	const GLchar *const shader_ptr = shader_code.c_str();
@@ -70,6 +84,32 @@ void Shader::init_uniform_locations() {
     diffuse_blur_location = get_uniform_location("diffuse_blur");
 }
 
+void Shader::init(const char *compute_shader_file) {
+	auto compute_shader_id = load_shader(compute_shader_file, GL_COMPUTE_SHADER);
+
+	// link shader
+	id = glCreateProgram();
+	glAttachShader(id, compute_shader_id);
+	glLinkProgram(id);
+
+	// check program
+	GLint result = GL_FALSE;
+	int info_log_length;
+	glGetProgramiv(id, GL_LINK_STATUS, &result);
+	glGetProgramiv(id, GL_INFO_LOG_LENGTH, &info_log_length);
+	if (info_log_length > 0) {
+		std::vector<char> message(info_log_length + 1);
+		glGetProgramInfoLog(id, info_log_length, NULL, message.data());
+		printf("%s\n", message.data());
+		throw std::runtime_error(message.data());
+	}
+
+	glDetachShader(id, compute_shader_id);
+	glDeleteShader(compute_shader_id);
+
+	init_uniform_locations();
+}
+
 void Shader::init(const char *vertex_shader_file,
 				  const char *fragment_shader_file) {
 	auto vertex_shader_id = load_shader(vertex_shader_file, GL_VERTEX_SHADER);
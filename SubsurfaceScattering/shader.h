@@ -35,6 +35,8 @@ class Shader {
 
   public:
 	GLuint id;
+	// compute program
+	void init(const char *compute_shader_file);
 	void init(const char *vertex_shader_file, const char *fragment_shader_file);
 	void init(const char *vertex_shader_file, const char *geometry_shader_file,
 			  const char *fragment_shader_file);
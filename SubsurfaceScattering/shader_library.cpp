@@ -16,6 +16,9 @@ void ShaderLibrary::init() {
 					//"textured_fragment_shader.glsl");
 					"textured_translucent_fragment_shader.glsl");
     shaders[6].init("diffuse_pass_vertex.glsl", "diffuse_pass_fragment.glsl");
+	shaders[7].init("textured_vertex_shader.glsl", "visibility_fragment.glsl");
+	shaders[8].init("tile_mask_vertex.glsl", "simple_fragment_shader.glsl");
+	shaders[9].init("bezier_deform_compute_shader.glsl");
 
 	initialized = true;
 }
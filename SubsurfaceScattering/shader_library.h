@@ -4,11 +4,11 @@
 #include <type_traits>
 
 enum class ShaderType {
-	Simple, Axes, Phong, PhongDeformed, DepthMap, Textured, DiffusePass,
+	Simple, Axes, Phong, PhongDeformed, DepthMap, Textured, DiffusePass, Visibility, TileMask, BezierDeform,
 };
 
 class ShaderLibrary {
-	static constexpr int SHADER_COUNT = 7;
+	static constexpr int SHADER_COUNT = 10;
 	static Shader shaders[SHADER_COUNT];
 
 	static bool initialized;
@@ -0,0 +1,178 @@
+#pragma once
+
+#include "algebra.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+// SIMD packs of floats for structure-of-arrays kernels: AVX-512, AVX or SSE,
+// whichever is the widest the target is compiled for, or single floats with
+// ALGEBRA_NO_SIMD. Kernels written against Pack and WIDTH work with all of
+// them. deinterleave and interleave convert WIDTH points x0 y0 z0 x1 ... of
+// an array of Vector3 to and from a pack per coordinate.
+namespace simd {
+
+#if defined(ALGEBRA_USE_SSE)
+// x0 y0 z0 x1 | y1 z1 x2 y2 | z2 x3 y3 z3 <-> x0..x3, y0..y3, z0..z3, the
+// quarters the wider packs are built from, and horizontal min/max
+namespace sse_quarters {
+inline void deinterleave(const float *p, __m128 &x, __m128 &y, __m128 &z) {
+	const __m128 a0 = _mm_loadu_ps(p);
+	const __m128 a1 = _mm_loadu_ps(p + 4);
+	const __m128 a2 = _mm_loadu_ps(p + 8);
+	const __m128 t = _mm_shuffle_ps(a1, a2, _MM_SHUFFLE(2, 1, 3, 2)); // x2 y2 x3 y3
+	const __m128 u = _mm_shuffle_ps(a0, a1, _MM_SHUFFLE(1, 0, 2, 1)); // y0 z0 y1 z1
+	x = _mm_shuffle_ps(a0, t, _MM_SHUFFLE(2, 0, 3, 0));
+	y = _mm_shuffle_ps(u, t, _MM_SHUFFLE(3, 1, 2, 0));
+	z = _mm_shuffle_ps(u, a2, _MM_SHUFFLE(3, 0, 3, 1));
+}
+
+inline void interleave(float *p, __m128 x, __m128 y, __m128 z) {
+	const __m128 xy_lo = _mm_unpacklo_ps(x, y); // x0 y0 x1 y1
+	const __m128 xy_hi = _mm_unpackhi_ps(x, y); // x2 y2 x3 y3
+	const __m128 zx = _mm_shuffle_ps(z, x, _MM_SHUFFLE(1, 1, 0, 0)); // z0 z0 x1 x1
+	const __m128 yz = _mm_shuffle_ps(y, z, _MM_SHUFFLE(1, 1, 1, 1)); // y1 y1 z1 z1
+	const __m128 zx_hi = _mm_shuffle_ps(z, x, _MM_SHUFFLE(3, 3, 2, 2)); // z2 z2 x3 x3
+	const __m128 yz_hi = _mm_shuffle_ps(y, z, _MM_SHUFFLE(3, 3, 3, 3)); // y3 y3 z3 z3
+	_mm_storeu_ps(p, _mm_shuffle_ps(xy_lo, zx, _MM_SHUFFLE(2, 0, 1, 0)));
+	_mm_storeu_ps(p + 4, _mm_shuffle_ps(yz, xy_hi, _MM_SHUFFLE(1, 0, 2, 0)));
+	_mm_storeu_ps(p + 8, _mm_shuffle_ps(zx_hi, yz_hi, _MM_SHUFFLE(2, 0, 2, 0)));
+}
+
+inline float hmin(__m128 a) {
+	a = _mm_min_ps(a, _mm_movehl_ps(a, a));
+	return _mm_cvtss_f32(_mm_min_ss(a, _mm_shuffle_ps(a, a, 1)));
+}
+inline float hmax(__m128 a) {
+	a = _mm_max_ps(a, _mm_movehl_ps(a, a));
+	return _mm_cvtss_f32(_mm_max_ss(a, _mm_shuffle_ps(a, a, 1)));
+}
+} // namespace sse_quarters
+#endif
+
+#if defined(ALGEBRA_USE_SSE) && defined(__AVX512F__)
+using Pack = __m512;
+constexpr size_t WIDTH = 16;
+
+inline Pack splat(float a) { return _mm512_set1_ps(a); }
+inline Pack add(Pack a, Pack b) { return _mm512_add_ps(a, b); }
+inline Pack sub(Pack a, Pack b) { return _mm512_sub_ps(a, b); }
+inline Pack mul(Pack a, Pack b) { return _mm512_mul_ps(a, b); }
+inline Pack madd(Pack a, Pack b, Pack c) { return _mm512_fmadd_ps(a, b, c); }
+inline Pack min(Pack a, Pack b) { return _mm512_min_ps(a, b); }
+inline Pack max(Pack a, Pack b) { return _mm512_max_ps(a, b); }
+inline Pack rsqrt(Pack a) { return _mm512_div_ps(_mm512_set1_ps(1.0f), _mm512_sqrt_ps(a)); }
+inline Pack load(const float *p) { return _mm512_loadu_ps(p); }
+inline void store(float *p, Pack a) { _mm512_storeu_ps(p, a); }
+inline Pack abs(Pack a) { return _mm512_abs_ps(a); }
+inline float hmin(Pack a) { return _mm512_reduce_min_ps(a); }
+inline float hmax(Pack a) { return _mm512_reduce_max_ps(a); }
+
+inline void deinterleave(const float *p, Pack &x, Pack &y, Pack &z) {
+	__m128 qx[4], qy[4], qz[4];
+	for (int q = 0; q < 4; ++q)
+		sse_quarters::deinterleave(p + 12 * q, qx[q], qy[q], qz[q]);
+	x = _mm512_castps128_ps512(qx[0]);
+	y = _mm512_castps128_ps512(qy[0]);
+	z = _mm512_castps128_ps512(qz[0]);
+	x = _mm512_insertf32x4(x, qx[1], 1);
+	y = _mm512_insertf32x4(y, qy[1], 1);
+	z = _mm512_insertf32x4(z, qz[1], 1);
+	x = _mm512_insertf32x4(x, qx[2], 2);
+	y = _mm512_insertf32x4(y, qy[2], 2);
+	z = _mm512_insertf32x4(z, qz[2], 2);
+	x = _mm512_insertf32x4(x, qx[3], 3);
+	y = _mm512_insertf32x4(y, qy[3], 3);
+	z = _mm512_insertf32x4(z, qz[3], 3);
+}
+inline void interleave(float *p, Pack x, Pack y, Pack z) {
+	sse_quarters::interleave(p, _mm512_extractf32x4_ps(x, 0), _mm512_extractf32x4_ps(y, 0), _mm512_extractf32x4_ps(z, 0));
+	sse_quarters::interleave(p + 12, _mm512_extractf32x4_ps(x, 1), _mm512_extractf32x4_ps(y, 1), _mm512_extractf32x4_ps(z, 1));
+	sse_quarters::interleave(p + 24, _mm512_extractf32x4_ps(x, 2), _mm512_extractf32x4_ps(y, 2), _mm512_extractf32x4_ps(z, 2));
+	sse_quarters::interleave(p + 36, _mm512_extractf32x4_ps(x, 3), _mm512_extractf32x4_ps(y, 3), _mm512_extractf32x4_ps(z, 3));
+}
+#elif defined(ALGEBRA_USE_SSE) && defined(__AVX__)
+using Pack = __m256;
+constexpr size_t WIDTH = 8;
+
+inline Pack splat(float a) { return _mm256_set1_ps(a); }
+inline Pack add(Pack a, Pack b) { return _mm256_add_ps(a, b); }
+inline Pack sub(Pack a, Pack b) { return _mm256_sub_ps(a, b); }
+inline Pack mul(Pack a, Pack b) { return _mm256_mul_ps(a, b); }
+#if defined(__FMA__) || defined(__AVX2__)
+inline Pack madd(Pack a, Pack b, Pack c) { return _mm256_fmadd_ps(a, b, c); }
+#else
+inline Pack madd(Pack a, Pack b, Pack c) { return _mm256_add_ps(_mm256_mul_ps(a, b), c); }
+#endif
+inline Pack min(Pack a, Pack b) { return _mm256_min_ps(a, b); }
+inline Pack max(Pack a, Pack b) { return _mm256_max_ps(a, b); }
+inline Pack rsqrt(Pack a) { return _mm256_div_ps(_mm256_set1_ps(1.0f), _mm256_sqrt_ps(a)); }
+inline Pack load(const float *p) { return _mm256_loadu_ps(p); }
+inline void store(float *p, Pack a) { _mm256_storeu_ps(p, a); }
+inline Pack abs(Pack a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+inline float hmin(Pack a) { return sse_quarters::hmin(_mm_min_ps(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1))); }
+inline float hmax(Pack a) { return sse_quarters::hmax(_mm_max_ps(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1))); }
+
+inline void deinterleave(const float *p, Pack &x, Pack &y, Pack &z) {
+	__m128 lx, ly, lz, hx, hy, hz;
+	sse_quarters::deinterleave(p, lx, ly, lz);
+	sse_quarters::deinterleave(p + 12, hx, hy, hz);
+	x = _mm256_insertf128_ps(_mm256_castps128_ps256(lx), hx, 1);
+	y = _mm256_insertf128_ps(_mm256_castps128_ps256(ly), hy, 1);
+	z = _mm256_insertf128_ps(_mm256_castps128_ps256(lz), hz, 1);
+}
+inline void interleave(float *p, Pack x, Pack y, Pack z) {
+	sse_quarters::interleave(p, _mm256_castps256_ps128(x), _mm256_castps256_ps128(y), _mm256_castps256_ps128(z));
+	sse_quarters::interleave(p + 12, _mm256_extractf128_ps(x, 1), _mm256_extractf128_ps(y, 1), _mm256_extractf128_ps(z, 1));
+}
+#elif defined(ALGEBRA_USE_SSE)
+using Pack = __m128;
+constexpr size_t WIDTH = 4;
+
+inline Pack splat(float a) { return _mm_set1_ps(a); }
+inline Pack add(Pack a, Pack b) { return _mm_add_ps(a, b); }
+inline Pack sub(Pack a, Pack b) { return _mm_sub_ps(a, b); }
+inline Pack mul(Pack a, Pack b) { return _mm_mul_ps(a, b); }
+inline Pack madd(Pack a, Pack b, Pack c) { return sse_kernels::madd(a, b, c); }
+inline Pack min(Pack a, Pack b) { return _mm_min_ps(a, b); }
+inline Pack max(Pack a, Pack b) { return _mm_max_ps(a, b); }
+inline Pack rsqrt(Pack a) { return _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(a)); }
+inline Pack load(const float *p) { return _mm_loadu_ps(p); }
+inline void store(float *p, Pack a) { _mm_storeu_ps(p, a); }
+inline Pack abs(Pack a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+inline float hmin(Pack a) { return sse_quarters::hmin(a); }
+inline float hmax(Pack a) { return sse_quarters::hmax(a); }
+
+inline void deinterleave(const float *p, Pack &x, Pack &y, Pack &z) { sse_quarters::deinterleave(p, x, y, z); }
+inline void interleave(float *p, Pack x, Pack y, Pack z) { sse_quarters::interleave(p, x, y, z); }
+#else
+using Pack = float;
+constexpr size_t WIDTH = 1;
+
+inline Pack splat(float a) { return a; }
+inline Pack add(Pack a, Pack b) { return a + b; }
+inline Pack sub(Pack a, Pack b) { return a - b; }
+inline Pack mul(Pack a, Pack b) { return a * b; }
+inline Pack madd(Pack a, Pack b, Pack c) { return a * b + c; }
+inline Pack min(Pack a, Pack b) { return std::min(a, b); }
+inline Pack max(Pack a, Pack b) { return std::max(a, b); }
+inline Pack rsqrt(Pack a) { return 1.0f / std::sqrt(a); }
+inline Pack load(const float *p) { return *p; }
+inline void store(float *p, Pack a) { *p = a; }
+inline Pack abs(Pack a) { return std::abs(a); }
+inline float hmin(Pack a) { return a; }
+inline float hmax(Pack a) { return a; }
+
+inline void deinterleave(const float *p, Pack &x, Pack &y, Pack &z) {
+	x = p[0];
+	y = p[1];
+	z = p[2];
+}
+inline void interleave(float *p, Pack x, Pack y, Pack z) {
+	p[0] = x;
+	p[1] = y;
+	p[2] = z;
+}
+#endif
+
+} // namespace simd
@@ -2,7 +2,8 @@
 
 #include "task.h"
 #include "runge_kutta_4_ode_solver.h"
-#include "state_listener.h"
+#include "state_history.h"
+#include <atomic>
 
 class SpinningTopSimulation {
 	RungeKutta4ODESolver<float, 7> ode_solver;
@@ -16,7 +17,9 @@ class SpinningTopSimulation {
 	};
 
 	std::list<StateListener<float, 7>*> state_listeners;
-	bool started = false;
+	std::atomic<bool> started{ false };
+	// states passed to the listeners, trace_length long
+	StateHistory<float, 7> history;
 public:
 	struct SimulationParameters {
 		bool paused = false;
@@ -25,7 +28,8 @@ public:
 		float delta = 0.05f;
 		float cube_dim = 1.0f;
 		float cube_density = 1.0f;
-		int trace_length = 1000; // TODO
+		// samples kept in get_history()
+		int trace_length = 1000;
 		bool gravity_present = true;
 	} parameters;
 
@@ -42,6 +46,8 @@ public:
 	Vector<float, 7> get_current_state() const { return ode_solver.current(); }
 	float get_current_time() const { return ode_solver.current_argument(); }
 	void add_state_listener(StateListener<float, 7>& listener) { state_listeners.push_back(&listener); }
+	// The last trace_length states passed by notify_listeners().
+	const StateHistory<float, 7>& get_history() const { return history; }
 	Quaternion<float> get_current_quaternion() const { 
 		auto current = get_current_state();
 		return { current[3], current[4], current[5], current[6] };
@@ -49,9 +55,14 @@ public:
 
 	void notify_listeners()
 	{
-		auto value_to_pass = get_current_state();
+		const StateSample<float, 7> sample = { ode_solver.current_argument(), get_current_state() };
+		// time going back means the simulation was reset
+		history.set_capacity(static_cast<size_t>(std::max(parameters.trace_length, 1)));
+		if (!history.empty() && sample.time < history.back().time)
+			history.clear();
+		history.push(sample);
 		for (auto* l : state_listeners)
-			l->notify(ode_solver.current_argument(), value_to_pass);
+			l->notify(sample.time, sample.state);
 	}
 	ThreadTask get_task();
 };
\ No newline at end of file
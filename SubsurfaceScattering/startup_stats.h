@@ -0,0 +1,22 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Wall-clock times of the loading steps done at startup, listed in the
+// parameters window. Only used from the main thread.
+namespace startup_stats {
+
+struct Entry {
+	std::string name;
+	float milliseconds;
+};
+
+inline std::vector<Entry> &entries() {
+	static std::vector<Entry> list;
+	return list;
+}
+
+inline void add(std::string name, float milliseconds) { entries().push_back({std::move(name), milliseconds}); }
+
+} // namespace startup_stats
@@ -0,0 +1,215 @@
+#pragma once
+
+#include "state_listener.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+// Lock-free queue of samples from one producer (the integration step) to one
+// consumer (the UI thread). Memory is fixed at construction, a full queue
+// drops new samples and counts them instead of blocking the producer.
+template <class T, size_t DIM>
+class SampleQueue {
+	std::vector<StateSample<T, DIM>> samples;
+	size_t mask;
+
+	// written by the producer, read by the consumer
+	alignas(64) std::atomic<size_t> head{ 0 };
+	// written by the consumer, read by the producer
+	alignas(64) std::atomic<size_t> tail{ 0 };
+	std::atomic<size_t> dropped{ 0 };
+
+	static size_t round_up_to_power_of_two(size_t n) {
+		size_t p = 1;
+		while (p < n)
+			p *= 2;
+		return p;
+	}
+
+public:
+	// capacity is rounded up to a power of two
+	explicit SampleQueue(size_t capacity = 4096)
+		: samples(round_up_to_power_of_two(std::max<size_t>(capacity, 2))), mask(samples.size() - 1) {}
+
+	size_t capacity() const { return samples.size(); }
+	size_t get_dropped() const { return dropped.load(std::memory_order_relaxed); }
+
+	// Producer side. Returns false if the queue is full.
+	bool push(T time, const Vector<T, DIM>& state) {
+		const size_t h = head.load(std::memory_order_relaxed);
+		if (h - tail.load(std::memory_order_acquire) == samples.size()) {
+			dropped.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		samples[h & mask] = { time, state };
+		head.store(h + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Consumer side. Calls batch(samples, count) for everything queued, at
+	// most twice since the ring wraps around, and returns the sample count.
+	template <class F>
+	size_t drain(F&& batch) {
+		const size_t t = tail.load(std::memory_order_relaxed);
+		const size_t h = head.load(std::memory_order_acquire);
+		const size_t count = h - t;
+		if (count == 0)
+			return 0;
+		const size_t first = t & mask;
+		const size_t until_end = std::min(count, samples.size() - first);
+		batch(samples.data() + first, until_end);
+		if (until_end < count)
+			batch(samples.data(), count - until_end);
+		tail.store(h, std::memory_order_release);
+		return count;
+	}
+};
+
+// Point of a decimated plot.
+struct PlotPoint {
+	float time, value;
+};
+
+// The last capacity samples of a state, kept on the consumer side. Plots of
+// any history length cost the same to draw after decimation to a fixed point
+// count.
+template <class T, size_t DIM>
+class StateHistory {
+	std::vector<StateSample<T, DIM>> samples;
+	size_t capacity;
+	// index of the oldest sample once the history is full
+	size_t start = 0;
+
+	PlotPoint point(size_t i, size_t component) const {
+		const auto& sample = (*this)[i];
+		return { static_cast<float>(sample.time), static_cast<float>(sample.state[static_cast<int>(component)]) };
+	}
+
+public:
+	explicit StateHistory(size_t capacity = 1000) : capacity(std::max<size_t>(capacity, 1)) {
+		samples.reserve(this->capacity);
+	}
+
+	// Keeps the newest samples that still fit.
+	void set_capacity(size_t new_capacity) {
+		new_capacity = std::max<size_t>(new_capacity, 1);
+		if (new_capacity == capacity)
+			return;
+		std::vector<StateSample<T, DIM>> kept;
+		kept.reserve(new_capacity);
+		for (size_t i = size() - std::min(size(), new_capacity); i < size(); ++i)
+			kept.push_back((*this)[i]);
+		samples = std::move(kept);
+		capacity = new_capacity;
+		start = 0;
+	}
+
+	size_t get_capacity() const { return capacity; }
+	size_t size() const { return samples.size(); }
+	bool empty() const { return samples.empty(); }
+
+	void clear() {
+		samples.clear();
+		start = 0;
+	}
+
+	void push(const StateSample<T, DIM>& sample) {
+		if (samples.size() < capacity) {
+			samples.push_back(sample);
+		} else {
+			samples[start] = sample;
+			start = (start + 1) % capacity;
+		}
+	}
+
+	void push(const StateSample<T, DIM>* batch, size_t count) {
+		// only the newest capacity samples of the batch survive
+		const size_t skip = count > capacity ? count - capacity : 0;
+		for (size_t i = skip; i < count; ++i)
+			push(batch[i]);
+	}
+
+	// i = 0 is the oldest sample
+	const StateSample<T, DIM>& operator[](size_t i) const {
+		const size_t j = start + i;
+		return samples[j < samples.size() ? j : j - samples.size()];
+	}
+	const StateSample<T, DIM>& back() const { return (*this)[size() - 1]; }
+
+	// Splits the history into buckets and keeps the smallest and the largest
+	// value of each, in time order: at most 2 * buckets points, spikes of a
+	// single sample stay visible.
+	std::vector<PlotPoint> decimate_min_max(size_t component, size_t buckets) const {
+		std::vector<PlotPoint> result;
+		const size_t n = size();
+		if (n <= 2 * buckets) {
+			for (size_t i = 0; i < n; ++i)
+				result.push_back(point(i, component));
+			return result;
+		}
+		result.reserve(2 * buckets);
+		for (size_t b = 0; b < buckets; ++b) {
+			const size_t begin = b * n / buckets, end = (b + 1) * n / buckets;
+			size_t lo = begin, hi = begin;
+			for (size_t i = begin + 1; i < end; ++i) {
+				const T value = (*this)[i].state[static_cast<int>(component)];
+				if (value < (*this)[lo].state[static_cast<int>(component)])
+					lo = i;
+				if (value > (*this)[hi].state[static_cast<int>(component)])
+					hi = i;
+			}
+			result.push_back(point(std::min(lo, hi), component));
+			if (lo != hi)
+				result.push_back(point(std::max(lo, hi), component));
+		}
+		return result;
+	}
+
+	// Largest-Triangle-Three-Buckets: keeps the first and the last sample and
+	// from every bucket in between the one spanning the largest triangle with
+	// the point kept before it and the mean of the next bucket. Follows the
+	// shape of the curve closer than min/max with fewer points.
+	std::vector<PlotPoint> decimate_lttb(size_t component, size_t points) const {
+		std::vector<PlotPoint> result;
+		const size_t n = size();
+		if (points < 3 || n <= points) {
+			for (size_t i = 0; i < n; ++i)
+				result.push_back(point(i, component));
+			return result;
+		}
+		result.reserve(points);
+		const double bucket_size = static_cast<double>(n - 2) / (points - 2);
+		size_t kept = 0;
+		result.push_back(point(0, component));
+		for (size_t b = 0; b < points - 2; ++b) {
+			const size_t begin = static_cast<size_t>(b * bucket_size) + 1;
+			const size_t end = std::min(static_cast<size_t>((b + 1) * bucket_size) + 1, n - 1);
+			const size_t next_end = std::min(static_cast<size_t>((b + 2) * bucket_size) + 1, n);
+
+			double mean_time = 0.0, mean_value = 0.0;
+			for (size_t i = end; i < next_end; ++i) {
+				const PlotPoint p = point(i, component);
+				mean_time += p.time;
+				mean_value += p.value;
+			}
+			mean_time /= std::max<size_t>(next_end - end, 1);
+			mean_value /= std::max<size_t>(next_end - end, 1);
+
+			const PlotPoint a = point(kept, component);
+			double largest = -1.0;
+			for (size_t i = begin; i < end; ++i) {
+				const PlotPoint p = point(i, component);
+				const double area = std::abs((a.time - mean_time) * (p.value - a.value) - (a.time - p.time) * (mean_value - a.value));
+				if (area > largest) {
+					largest = area;
+					kept = i;
+				}
+			}
+			result.push_back(point(kept, component));
+		}
+		result.push_back(point(n - 1, component));
+		return result;
+	}
+};
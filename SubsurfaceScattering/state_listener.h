@@ -1,10 +1,24 @@
 #pragma once
 
 #include "generic_vector.h"
+#include <cstddef>
+
+template <class T, size_t DIM>
+struct StateSample {
+	T time;
+	Vector<T, DIM> state;
+};
 
 template <class T, size_t DIM>
 class StateListener {
 public:
 	virtual void notify(const T& arg, const Vector<T, DIM>& val) = 0;
 	virtual void reset() = 0;
+
+	// Samples since the last frame in time order, one call per batch instead
+	// of one per integration step. Forwards to notify by default.
+	virtual void notify_batch(const StateSample<T, DIM>* samples, size_t count) {
+		for (size_t i = 0; i < count; ++i)
+			notify(samples[i].time, samples[i].state);
+	}
 };
\ No newline at end of file
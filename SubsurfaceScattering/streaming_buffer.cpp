@@ -0,0 +1,120 @@
+#include "streaming_buffer.h"
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <stdexcept>
+
+// glad is generated for GL 4.3, buffer storage is GL 4.4
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+
+namespace {
+using BufferStorage = void(APIENTRYP)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+
+// null if the context can't create immutable buffer storage
+BufferStorage load_buffer_storage() {
+	GLint major = 0, minor = 0;
+	glGetIntegerv(GL_MAJOR_VERSION, &major);
+	glGetIntegerv(GL_MINOR_VERSION, &minor);
+	if (major * 10 + minor < 44 && !glfwExtensionSupported("GL_ARB_buffer_storage"))
+		return nullptr;
+	return reinterpret_cast<BufferStorage>(glfwGetProcAddress("glBufferStorage"));
+}
+
+// waits for the GPU to finish the commands before the fence and deletes it
+void wait_and_delete(GLsync& fence) {
+	if (!fence)
+		return;
+	GLbitfield flags = 0;
+	while (true) {
+		const GLenum result = glClientWaitSync(fence, flags, 1000000);
+		if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED || result == GL_WAIT_FAILED)
+			break;
+		// the fence has to reach the GPU to ever be signaled
+		flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+	}
+	glDeleteSync(fence);
+	fence = nullptr;
+}
+}
+
+void StreamingBuffer::init(GLenum target, GLsizeiptr region_size) {
+	this->target = target;
+
+	// allocations may be bound as uniform or shader storage blocks
+	GLint uniform_alignment = 0, storage_alignment = 0;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniform_alignment);
+	glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &storage_alignment);
+	block_alignment = std::max<GLsizeiptr>({ 16, uniform_alignment, storage_alignment });
+	this->region_size = (region_size + block_alignment - 1) / block_alignment * block_alignment;
+	const GLsizeiptr size = REGION_COUNT * this->region_size;
+
+	glGenBuffers(1, &id);
+	glBindBuffer(target, id);
+	static const BufferStorage buffer_storage = load_buffer_storage();
+	if (buffer_storage) {
+		const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		buffer_storage(target, size, nullptr, flags);
+		mapped = static_cast<char*>(glMapBufferRange(target, 0, size, flags));
+	}
+	if (!mapped) {
+		glBufferData(target, size, nullptr, GL_STREAM_DRAW);
+		staging.resize(size);
+	}
+	region = -1;
+	used = flushed = 0;
+}
+
+void StreamingBuffer::dispose() {
+	for (auto& fence : fences) {
+		if (fence)
+			glDeleteSync(fence);
+		fence = nullptr;
+	}
+	if (mapped) {
+		glBindBuffer(target, id);
+		glUnmapBuffer(target);
+		mapped = nullptr;
+	}
+	staging = {};
+	glDeleteBuffers(1, &id);
+	id = 0;
+}
+
+void StreamingBuffer::begin_frame() {
+	if (region >= 0) {
+		flush();
+		fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+	region = (region + 1) % REGION_COUNT;
+	wait_and_delete(fences[region]);
+	used = flushed = 0;
+}
+
+StreamingBuffer::Allocation StreamingBuffer::allocate(GLsizeiptr size, GLsizeiptr alignment) {
+	if (region < 0)
+		throw std::invalid_argument("StreamingBuffer::allocate before begin_frame");
+	// regions start at multiples of the block alignment, which every smaller
+	// power of two divides
+	const GLsizeiptr start = (used + alignment - 1) / alignment * alignment;
+	if (start > region_size || size > region_size - start)
+		throw std::invalid_argument("StreamingBuffer region is too small for the frame");
+	used = start + size;
+	return { region_data() + start, region * region_size + start };
+}
+
+void StreamingBuffer::flush() {
+	if (mapped || used == flushed)
+		return;
+	// the fence of the region makes sure the GPU doesn't read this range
+	const GLintptr offset = region * region_size + flushed;
+	glBindBuffer(target, id);
+	void* data = glMapBufferRange(target, offset, used - flushed,
+		GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+	if (data) {
+		std::memcpy(data, staging.data() + offset, used - flushed);
+		glUnmapBuffer(target);
+	}
+	flushed = used;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstring>
+#include <vector>
+
+// Buffer for data rewritten every frame, e.g. control points, instance
+// transforms or uniform blocks. Its storage is allocated once and split into
+// REGION_COUNT regions used round robin, one per frame. Writes of a frame
+// are bump allocated from its region and draws read them at the returned
+// offsets. A fence after the frame's commands guards the region, so it's
+// only written again once the GPU is done with it: no reallocation and no
+// implicit synchronization in the driver.
+//
+// With glBufferStorage (GL 4.4 or ARB_buffer_storage) the buffer stays
+// mapped persistent and coherent and writes land in it directly. Without it
+// writes go to a copy in memory, flush() copies them over with an
+// unsynchronized mapping.
+class StreamingBuffer {
+	static constexpr int REGION_COUNT = 3;
+
+	GLuint id = 0;
+	GLenum target = GL_ARRAY_BUFFER;
+	GLsizeiptr region_size = 0;
+	// offset alignment of uniform and shader storage bindings
+	GLsizeiptr block_alignment = 256;
+	char* mapped = nullptr;
+	// shadow of the buffer without persistent mapping
+	std::vector<char> staging;
+	GLsync fences[REGION_COUNT] = {};
+	int region = -1;
+	// allocated bytes of the current region, the first flushed ones of them
+	GLsizeiptr used = 0, flushed = 0;
+
+	char* region_data() { return mapped ? mapped + region * region_size : staging.data() + region * region_size; }
+
+  public:
+	struct Allocation {
+		void* data;
+		// from the start of the buffer, as used by draws and bind_range
+		GLintptr offset;
+	};
+
+	// Creates the buffer with REGION_COUNT regions of region_size bytes
+	// each, the most one frame can write.
+	void init(GLenum target, GLsizeiptr region_size);
+	void dispose();
+
+	// Starts the next frame's region, waiting for the GPU if it still reads
+	// it from REGION_COUNT frames ago. Ends the previous frame's region, the
+	// commands using it have to be issued before.
+	void begin_frame();
+
+	// Reserves size bytes of the current region at an offset that is a
+	// multiple of alignment, throws std::invalid_argument if the region can't
+	// fit them. Use get_block_alignment() for allocations given to
+	// bind_range.
+	Allocation allocate(GLsizeiptr size, GLsizeiptr alignment = 16);
+
+	template <class T> GLintptr write(const T* data, size_t count, GLsizeiptr alignment = 16) {
+		const Allocation allocation = allocate(static_cast<GLsizeiptr>(count * sizeof(T)), alignment);
+		std::memcpy(allocation.data, data, count * sizeof(T));
+		return allocation.offset;
+	}
+
+	// Makes the writes since the last flush visible to the GPU, call it
+	// before the draws reading them.
+	void flush();
+
+	GLsizeiptr get_block_alignment() const { return block_alignment; }
+	bool is_persistent() const { return mapped != nullptr; }
+	GLuint get_id() const { return id; }
+
+	void bind() const { glBindBuffer(target, id); }
+
+	// binds an allocation to an indexed uniform or shader storage binding
+	void bind_range(GLenum indexed_target, GLuint index, GLintptr offset, GLsizeiptr size) const {
+		glBindBufferRange(indexed_target, index, id, offset, size);
+	}
+};
@@ -1,14 +1,26 @@
 #pragma once
 
+#include "thread_pool.h"
+#include "fixed_timestep.h"
+#include "frame_graph.h"
+#include "coroutine_task.h"
+#include "frame_budget.h"
 #include <queue>
 #include <list>
 #include <chrono>
 #include <memory>
 #include <utility>
-#include <thread>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <vector>
 
 struct TaskParameters {
 	float delta_time;
+	// set when the task was cancelled, steps that take long should return
+	StopToken stop = {};
 };
 
 class SingleTaskStep
@@ -20,62 +32,178 @@ public:
 	virtual void execute_immediately(const TaskParameters& parameters) = 0;
 };
 
+// Pacing of a task running at a fixed step, for the UI.
+struct TaskStatistics {
+	float target_rate = 0.0f;
+	float measured_rate = 0.0f;
+	// blend factor between the previous and the latest state, see
+	// FixedTimestep::get_alpha
+	float alpha = 0.0f;
+	long long dropped_steps = 0;
+};
+
+// Handle onto a task running on a thread pool. Every job runs the steps due
+// since the previous one at a fixed delta_time and resubmits itself for the
+// time the next step is due, so the step rate doesn't drift with the time the
+// steps take, no thread is blocked between steps and starting a task doesn't
+// create one. The state is shared with the queued jobs, which may still hold
+// it after the handle was erased.
 class ThreadTask
 {
 	friend class TaskManager;
 
-	std::queue<std::unique_ptr<SingleTaskStep>> steps;
-	bool stopped = false;
-	bool paused = false;
-	std::thread thread;
-	const float& delta_time;
-	//bool* task_ended;
-
-	inline void execute() {
-		thread = std::thread([this]() {
-			while (true) {
-				if (ended())
-				{
-					return;
-				}
-				if (!paused)
-				{
-					auto& step = steps.front();
+	struct State
+	{
+		// guards steps, running and finished
+		std::mutex mutex;
+		std::condition_variable finished_changed;
+		std::queue<std::unique_ptr<SingleTaskStep>> steps;
+		bool started = false;
+		bool running = false;
+		std::atomic<bool> finished{ false };
+		std::atomic<bool> paused{ false };
+		StopSource stop;
+		const float& delta_time;
+		// only touched by the job, one runs at a time
+		FixedTimestep timestep;
+		// copied from timestep after every job, for the UI
+		std::atomic<float> measured_rate{ 0.0f };
+		std::atomic<float> alpha{ 0.0f };
+		std::atomic<long long> dropped_steps{ 0 };
+
+		State(const float& delta_time) : delta_time(delta_time), timestep(delta_time) {}
+	};
+
+	std::shared_ptr<State> state;
+
+	static inline void finish(State& state) {
+		state.finished = true;
+		state.finished_changed.notify_all();
+	}
 
-					bool should_continue = step->execute({ delta_time });
+	// Runs one step, returns false when the task ended.
+	static inline bool run_step(State& state, float delta_time) {
+		// the step stays in the queue while it runs, add_step only appends
+		SingleTaskStep* step;
+		{
+			std::lock_guard<std::mutex> lock(state.mutex);
+			step = state.steps.front().get();
+		}
 
-					if (!should_continue)
-						steps.pop();
-				}
-				std::this_thread::sleep_for(std::chrono::milliseconds(static_cast<long long>(1000 * delta_time)));
+		bool should_continue = step->execute({ delta_time, state.stop.get_token() });
+
+		std::lock_guard<std::mutex> lock(state.mutex);
+		if (!should_continue)
+			state.steps.pop();
+		return !state.stop.stop_requested() && !state.steps.empty();
+	}
+
+	static inline void execute_step(ThreadPool& pool, const std::shared_ptr<State>& state) {
+		{
+			std::lock_guard<std::mutex> lock(state->mutex);
+			if (state->finished)
+				return;
+			if (state->stop.stop_requested() || state->steps.empty())
+			{
+				finish(*state);
+				return;
 			}
-		});
+			state->running = !state->paused;
+		}
+
+		const float delta_time = state->delta_time;
+		FixedTimestep& timestep = state->timestep;
+		timestep.set_step(delta_time);
+
+		if (state->running)
+		{
+			bool alive = true;
+			for (int steps = timestep.update(); alive && steps > 0; --steps)
+				alive = run_step(*state, delta_time);
+
+			state->measured_rate = static_cast<float>(timestep.get_measured_rate());
+			state->alpha = timestep.get_alpha();
+			state->dropped_steps = timestep.get_dropped_steps();
+
+			std::lock_guard<std::mutex> lock(state->mutex);
+			state->running = false;
+			if (!alive || state->stop.stop_requested())
+			{
+				finish(*state);
+				return;
+			}
+		}
+		else
+		{
+			// no backlog builds up while paused
+			timestep.restart();
+		}
+
+		auto delay = std::chrono::duration<double>(state->paused ? delta_time : timestep.get_time_to_next_step());
+		pool.submit_after(std::chrono::duration_cast<ThreadPool::Clock::duration>(delay), [&pool, state]() { execute_step(pool, state); });
+	}
+
+	inline void execute(ThreadPool& pool) {
+		{
+			std::lock_guard<std::mutex> lock(state->mutex);
+			state->started = true;
+		}
+		state->timestep.restart();
+		pool.submit([&pool, state = state]() { execute_step(pool, state); });
 	}
 public:
-	ThreadTask(const float& delta_time) : delta_time(delta_time) {}
+	ThreadTask(const float& delta_time) : state(std::make_shared<State>(delta_time)) {}
 
-	ThreadTask(ThreadTask&& task) noexcept : steps(std::move(task.steps)), stopped(task.stopped), paused(task.paused), thread(std::move(task.thread)), delta_time(task.delta_time) {}
+	ThreadTask(ThreadTask&& task) noexcept = default;
 
 	template <class T, class... Args>
-	inline void add_step(Args&&... args) { steps.push(std::make_unique<T>(std::forward<Args>(args)...)); }
+	inline void add_step(Args&&... args) {
+		std::lock_guard<std::mutex> lock(state->mutex);
+		state->steps.push(std::make_unique<T>(std::forward<Args>(args)...));
+	}
 
-	inline bool ended() { return stopped || steps.empty(); }
+	inline bool ended() {
+		if (!state || state->finished)
+			return true;
+		std::lock_guard<std::mutex> lock(state->mutex);
+		return state->stop.stop_requested() || state->steps.empty();
+	}
 
 	inline void pause() {
-		paused = true;
+		state->paused = true;
 	}
 
 	inline void resume() {
-		if (!paused) return;
-		paused = false;
+		state->paused = false;
 	}
 
-	inline void terminate() { stopped = true; }
+	inline TaskStatistics get_statistics() const {
+		return { state->delta_time > 0.0f ? 1.0f / state->delta_time : 0.0f, state->measured_rate, state->alpha, state->dropped_steps };
+	}
+
+	// Asks the task to stop. The running step isn't interrupted, long steps
+	// can poll TaskParameters::stop to return early.
+	inline void cancel() {
+		std::lock_guard<std::mutex> lock(state->mutex);
+		state->stop.request_stop();
+		// a task waiting for its next step is done right away
+		if (!state->running)
+			finish(*state);
+	}
+
+	// Blocks until the running step, if any, has returned after cancel() or
+	// until the last step ended.
+	inline void wait() {
+		std::unique_lock<std::mutex> lock(state->mutex);
+		state->finished_changed.wait(lock, [this]() { return !state->started || state->finished; });
+	}
 
 	~ThreadTask() {
-		terminate();
-		if (thread.joinable())
-			thread.join();
+		if (!state)
+			return;
+		// steps may reference objects that are destroyed after the handle
+		cancel();
+		wait();
 	}
 };
 
@@ -88,8 +216,25 @@ class Task
 	bool stopped = false;
 	bool paused = false;
 	bool* task_ended;
+	// set by set_fixed_step, otherwise steps get the frame time
+	std::optional<FixedTimestep> timestep;
+	// where the step runs in the frame graph and what it shares
+	JobAffinity affinity = JobAffinity::Gl;
+	std::vector<const void*> read_data, written_data;
+	TaskPriority priority = TaskPriority::Normal;
+	// per-frame time the fixed steps may take, unlimited if not set
+	std::optional<std::chrono::steady_clock::duration> frame_budget;
+	// moving estimate of what execute_step takes
+	float cost_ms = 0.0f;
+	int deferred_frames = 0;
 
 	inline void execute_step() {
+		const auto start = std::chrono::steady_clock::now();
+		execute_due_steps();
+		FrameBudget::add_cost_sample(cost_ms, std::chrono::steady_clock::now() - start);
+	}
+
+	inline void execute_due_steps() {
 		if (paused)
 			return;
 		if (ended())
@@ -99,6 +244,24 @@ class Task
 			return;
 		}
 
+		if (timestep)
+		{
+			const float delta_time = static_cast<float>(timestep->get_step());
+			const auto start = std::chrono::steady_clock::now();
+			for (int count = timestep->update(); count > 0 && !ended(); --count)
+			{
+				if (frame_budget && std::chrono::steady_clock::now() - start >= *frame_budget)
+				{
+					// over budget, the rest is due next frame
+					timestep->give_back(count);
+					break;
+				}
+				if (!steps.front()->execute({ delta_time }))
+					steps.pop();
+			}
+			return;
+		}
+
 		auto& step = steps.front();
 
 		auto time_point = std::chrono::high_resolution_clock::now();
@@ -146,23 +309,136 @@ public:
 		if (!paused) return;
 		paused = false;
 		previous_time_point = std::chrono::high_resolution_clock::now();
+		if (timestep)
+			timestep->restart();
 	}
 
 	inline void terminate() { stopped = true; }
+
+	// Runs the steps at a fixed delta_time, as many per frame as are due but
+	// at most max_catch_up, instead of once per frame with the frame time.
+	inline void set_fixed_step(float delta_time, int max_catch_up = 8) {
+		timestep.emplace(delta_time, max_catch_up);
+	}
+
+	// Steps that don't touch GL may run on the thread pool, in parallel with
+	// the other tasks of the frame that don't write the data they use.
+	inline Task& set_affinity(JobAffinity affinity) {
+		this->affinity = affinity;
+		return *this;
+	}
+
+	// Lower priority steps are deferred to later frames when the frame is
+	// close to its deadline, see FrameBudget.
+	inline Task& set_priority(TaskPriority priority) {
+		this->priority = priority;
+		return *this;
+	}
+
+	// Limits the time the fixed steps take per frame, the steps that don't
+	// fit are run in the next frames.
+	inline Task& set_frame_budget(std::chrono::steady_clock::duration budget) {
+		frame_budget = budget;
+		return *this;
+	}
+
+	inline Task& reads(const void* data) {
+		read_data.push_back(data);
+		return *this;
+	}
+
+	inline Task& writes(const void* data) {
+		written_data.push_back(data);
+		return *this;
+	}
+
+	inline TaskStatistics get_statistics() const {
+		if (!timestep)
+			return {};
+		return { static_cast<float>(timestep->get_target_rate()), static_cast<float>(timestep->get_measured_rate()),
+			timestep->get_alpha(), timestep->get_dropped_steps() };
+	}
 };
 
 class TaskManager
 {
 	friend class GlApplication;
 
+	ThreadPool& pool;
+	FrameGraph frame_graph;
+	FrameBudget budget;
 	std::list<Task> tasks;
 	std::list<ThreadTask> thread_tasks;
+	std::list<CoroutineTask> coroutines;
+	// time per frame for resuming coroutines
+	std::chrono::steady_clock::duration coroutine_budget = std::chrono::milliseconds(4);
+
+	// Resumes the coroutines waiting for a frame until the budget is used
+	// up. Coroutines that ran go to the back, so that all of them get their
+	// turn when the budget doesn't suffice. Removes the ended ones and returns
+	// the first error they threw.
+	inline std::exception_ptr resume_coroutines() {
+		const auto deadline = std::chrono::steady_clock::now() + coroutine_budget;
+		size_t count = coroutines.size();
+		auto it = coroutines.begin();
+		for (; count > 0 && std::chrono::steady_clock::now() < deadline; --count)
+		{
+			auto current = it++;
+			if (current->resume(pool, deadline))
+				coroutines.splice(coroutines.end(), coroutines, current);
+		}
+
+		std::exception_ptr error;
+		for (auto it = coroutines.begin(); it != coroutines.end();)
+		{
+			if (it->ended())
+			{
+				CoroutineTask ended = std::move(*it);
+				it = coroutines.erase(it);
+				try {
+					ended.rethrow_error();
+				}
+				catch (...) {
+					if (!error)
+						error = std::current_exception();
+				}
+			}
+			else
+				++it;
+		}
+		return error;
+	}
+
 	inline void execute_tasks() {
+		budget.begin_frame();
+		for (auto& task : tasks)
+		{
+			if (task.paused || task.ended())
+				continue;
+			if (!budget.admit(task.priority, task.cost_ms, task.deferred_frames))
+			{
+				++task.deferred_frames;
+				continue;
+			}
+			task.deferred_frames = 0;
+
+			auto& job = frame_graph.add("task", task.affinity, [&task]() { task.execute_step(); });
+			// a task's steps run in order
+			job.writes(&task);
+			for (const void* data : task.read_data)
+				job.reads(data);
+			for (const void* data : task.written_data)
+				job.writes(data);
+		}
+		frame_graph.execute();
+		// thrown when the frame's work is done
+		const std::exception_ptr coroutine_error = resume_coroutines();
+		budget.end_tasks();
+
 		auto it = tasks.begin();
 
 		while (it != tasks.end())
 		{
-			it->execute_step();
 			if (it->ended())
 			{
 				if (it->task_ended != nullptr)
@@ -173,30 +449,58 @@ class TaskManager
 				++it;
 		}
 
-		auto it2 = thread_tasks.begin();
+		// finished tasks have no step running, erasing them never blocks
+		thread_tasks.remove_if([](const ThreadTask& task) { return !task.state || task.state->finished; });
 
-		while (it2 != thread_tasks.end())
-		{
-			if (it2->ended())
-			{
-				it2->thread.join();
-				it2 = thread_tasks.erase(it2);
-			}
-			else
-				++it2;
-		}
+		if (coroutine_error)
+			std::rethrow_exception(coroutine_error);
 	}
 
 public:
+	TaskManager(ThreadPool& pool = ThreadPool::shared()) : pool(pool), frame_graph(pool) {}
+
+	// Jobs added here run with the task steps of the next frame.
+	inline FrameJob& add_frame_job(std::string name, JobAffinity affinity, std::function<void()> body) {
+		return frame_graph.add(std::move(name), affinity, std::move(body));
+	}
+
+	inline const FrameGraphStatistics& get_frame_statistics() const { return frame_graph.get_statistics(); }
+
+	// Called when the frame's CPU work is done, before the buffer swap.
+	inline void end_frame() { budget.end_frame(); }
+
+	inline void set_target_frame_time(float milliseconds) { budget.set_target_frame_time(milliseconds); }
+
+	inline const FrameBudgetStatistics& get_budget_statistics() const { return budget.get_statistics(); }
+
+	// Pacing of the tasks running at a fixed step, thread tasks last.
+	inline std::vector<TaskStatistics> get_fixed_step_statistics() const {
+		std::vector<TaskStatistics> statistics;
+		for (const auto& task : tasks)
+			if (task.timestep)
+				statistics.push_back(task.get_statistics());
+		for (const auto& task : thread_tasks)
+			if (task.state && !task.state->finished)
+				statistics.push_back(task.get_statistics());
+		return statistics;
+	}
+
 	inline Task& add_task(Task&& task) {
 		tasks.push_back(std::move(task));
 		return tasks.back();
 	}
 
+	inline CoroutineTask& add_coroutine(CoroutineTask&& task) {
+		coroutines.push_back(std::move(task));
+		return coroutines.back();
+	}
+
+	inline void set_coroutine_budget(std::chrono::steady_clock::duration budget) { coroutine_budget = budget; }
+
 	inline ThreadTask& add_thread_task(ThreadTask&& task) {
 		thread_tasks.push_back(std::move(task));
 		ThreadTask& current = thread_tasks.back();
-		current.execute();
+		current.execute(pool);
 		return current;
 	}
 };
\ No newline at end of file
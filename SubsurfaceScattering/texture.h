@@ -3,13 +3,15 @@
 #include <glad/glad.h>
 #include "exception.h"
 
-template <GLenum FORMAT, GLenum INTERNALFORMAT = FORMAT, bool WITH_RENDERBUFFER = false>
+template <GLenum FORMAT, GLenum INTERNALFORMAT = FORMAT, bool WITH_RENDERBUFFER = false, GLenum RENDERBUFFER_FORMAT = GL_DEPTH_COMPONENT>
 class GlTexture {
+	static constexpr GLenum RENDERBUFFER_ATTACHMENT = RENDERBUFFER_FORMAT == GL_DEPTH24_STENCIL8 ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT;
+
 	GLuint id;
 	GLuint rbid;
 
-    int width;
-    int height;
+    int width = 0;
+    int height = 0;
 public:
 	GLuint get_id() const { return id; }
 
@@ -45,7 +47,7 @@ public:
 		if constexpr (WITH_RENDERBUFFER)
 		{
 			glBindRenderbuffer(GL_RENDERBUFFER, rbid);
-			glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, width, height);
+			glRenderbufferStorage(GL_RENDERBUFFER, RENDERBUFFER_FORMAT, width, height);
 			glBindRenderbuffer(GL_RENDERBUFFER, 0);
 		}
 	}
@@ -54,16 +56,17 @@ public:
 		glTexSubImage2D(GL_TEXTURE_2D, 0, xoffset, yoffset, width, height, FORMAT, GL_FLOAT, pixels);
 	}
 
-	void set_image(int width, int height, const void* pixels) {
+	// type is the component type of pixels, e.g. GL_UNSIGNED_BYTE for Image
+	void set_image(int width, int height, const void* pixels, GLenum type = GL_FLOAT) {
         this->width = width;
         this->height = height;
 
-		glTexImage2D(GL_TEXTURE_2D, 0, INTERNALFORMAT, width, height, 0, FORMAT, GL_FLOAT, pixels);
+		glTexImage2D(GL_TEXTURE_2D, 0, INTERNALFORMAT, width, height, 0, FORMAT, type, pixels);
 
 		if constexpr (WITH_RENDERBUFFER)
 		{
 			glBindRenderbuffer(GL_RENDERBUFFER, rbid);
-			glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, width, height);
+			glRenderbufferStorage(GL_RENDERBUFFER, RENDERBUFFER_FORMAT, width, height);
 			glBindRenderbuffer(GL_RENDERBUFFER, 0);
 		}
 	}
@@ -84,9 +87,9 @@ public:
 		if constexpr (WITH_RENDERBUFFER)
 		{
 			glBindRenderbuffer(GL_RENDERBUFFER, rbid);
-			glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, 100, 100); // xd
+			glRenderbufferStorage(GL_RENDERBUFFER, RENDERBUFFER_FORMAT, 100, 100); // xd
 			glBindRenderbuffer(GL_RENDERBUFFER, 0);
-			glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, rbid);
+			glFramebufferRenderbuffer(GL_FRAMEBUFFER, RENDERBUFFER_ATTACHMENT, GL_RENDERBUFFER, rbid);
 		}
 
 		glDrawBuffers(1, &drawBuffer);
@@ -107,5 +110,6 @@ public:
 
 using Texture = GlTexture<GL_RGBA>;
 using RenderTexture = GlTexture<GL_RGBA, GL_RGBA, true>;
+using StencilRenderTexture = GlTexture<GL_RGBA, GL_RGBA, true, GL_DEPTH24_STENCIL8>;
 using TexMap = GlTexture<GL_RED, GL_R32F>;
 using RenderTexMap = GlTexture<GL_RED, GL_R32F, true>;
@@ -1,15 +1,216 @@
 #pragma once
 
+#include "image_loader.h"
 #include "mesh.h"
+#include <cmath>
 
 class TexturedTriMesh : public TriMesh {
+	// size (in texels) of the square UV tiles used by visibility culling
+	static constexpr int DIFFUSE_TILE_SIZE = 32;
+	// visibility pre-pass is rendered in 1/VISIBILITY_DOWNSCALE of the view
+	static constexpr int VISIBILITY_DOWNSCALE = 2;
+	static constexpr GLuint TILE_MASK_BINDING = 2;
+	// amortised mode refreshes tiles outside of the view this many times
+	// less often than the visible ones
+	static constexpr int HIDDEN_TILE_PERIOD_FACTOR = 4;
+	static constexpr int MAX_UPDATE_PERIOD = 64;
+
+	// inputs of the diffuse pass captured at the last full refresh
+	struct DiffuseInputs {
+		Light light;
+		float wrap, scatter_width, scatter_power;
+		Vector3 scatter_color;
+		int scatter_falloff;
+		bool angle_scatter;
+		Matrix4x4 model;
+	};
+
 	VertexBuffer uv_vbo;
 
 	Texture color_texture;
 	Texture normal_texture;
 
 	FrameBuffer diffuse_fbo;
-	RenderTexture diffuse_texture;
+	StencilRenderTexture diffuse_texture;
+
+	FrameBuffer visibility_fbo;
+	RenderTexture visibility_texture;
+	ShaderStorageUintBuffer tile_mask;
+	VertexArray tile_vao;
+	int tile_count_x = 0, tile_count_y = 0;
+
+	DiffuseInputs refreshed_inputs;
+	bool diffuse_valid = false;
+	int update_period = 4;
+	int frame_index = 0;
+	GLuint diffuse_time_query;
+	bool diffuse_time_query_pending = false;
+
+	GLint tile_count_location_vis;
+	GLint mark_tiles_location_vis;
+	GLint tile_count_location_tm;
+	GLint tile_size_location_tm;
+	GLint tile_margin_location_tm;
+	GLint use_mask_location_tm;
+	GLint update_period_location_tm;
+	GLint hidden_period_location_tm;
+	GLint frame_index_location_tm;
+
+	DiffuseInputs capture_inputs(const ScatteringParameters &parameters) const {
+		return {parameters.light,		  parameters.wrap,
+				parameters.scatter_width, parameters.scatter_power,
+				parameters.scatter_color, parameters.scatter_falloff,
+				parameters.angle_scatter, model};
+	}
+
+	// Rough measure of how much the irradiance changed since the last full
+	// refresh. Discrete parameters always invalidate.
+	float inputs_change(const DiffuseInputs &inputs) const {
+		const auto &old = refreshed_inputs;
+		if (inputs.scatter_falloff != old.scatter_falloff ||
+			inputs.angle_scatter != old.angle_scatter)
+			return INFINITY;
+
+		float model_change = 0.0f;
+		for (int i = 0; i < Matrix4x4::DIMENSION; ++i)
+			for (int j = 0; j < Matrix4x4::DIMENSION; ++j)
+				model_change = std::max(
+					model_change,
+					std::abs(inputs.model.elem[i][j] - old.model.elem[i][j]));
+
+		return (inputs.light.position - old.light.position).length() +
+			   (inputs.light.color - old.light.color).length() +
+			   std::abs(inputs.light.diffuse - old.light.diffuse) +
+			   std::abs(inputs.wrap - old.wrap) +
+			   std::abs(inputs.scatter_width - old.scatter_width) +
+			   std::abs(inputs.scatter_power - old.scatter_power) +
+			   (inputs.scatter_color - old.scatter_color).length() +
+			   model_change;
+	}
+
+	// Adapts the round-robin period to the GPU time of the previous diffuse
+	// passes. Doesn't stall, the result is read only when it's available.
+	void adapt_update_period(float budget_ms) {
+		if (!diffuse_time_query_pending)
+			return;
+
+		GLint available = 0;
+		glGetQueryObjectiv(diffuse_time_query, GL_QUERY_RESULT_AVAILABLE,
+						   &available);
+		if (!available)
+			return;
+
+		GLuint64 elapsed_ns;
+		glGetQueryObjectui64v(diffuse_time_query, GL_QUERY_RESULT, &elapsed_ns);
+		diffuse_time_query_pending = false;
+
+		const float elapsed_ms = elapsed_ns * 1e-6f;
+		if (elapsed_ms > budget_ms && update_period < MAX_UPDATE_PERIOD)
+			++update_period;
+		else if (elapsed_ms < 0.5f * budget_ms && update_period > 1)
+			--update_period;
+	}
+
+	void resize_tile_mask() {
+		const int count_x = (color_texture.get_width() + DIFFUSE_TILE_SIZE - 1) /
+							DIFFUSE_TILE_SIZE;
+		const int count_y = (color_texture.get_height() + DIFFUSE_TILE_SIZE - 1) /
+							DIFFUSE_TILE_SIZE;
+		if (count_x == tile_count_x && count_y == tile_count_y)
+			return;
+
+		tile_count_x = count_x;
+		tile_count_y = count_y;
+		const int words = (tile_count_x * tile_count_y + 31) / 32;
+		tile_mask.bind();
+		tile_mask.set_dynamic_data(nullptr, words * sizeof(GLuint));
+	}
+
+	// Marks UV tiles referenced by fragments visible from the camera.
+	void render_visibility(const Camera &camera, int width, int height) {
+		resize_tile_mask();
+
+		const int vis_width = std::max(width / VISIBILITY_DOWNSCALE, 1);
+		const int vis_height = std::max(height / VISIBILITY_DOWNSCALE, 1);
+
+		tile_mask.bind();
+		tile_mask.clear_data(GL_R32UI, GL_RED_INTEGER);
+		tile_mask.bind_base(TILE_MASK_BINDING);
+
+		visibility_fbo.bind();
+		visibility_texture.bind();
+		visibility_texture.set_size(vis_width, vis_height);
+		glViewport(0, 0, vis_width, vis_height);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		glEnable(GL_DEPTH_TEST);
+		glEnable(GL_CULL_FACE);
+
+		auto pv = camera.get_projection_view_matrix(width, height);
+
+		Shader &shader = ShaderLibrary::get_shader(ShaderType::Visibility);
+		shader.use();
+		shader.set_pv(pv);
+		shader.set_m(model);
+		glUniform2i(tile_count_location_vis, tile_count_x, tile_count_y);
+
+		vao.bind();
+		// depth pre-pass, so that only the nearest surface marks its tiles
+		glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+		glDepthFunc(GL_LESS);
+		glUniform1i(mark_tiles_location_vis, 0);
+		draw_elements();
+
+		glDepthMask(GL_FALSE);
+		glDepthFunc(GL_LEQUAL);
+		glUniform1i(mark_tiles_location_vis, 1);
+		draw_elements();
+		vao.unbind();
+
+		glDepthMask(GL_TRUE);
+		glDepthFunc(GL_LESS);
+		glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+		visibility_fbo.unbind();
+
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+	}
+
+	// Writes 1 to the stencil of tiles updated in this frame: tiles referenced
+	// by a visible fragment (dilated by margin tiles) every period frames and
+	// the others every hidden_period frames (never if 0). Without use_mask
+	// every tile counts as referenced. Diffuse framebuffer must be bound.
+	void render_tile_stencil(int margin, bool use_mask, int period,
+							 int hidden_period) {
+		glDisable(GL_DEPTH_TEST);
+		glEnable(GL_STENCIL_TEST);
+		glStencilFunc(GL_ALWAYS, 1, 0xFF);
+		glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
+		glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+
+		Shader &shader = ShaderLibrary::get_shader(ShaderType::TileMask);
+		shader.use();
+		glUniform2i(tile_count_location_tm, tile_count_x, tile_count_y);
+		glUniform2f(tile_size_location_tm,
+					static_cast<float>(DIFFUSE_TILE_SIZE) /
+						color_texture.get_width(),
+					static_cast<float>(DIFFUSE_TILE_SIZE) /
+						color_texture.get_height());
+		glUniform1i(tile_margin_location_tm, margin);
+		glUniform1i(use_mask_location_tm, use_mask ? 1 : 0);
+		glUniform1i(update_period_location_tm, period);
+		glUniform1i(hidden_period_location_tm, hidden_period);
+		glUniform1i(frame_index_location_tm, frame_index);
+
+		tile_mask.bind_base(TILE_MASK_BINDING);
+		tile_vao.bind();
+		glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4,
+							  tile_count_x * tile_count_y);
+		tile_vao.unbind();
+
+		glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+		glStencilFunc(GL_EQUAL, 1, 0xFF);
+		glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+		glEnable(GL_DEPTH_TEST);
+	}
 
   public:
 	TexturedTriMesh() : TriMesh(ShaderType::Textured) {
@@ -31,6 +232,18 @@ class TexturedTriMesh : public TriMesh {
 		diffuse_texture.unbind();
 		diffuse_fbo.unbind();
 
+		visibility_fbo.init();
+		visibility_fbo.bind();
+		visibility_texture.init();
+		visibility_texture.bind();
+		visibility_texture.configure();
+		visibility_texture.unbind();
+		visibility_fbo.unbind();
+
+		tile_mask.init();
+		tile_vao.init();
+		glGenQueries(1, &diffuse_time_query);
+
 		vao.bind();
 		uv_vbo.init();
 		uv_vbo.bind();
@@ -48,16 +261,40 @@ class TexturedTriMesh : public TriMesh {
 		diffuse_shader.use();
 		glUniform1i(diffuse_shader.get_uniform_location("color_tex"), 0);
 		glUniform1i(diffuse_shader.get_uniform_location("normal_tex"), 1);
+
+		Shader &visibility_shader =
+			ShaderLibrary::get_shader(ShaderType::Visibility);
+		tile_count_location_vis =
+			visibility_shader.get_uniform_location("tile_count");
+		mark_tiles_location_vis =
+			visibility_shader.get_uniform_location("mark_tiles");
+
+		Shader &tile_mask_shader =
+			ShaderLibrary::get_shader(ShaderType::TileMask);
+		tile_count_location_tm =
+			tile_mask_shader.get_uniform_location("tile_count");
+		tile_size_location_tm =
+			tile_mask_shader.get_uniform_location("tile_size");
+		tile_margin_location_tm =
+			tile_mask_shader.get_uniform_location("tile_margin");
+		use_mask_location_tm =
+			tile_mask_shader.get_uniform_location("use_mask");
+		update_period_location_tm =
+			tile_mask_shader.get_uniform_location("update_period");
+		hidden_period_location_tm =
+			tile_mask_shader.get_uniform_location("hidden_period");
+		frame_index_location_tm =
+			tile_mask_shader.get_uniform_location("frame_index");
 	}
 
-	void set_color_texture(int width, int height, const void *data) {
+	void set_color_texture(const Image &image) {
 		color_texture.bind();
-		color_texture.set_image(width, height, data);
+		color_texture.set_image(image.width, image.height, image.pixels.data(), GL_UNSIGNED_BYTE);
 	}
 
-	void set_normal_texture(int width, int height, const void *data) {
+	void set_normal_texture(const Image &image) {
 		normal_texture.bind();
-		normal_texture.set_image(width, height, data);
+		normal_texture.set_image(image.width, image.height, image.pixels.data(), GL_UNSIGNED_BYTE);
 	}
 
 	void set_uvs(const std::vector<Vector2> &uvs) {
@@ -75,8 +312,7 @@ class TexturedTriMesh : public TriMesh {
 		glActiveTexture(GL_TEXTURE2);
 		diffuse_texture.bind();
 
-		auto pv = camera.get_projection_matrix(width, height) *
-				  camera.get_view_matrix();
+		auto pv = camera.get_projection_view_matrix(width, height);
 
 		glEnable(GL_CULL_FACE);
 
@@ -93,29 +329,84 @@ class TexturedTriMesh : public TriMesh {
 						   parameters.scatter_color, parameters.scatter_falloff,
 						   parameters.angle_scatter);
 		shader.set_translucency(parameters.translucency, parameters.sigma_t,
-								parameters.light_camera.get_projection_matrix(
+								parameters.light_camera.get_projection_view_matrix(
 									ScatteringParameters::DEPTH_MAP_SIZE,
-									ScatteringParameters::DEPTH_MAP_SIZE) *
-									parameters.light_camera.get_view_matrix());
+									ScatteringParameters::DEPTH_MAP_SIZE));
 
 		vao.bind();
-		glDrawElements(GL_TRIANGLES, indices_count, GL_UNSIGNED_INT, nullptr);
+		draw_elements();
 		// glDrawArrays(MODE, 0, point_count);
 		vao.unbind();
 	}
 
+	int get_update_period() const { return update_period; }
+
 	void render_diffuse(const Camera &camera,
-						const ScatteringParameters &parameters) {
+						const ScatteringParameters &parameters, int width,
+						int height) {
+		const bool cull_texels =
+			parameters.visibility_culling && width > 0 && height > 0;
+		const bool amortise = parameters.amortised_diffuse;
+
+		resize_tile_mask();
+		if (cull_texels)
+			render_visibility(camera, width, height);
+
 		diffuse_texture.bind();
-		diffuse_texture.set_size(color_texture.get_width(),
-								 color_texture.get_height());
+		if (diffuse_texture.get_width() != color_texture.get_width() ||
+			diffuse_texture.get_height() != color_texture.get_height()) {
+			diffuse_texture.set_size(color_texture.get_width(),
+									 color_texture.get_height());
+			diffuse_valid = false;
+		}
+
+		const auto inputs = capture_inputs(parameters);
+		const bool full_refresh =
+			!amortise || !diffuse_valid ||
+			inputs_change(inputs) > parameters.diffuse_invalidate_threshold;
+		if (full_refresh) {
+			refreshed_inputs = inputs;
+			diffuse_valid = true;
+		} else {
+			adapt_update_period(parameters.diffuse_budget_ms);
+		}
 
 		diffuse_fbo.bind();
 		glViewport(0, 0, color_texture.get_width(), color_texture.get_height());
 		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		glClearStencil(0);
+		glClear((full_refresh ? GL_COLOR_BUFFER_BIT : 0) |
+				GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
 		glDisable(GL_CULL_FACE);
 
+		// a full refresh in amortised mode rewrites hidden tiles too, so that
+		// they are not stale when they come into the view
+		const bool use_stencil = !full_refresh || (cull_texels && !amortise);
+		if (use_stencil) {
+			// blur in the main pass samples diffuse_blur away from visible uvs
+			const int blur_texels = static_cast<int>(
+				std::ceil(parameters.diffuse_blur *
+						  std::max(color_texture.get_width(),
+								   color_texture.get_height())));
+			const int margin =
+				(blur_texels + DIFFUSE_TILE_SIZE - 1) / DIFFUSE_TILE_SIZE + 1;
+			if (full_refresh)
+				render_tile_stencil(margin, true, 1, 0);
+			else
+				render_tile_stencil(margin, cull_texels, update_period,
+									HIDDEN_TILE_PERIOD_FACTOR * update_period);
+		}
+
+		const bool measure_time = !full_refresh && !diffuse_time_query_pending;
+		if (!full_refresh) {
+			// move stale tiles towards the new values
+			glEnable(GL_BLEND);
+			glBlendColor(0.0f, 0.0f, 0.0f, parameters.diffuse_blend);
+			glBlendFunc(GL_CONSTANT_ALPHA, GL_ONE_MINUS_CONSTANT_ALPHA);
+		}
+		if (measure_time)
+			glBeginQuery(GL_TIME_ELAPSED, diffuse_time_query);
+
 		glActiveTexture(GL_TEXTURE0);
 		color_texture.bind();
 		glActiveTexture(GL_TEXTURE1);
@@ -132,10 +423,19 @@ class TexturedTriMesh : public TriMesh {
 						   parameters.angle_scatter);
 
 		vao.bind();
-		glDrawElements(GL_TRIANGLES, indices_count, GL_UNSIGNED_INT, nullptr);
+		draw_elements();
 		// glDrawArrays(MODE, 0, point_count);
 		vao.unbind();
 
+		if (measure_time) {
+			glEndQuery(GL_TIME_ELAPSED);
+			diffuse_time_query_pending = true;
+		}
+		if (!full_refresh)
+			glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		++frame_index;
+
+		glDisable(GL_STENCIL_TEST);
 		diffuse_fbo.unbind();
 		diffuse_texture.unbind();
 	}
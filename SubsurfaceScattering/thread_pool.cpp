@@ -0,0 +1,176 @@
+#include "thread_pool.h"
+#include <algorithm>
+#include <exception>
+
+namespace {
+// worker the current thread is, if any
+thread_local const ThreadPool *current_pool = nullptr;
+thread_local size_t current_worker = 0;
+
+// earliest job on top of the heap
+bool later(const ThreadPool::Clock::time_point &a_time, unsigned long long a_sequence,
+		   const ThreadPool::Clock::time_point &b_time, unsigned long long b_sequence) {
+	return a_time != b_time ? a_time > b_time : a_sequence > b_sequence;
+}
+} // namespace
+
+ThreadPool::ThreadPool(unsigned int worker_count) {
+	worker_count = std::max(worker_count, 1u);
+	for (unsigned int i = 0; i < worker_count; ++i)
+		workers.push_back(std::make_unique<Worker>());
+	// every deque exists before any worker may try to steal from it
+	for (unsigned int i = 0; i < worker_count; ++i)
+		workers[i]->thread = std::thread([this, i]() { worker_loop(i); });
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(sleep_mutex);
+		stopping = true;
+		timed_jobs.clear();
+	}
+	wake.notify_all();
+	for (auto &worker : workers)
+		worker->thread.join();
+}
+
+ThreadPool &ThreadPool::shared() {
+	static ThreadPool pool;
+	return pool;
+}
+
+void ThreadPool::submit(Job job) {
+	const size_t index = current_pool == this ? current_worker : next_worker++ % workers.size();
+	Worker &worker = *workers[index];
+	{
+		// Counted under the lock, so that a worker can't miss it between
+		// checking queued and going to sleep, and before the job is visible,
+		// so that try_pop never takes queued below zero.
+		std::lock_guard<std::mutex> lock(sleep_mutex);
+		++queued;
+	}
+	{
+		std::lock_guard<std::mutex> lock(worker.mutex);
+		worker.jobs.push_back(std::move(job));
+	}
+	wake.notify_one();
+}
+
+void ThreadPool::parallel_for(size_t count, const std::function<void(size_t)> &body) {
+	if (count == 0)
+		return;
+	if (count == 1) {
+		body(0);
+		return;
+	}
+
+	// shared with the helpers, which may start after parallel_for returned and
+	// then find nothing left to take
+	struct Shared {
+		const std::function<void(size_t)> *body;
+		size_t count;
+		std::atomic<size_t> next{0}, done{0};
+		std::mutex mutex;
+		std::exception_ptr error;
+
+		void run() {
+			for (size_t i; (i = next++) < count; ++done) {
+				try {
+					(*body)(i);
+				} catch (...) {
+					std::lock_guard<std::mutex> lock(mutex);
+					if (!error)
+						error = std::current_exception();
+				}
+			}
+		}
+	};
+	auto shared = std::make_shared<Shared>();
+	shared->body = &body;
+	shared->count = count;
+
+	const size_t helpers = std::min(count - 1, workers.size());
+	for (size_t h = 0; h < helpers; ++h)
+		submit([shared]() { shared->run(); });
+	shared->run();
+	while (shared->done < count)
+		std::this_thread::yield();
+	if (shared->error)
+		std::rethrow_exception(shared->error);
+}
+
+void ThreadPool::submit_at(Clock::time_point time, Job job) {
+	if (time <= Clock::now()) {
+		submit(std::move(job));
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(sleep_mutex);
+		if (stopping)
+			return;
+		timed_jobs.push_back({time, timed_sequence++, std::move(job)});
+		std::push_heap(timed_jobs.begin(), timed_jobs.end(), [](const TimedJob &a, const TimedJob &b) {
+			return later(a.time, a.sequence, b.time, b.sequence);
+		});
+	}
+	// a sleeping worker may have to wake up earlier now
+	wake.notify_one();
+}
+
+bool ThreadPool::try_pop(size_t index, Job &job) {
+	const size_t count = workers.size();
+	for (size_t i = 0; i < count; ++i) {
+		Worker &worker = *workers[(index + i) % count];
+		std::lock_guard<std::mutex> lock(worker.mutex);
+		if (worker.jobs.empty())
+			continue;
+		// own jobs newest first, stolen ones oldest first
+		if (i == 0) {
+			job = std::move(worker.jobs.back());
+			worker.jobs.pop_back();
+		} else {
+			job = std::move(worker.jobs.front());
+			worker.jobs.pop_front();
+		}
+		--queued;
+		return true;
+	}
+	return false;
+}
+
+void ThreadPool::worker_loop(size_t index) {
+	current_pool = this;
+	current_worker = index;
+
+	const auto heap_order = [](const TimedJob &a, const TimedJob &b) {
+		return later(a.time, a.sequence, b.time, b.sequence);
+	};
+
+	Job job;
+	while (true) {
+		if (try_pop(index, job)) {
+			job();
+			job = nullptr;
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(sleep_mutex);
+		if (!timed_jobs.empty() && timed_jobs.front().time <= Clock::now()) {
+			std::pop_heap(timed_jobs.begin(), timed_jobs.end(), heap_order);
+			job = std::move(timed_jobs.back().job);
+			timed_jobs.pop_back();
+			lock.unlock();
+			job();
+			job = nullptr;
+			continue;
+		}
+		if (queued > 0)
+			continue;
+		if (stopping)
+			return;
+		if (timed_jobs.empty())
+			wake.wait(lock);
+		else
+			wake.wait_until(lock, timed_jobs.front().time);
+	}
+}
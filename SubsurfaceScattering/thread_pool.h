@@ -0,0 +1,114 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Cooperative cancellation: jobs poll their token, the owner of the source
+// requests the stop. Tokens of a default constructed source never stop.
+class StopToken {
+	friend class StopSource;
+	std::shared_ptr<const std::atomic<bool>> flag;
+
+  public:
+	bool stop_requested() const { return flag && flag->load(std::memory_order_relaxed); }
+};
+
+class StopSource {
+	std::shared_ptr<std::atomic<bool>> flag = std::make_shared<std::atomic<bool>>(false);
+
+  public:
+	StopToken get_token() const {
+		StopToken token;
+		token.flag = flag;
+		return token;
+	}
+	void request_stop() { flag->store(true, std::memory_order_relaxed); }
+	bool stop_requested() const { return flag->load(std::memory_order_relaxed); }
+};
+
+// Fixed set of worker threads with a deque each. Workers run the newest job
+// of their own deque and steal the oldest job of the others when it is empty.
+// Jobs submitted from a worker go to its own deque, others are spread round
+// robin. Timed jobs wait in a heap until they are due and are then run by the
+// first idle worker.
+class ThreadPool {
+  public:
+	using Job = std::function<void()>;
+	using Clock = std::chrono::steady_clock;
+
+	// one worker per hardware thread except the one of the UI
+	explicit ThreadPool(unsigned int worker_count = std::max(2u, std::thread::hardware_concurrency()) - 1);
+	// Runs the queued jobs, drops the timed ones that aren't due yet.
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool &) = delete;
+	ThreadPool &operator=(const ThreadPool &) = delete;
+
+	void submit(Job job);
+	void submit_at(Clock::time_point time, Job job);
+	void submit_after(Clock::duration delay, Job job) { submit_at(Clock::now() + delay, std::move(job)); }
+
+	// Calls body(i) for every i in [0, count) and returns when all calls are
+	// done. The calling thread takes part, workers busy with other jobs join
+	// in when they are free, so it never waits on a full pool.
+	void parallel_for(size_t count, const std::function<void(size_t)> &body);
+
+	// Number of chunks parallel_chunks splits count items into: at most one
+	// per worker and the calling thread, none smaller than min_chunk items.
+	size_t chunk_count(size_t count, size_t min_chunk) const {
+		return std::clamp<size_t>(count / std::max<size_t>(min_chunk, 1), 1, workers.size() + 1);
+	}
+
+	// Calls body(chunk, begin, end) for chunk_count(count, min_chunk)
+	// consecutive chunks of [0, count) with parallel_for. Chunk borders are
+	// multiples of align.
+	template <class F> void parallel_chunks(size_t count, size_t min_chunk, size_t align, F &&body) {
+		const size_t chunks = chunk_count(count, min_chunk);
+		const size_t chunk_size = ((count + chunks - 1) / chunks + align - 1) / align * align;
+		parallel_for(chunks, [&](size_t c) {
+			const size_t begin = std::min(count, c * chunk_size);
+			body(c, begin, std::min(count, begin + chunk_size));
+		});
+	}
+
+	size_t get_worker_count() const { return workers.size(); }
+
+	// pool shared by the whole application, created on first use
+	static ThreadPool &shared();
+
+  private:
+	struct Worker {
+		std::mutex mutex;
+		std::deque<Job> jobs;
+		std::thread thread;
+	};
+
+	struct TimedJob {
+		Clock::time_point time;
+		// submission order, so that jobs due at the same time run in order
+		unsigned long long sequence;
+		Job job;
+	};
+
+	std::vector<std::unique_ptr<Worker>> workers;
+	std::atomic<size_t> next_worker{0};
+
+	// guards the fields below, idle workers wait on wake
+	std::mutex sleep_mutex;
+	std::condition_variable wake;
+	std::atomic<size_t> queued{0};
+	std::vector<TimedJob> timed_jobs; // heap, earliest first
+	unsigned long long timed_sequence = 0;
+	bool stopping = false;
+
+	bool try_pop(size_t index, Job &job);
+	void worker_loop(size_t index);
+};
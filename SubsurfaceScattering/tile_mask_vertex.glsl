@@ -0,0 +1,41 @@
+#version 430 core
+
+layout(std430, binding = 2) buffer tile_mask_data {
+	uint tile_mask[];
+};
+
+uniform ivec2 tile_count;
+uniform vec2 tile_size;
+uniform int tile_margin;
+uniform int use_mask;
+uniform int update_period;
+uniform int hidden_period;
+uniform int frame_index;
+
+bool is_marked(ivec2 tile) {
+	// diffuse texture is sampled with GL_REPEAT, so neighbours wrap around
+	tile = (tile % tile_count + tile_count) % tile_count;
+	int idx = tile.y * tile_count.x + tile.x;
+	return (tile_mask[idx >> 5] & (1u << uint(idx & 31))) != 0u;
+}
+
+void main() {
+	ivec2 tile = ivec2(gl_InstanceID % tile_count.x, gl_InstanceID / tile_count.x);
+
+	bool referenced = use_mask == 0;
+	for (int dy = -tile_margin; dy <= tile_margin && !referenced; ++dy)
+		for (int dx = -tile_margin; dx <= tile_margin && !referenced; ++dx)
+			referenced = is_marked(tile + ivec2(dx, dy));
+
+	// round-robin: every tile is drawn once per its period
+	int period = referenced ? update_period : hidden_period;
+	if (period == 0 || (gl_InstanceID + frame_index) % period != 0) {
+		// degenerate quad outside of the clip volume
+		gl_Position = vec4(2.0f, 2.0f, 2.0f, 1.0f);
+		return;
+	}
+
+	vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+	vec2 uv = (vec2(tile) + corner) * tile_size;
+	gl_Position = vec4(uv.x * 2 - 1, uv.y * 2 - 1, 0.0f, 1.0f);
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+
+// Lock-free hand-off of a value from one writer thread to one reader thread.
+// The writer fills its back buffer and publishes it, the reader picks up the
+// latest published buffer whenever it wants. Neither side ever waits for the
+// other: the writer can publish many times between two reads (the reader only
+// sees the last one), and a buffer being read is never written to.
+template <class T>
+class TripleBuffer {
+	// own cache line each, writer and reader work on different buffers
+	struct alignas(64) Slot {
+		T value{};
+	};
+
+	static constexpr unsigned char INDEX_MASK = 3;
+	// set in shared when it holds a buffer the reader hasn't seen yet
+	static constexpr unsigned char FRESH = 4;
+
+	Slot slots[3];
+	// the buffer between the two sides
+	alignas(64) std::atomic<unsigned char> shared{ 1 };
+	// touched by the writer only
+	alignas(64) unsigned char write_index = 0;
+	// touched by the reader only
+	alignas(64) unsigned char read_index = 2;
+
+public:
+	// Writer side: the buffer to fill before publish().
+	T& write_buffer() { return slots[write_index].value; }
+
+	// Writer side: makes the write buffer the latest state and takes over
+	// the one the reader gave back, which may hold an older state.
+	void publish() {
+		write_index = shared.exchange(write_index | FRESH, std::memory_order_acq_rel) & INDEX_MASK;
+	}
+
+	void publish(const T& value) {
+		write_buffer() = value;
+		publish();
+	}
+
+	// Reader side: switches to the latest published state. Returns false and
+	// keeps the current read buffer if nothing was published since.
+	bool update() {
+		if (!(shared.load(std::memory_order_relaxed) & FRESH))
+			return false;
+		read_index = shared.exchange(read_index, std::memory_order_acq_rel) & INDEX_MASK;
+		return true;
+	}
+
+	// Reader side: the state picked up by the last update(), a default
+	// constructed T before the first one.
+	const T& read_buffer() const { return slots[read_index].value; }
+};
@@ -0,0 +1,243 @@
+#include "vertex_kernels.h"
+#include "simd_pack.h"
+#include "thread_pool.h"
+#include <cmath>
+#include <vector>
+
+namespace {
+
+using simd::Pack, simd::WIDTH, simd::splat, simd::mul, simd::madd, simd::min, simd::max, simd::abs, simd::rsqrt,
+	simd::hmin, simd::hmax, simd::deinterleave, simd::interleave;
+
+struct Block {
+	Pack x, y, z;
+};
+
+// Accessors load and store WIDTH vertices at a time. Partial blocks at the
+// end of an array go through a staging buffer padded with the last vertex,
+// so kernels always see full blocks and reductions aren't affected.
+struct AosAccess {
+	const Vector3 *in;
+	Vector3 *out;
+
+	Block load(size_t i) const {
+		Block b;
+		deinterleave(&in[i].x, b.x, b.y, b.z);
+		return b;
+	}
+	void store(size_t i, const Block &b) const { interleave(&out[i].x, b.x, b.y, b.z); }
+
+	Block load_partial(size_t i, size_t n) const {
+		Vector3 staging[WIDTH];
+		for (size_t k = 0; k < WIDTH; ++k)
+			staging[k] = in[i + std::min(k, n - 1)];
+		return AosAccess{staging, nullptr}.load(0);
+	}
+	void store_partial(size_t i, size_t n, const Block &b) const {
+		Vector3 staging[WIDTH];
+		AosAccess{nullptr, staging}.store(0, b);
+		std::copy(staging, staging + n, out + i);
+	}
+};
+
+struct SoaAccess {
+	Vector3SoaView in, out;
+
+	Block load(size_t i) const { return {simd::load(in.x + i), simd::load(in.y + i), simd::load(in.z + i)}; }
+	void store(size_t i, const Block &b) const {
+		simd::store(out.x + i, b.x);
+		simd::store(out.y + i, b.y);
+		simd::store(out.z + i, b.z);
+	}
+
+	Block load_partial(size_t i, size_t n) const {
+		float x[WIDTH], y[WIDTH], z[WIDTH];
+		for (size_t k = 0; k < WIDTH; ++k) {
+			const size_t j = i + std::min(k, n - 1);
+			x[k] = in.x[j];
+			y[k] = in.y[j];
+			z[k] = in.z[j];
+		}
+		return {simd::load(x), simd::load(y), simd::load(z)};
+	}
+	void store_partial(size_t i, size_t n, const Block &b) const {
+		float x[WIDTH], y[WIDTH], z[WIDTH];
+		simd::store(x, b.x);
+		simd::store(y, b.y);
+		simd::store(z, b.z);
+		std::copy(x, x + n, out.x + i);
+		std::copy(y, y + n, out.y + i);
+		std::copy(z, z + n, out.z + i);
+	}
+};
+
+// arrays below PARALLEL_THRESHOLD get a single chunk
+constexpr size_t MIN_CHUNK = vertex_kernels::PARALLEL_THRESHOLD / 2;
+
+// Stores kernel(block) of every block read by src through dst.
+template <class Src, class Dst, class F> void map(const Src &src, const Dst &dst, size_t count, F &&kernel) {
+	ThreadPool::shared().parallel_chunks(count, MIN_CHUNK, WIDTH, [&](size_t, size_t begin, size_t end) {
+		size_t i = begin;
+		for (; i + WIDTH <= end; i += WIDTH)
+			dst.store(i, kernel(src.load(i)));
+		if (i < end)
+			dst.store_partial(i, end - i, kernel(src.load_partial(i, end - i)));
+	});
+}
+
+template <class Access, class F> void map(const Access &access, size_t count, F &&kernel) {
+	map(access, access, count, kernel);
+}
+
+// kernel(accumulator, block) is called for every block, accumulators of the
+// chunks are combined with merge(accumulator, accumulator)
+template <class Access, class A, class F, class M>
+A reduce(const Access &access, size_t count, const A &initial, F &&kernel, M &&merge) {
+	std::vector<A> partial(ThreadPool::shared().chunk_count(count, MIN_CHUNK), initial);
+	ThreadPool::shared().parallel_chunks(count, MIN_CHUNK, WIDTH, [&](size_t chunk, size_t begin, size_t end) {
+		A &acc = partial[chunk];
+		size_t i = begin;
+		for (; i + WIDTH <= end; i += WIDTH)
+			kernel(acc, access.load(i));
+		if (i < end)
+			kernel(acc, access.load_partial(i, end - i));
+	});
+	A result = initial;
+	for (const auto &acc : partial)
+		result = merge(result, acc);
+	return result;
+}
+
+struct BoundsAccumulator {
+	Pack min_x, max_x, min_y, max_y, min_z, max_z;
+};
+
+template <class Access> Box bounds_kernel(const Access &access, size_t count) {
+	const float inf = INFINITY;
+	const BoundsAccumulator initial = {splat(inf), splat(-inf), splat(inf), splat(-inf), splat(inf), splat(-inf)};
+	const auto acc = reduce(
+		access, count, initial,
+		[](BoundsAccumulator &a, const Block &b) {
+			a.min_x = min(a.min_x, b.x);
+			a.max_x = max(a.max_x, b.x);
+			a.min_y = min(a.min_y, b.y);
+			a.max_y = max(a.max_y, b.y);
+			a.min_z = min(a.min_z, b.z);
+			a.max_z = max(a.max_z, b.z);
+		},
+		[](const BoundsAccumulator &a, const BoundsAccumulator &b) {
+			return BoundsAccumulator{min(a.min_x, b.min_x), max(a.max_x, b.max_x), min(a.min_y, b.min_y),
+									 max(a.max_y, b.max_y), min(a.min_z, b.min_z), max(a.max_z, b.max_z)};
+		});
+	return {hmin(acc.min_x), hmax(acc.max_x), hmin(acc.min_y), hmax(acc.max_y), hmin(acc.min_z), hmax(acc.max_z)};
+}
+
+template <class Access> float max_abs_coordinate_kernel(const Access &access, size_t count) {
+	const Pack acc = reduce(
+		access, count, splat(0.0f),
+		[](Pack &a, const Block &b) { a = max(a, max(abs(b.x), max(abs(b.y), abs(b.z)))); },
+		[](const Pack &a, const Pack &b) { return max(a, b); });
+	return hmax(acc);
+}
+
+template <class Access> void scale_offset_kernel(const Access &access, size_t count, float scale, const Vector3 &offset) {
+	const Pack s = splat(scale), ox = splat(offset.x), oy = splat(offset.y), oz = splat(offset.z);
+	map(access, count, [&](const Block &b) { return Block{madd(s, b.x, ox), madd(s, b.y, oy), madd(s, b.z, oz)}; });
+}
+
+// rows of the upper 3x4 part of a matrix, broadcast to packs
+struct PackedMatrix {
+	Pack m[3][4];
+
+	explicit PackedMatrix(const Matrix4x4 &mat) {
+		for (int i = 0; i < 3; ++i)
+			for (int j = 0; j < 4; ++j)
+				m[i][j] = splat(mat.elem[i][j]);
+	}
+
+	inline Pack row(int i, const Block &b, Pack w) const {
+		return madd(m[i][0], b.x, madd(m[i][1], b.y, madd(m[i][2], b.z, w)));
+	}
+};
+
+template <class Access> void transform_points_kernel(const Matrix4x4 &transform, const Access &access, size_t count) {
+	const PackedMatrix m(transform);
+	map(access, count, [&](const Block &b) { return Block{m.row(0, b, m.m[0][3]), m.row(1, b, m.m[1][3]), m.row(2, b, m.m[2][3])}; });
+}
+
+inline Block normalized(const Block &b) {
+	const Pack inv_length = rsqrt(madd(b.x, b.x, madd(b.y, b.y, mul(b.z, b.z))));
+	return {mul(b.x, inv_length), mul(b.y, inv_length), mul(b.z, inv_length)};
+}
+
+template <class Access> void transform_normals_kernel(const Matrix4x4 &normal_matrix, const Access &access, size_t count) {
+	const PackedMatrix m(normal_matrix);
+	const Pack zero = splat(0.0f);
+	map(access, count, [&](const Block &b) { return normalized(Block{m.row(0, b, zero), m.row(1, b, zero), m.row(2, b, zero)}); });
+}
+
+template <class Access> void normalize_kernel(const Access &access, size_t count) {
+	map(access, count, [](const Block &b) { return normalized(b); });
+}
+
+} // namespace
+
+namespace vertex_kernels {
+
+Box bounds(const Vector3 *vertices, size_t count) {
+	return bounds_kernel(AosAccess{vertices, nullptr}, count);
+}
+
+Box bounds(const Vector3SoaView &vertices) {
+	return bounds_kernel(SoaAccess{vertices, {}}, vertices.count);
+}
+
+float max_abs_coordinate(const Vector3 *vertices, size_t count) {
+	return max_abs_coordinate_kernel(AosAccess{vertices, nullptr}, count);
+}
+
+float max_abs_coordinate(const Vector3SoaView &vertices) {
+	return max_abs_coordinate_kernel(SoaAccess{vertices, {}}, vertices.count);
+}
+
+void scale_offset(const Vector3 *in, Vector3 *out, size_t count, float scale, const Vector3 &offset) {
+	scale_offset_kernel(AosAccess{in, out}, count, scale, offset);
+}
+
+void scale_offset(const Vector3SoaView &in, const Vector3SoaView &out, float scale, const Vector3 &offset) {
+	scale_offset_kernel(SoaAccess{in, out}, in.count, scale, offset);
+}
+
+void transform_points(const Matrix4x4 &transform, const Vector3 *in, Vector3 *out, size_t count) {
+	transform_points_kernel(transform, AosAccess{in, out}, count);
+}
+
+void transform_points(const Matrix4x4 &transform, const Vector3SoaView &in, const Vector3SoaView &out) {
+	transform_points_kernel(transform, SoaAccess{in, out}, in.count);
+}
+
+void transform_normals(const Matrix4x4 &normal_matrix, const Vector3 *in, Vector3 *out, size_t count) {
+	transform_normals_kernel(normal_matrix, AosAccess{in, out}, count);
+}
+
+void transform_normals(const Matrix4x4 &normal_matrix, const Vector3SoaView &in, const Vector3SoaView &out) {
+	transform_normals_kernel(normal_matrix, SoaAccess{in, out}, in.count);
+}
+
+void normalize(const Vector3 *in, Vector3 *out, size_t count) {
+	normalize_kernel(AosAccess{in, out}, count);
+}
+
+void normalize(const Vector3SoaView &in, const Vector3SoaView &out) {
+	normalize_kernel(SoaAccess{in, out}, in.count);
+}
+
+void to_soa(const Vector3 *in, const Vector3SoaView &out) {
+	map(AosAccess{in, nullptr}, SoaAccess{{}, out}, out.count, [](const Block &b) { return b; });
+}
+
+void to_aos(const Vector3SoaView &in, Vector3 *out) {
+	map(SoaAccess{in, {}}, AosAccess{nullptr, out}, in.count, [](const Block &b) { return b; });
+}
+
+} // namespace vertex_kernels
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "algebra.h"
+#include "box.h"
+#include <cstddef>
+
+// Batched kernels for whole vertex arrays, used by import-time geometry
+// processing. Every kernel accepts either an AoS array of Vector3 or a
+// Vector3SoaView, works on a SIMD pack of vertices at a time (simd_pack.h:
+// 16 with AVX-512, 8 with AVX, 4 with SSE) and splits large arrays into
+// chunks processed on all hardware threads. Output arrays may alias the
+// input.
+
+struct Vector3SoaView {
+	float *x, *y, *z;
+	size_t count;
+};
+
+namespace vertex_kernels {
+
+// arrays shorter than this are processed on the calling thread only
+constexpr size_t PARALLEL_THRESHOLD = 1 << 16;
+
+Box bounds(const Vector3 *vertices, size_t count);
+Box bounds(const Vector3SoaView &vertices);
+
+// largest absolute value of any coordinate
+float max_abs_coordinate(const Vector3 *vertices, size_t count);
+float max_abs_coordinate(const Vector3SoaView &vertices);
+
+// v = scale * v + offset
+void scale_offset(const Vector3 *in, Vector3 *out, size_t count, float scale, const Vector3 &offset);
+void scale_offset(const Vector3SoaView &in, const Vector3SoaView &out, float scale, const Vector3 &offset);
+
+// points are extended with w = 1, the result isn't divided by w
+void transform_points(const Matrix4x4 &transform, const Vector3 *in, Vector3 *out, size_t count);
+void transform_points(const Matrix4x4 &transform, const Vector3SoaView &in, const Vector3SoaView &out);
+
+// normals are extended with w = 0 and normalized after the transform, pass
+// the inverse transpose of the model matrix
+void transform_normals(const Matrix4x4 &normal_matrix, const Vector3 *in, Vector3 *out, size_t count);
+void transform_normals(const Matrix4x4 &normal_matrix, const Vector3SoaView &in, const Vector3SoaView &out);
+
+void normalize(const Vector3 *in, Vector3 *out, size_t count);
+void normalize(const Vector3SoaView &in, const Vector3SoaView &out);
+
+void to_soa(const Vector3 *in, const Vector3SoaView &out);
+void to_aos(const Vector3SoaView &in, Vector3 *out);
+
+} // namespace vertex_kernels
@@ -0,0 +1,26 @@
+#version 430 core
+
+layout(early_fragment_tests) in;
+
+in vec2 uv;
+
+layout(std430, binding = 2) buffer tile_mask_data {
+	uint tile_mask[];
+};
+
+uniform ivec2 tile_count;
+uniform int mark_tiles;
+
+void main() {
+	if (mark_tiles == 0)
+		return;
+
+	ivec2 tile = clamp(ivec2(fract(uv) * vec2(tile_count)), ivec2(0, 0),
+					   tile_count - ivec2(1, 1));
+	int idx = tile.y * tile_count.x + tile.x;
+	uint bit = 1u << uint(idx & 31);
+
+	// most fragments hit tiles which are already marked, skip the atomic then
+	if ((tile_mask[idx >> 5] & bit) == 0u)
+		atomicOr(tile_mask[idx >> 5], bit);
+}
@@ -21,6 +21,14 @@ protected:
 	ThreadTask& start_thread_task(ThreadTask&& task) {
 		return task_manager->add_thread_task(std::move(task));
 	}
+	CoroutineTask& start_coroutine(CoroutineTask&& task) {
+		return task_manager->add_coroutine(std::move(task));
+	}
+	const TaskManager& get_task_manager() const { return *task_manager; }
+	// runs at the start of the next frame, with the task steps
+	FrameJob& add_frame_job(std::string name, JobAffinity affinity, std::function<void()> body) {
+		return task_manager->add_frame_job(std::move(name), affinity, std::move(body));
+	}
 public:
 	bool visible = true;
 	const char* get_name() const { return name.c_str(); }
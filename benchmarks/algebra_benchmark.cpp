@@ -0,0 +1,65 @@
+#include "benchmark.h"
+#include "algebra.h"
+#include <random>
+
+namespace {
+constexpr size_t INPUT_COUNT = 256;
+constexpr size_t INPUT_MASK = INPUT_COUNT - 1;
+
+struct AlgebraInputs {
+	std::vector<Matrix4x4> matrices;
+	std::vector<Vector4> vectors;
+
+	AlgebraInputs() : matrices(INPUT_COUNT), vectors(INPUT_COUNT) {
+		std::mt19937 gen(42);
+		std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+		for (auto &m : matrices)
+			for (auto &row : m.elem)
+				for (auto &e : row)
+					e = dist(gen);
+		for (auto &v : vectors)
+			v = {dist(gen), dist(gen), dist(gen), dist(gen)};
+	}
+};
+} // namespace
+
+void run_algebra_benchmarks(BenchmarkSuite &suite) {
+	const AlgebraInputs in;
+	const auto &m = in.matrices;
+	const auto &v = in.vectors;
+
+	suite.run("Matrix4x4 * Matrix4x4 (scalar)", [&](size_t i) {
+		do_not_optimize(scalar_kernels::mul(m[i & INPUT_MASK], m[(i + 1) & INPUT_MASK]));
+	});
+	suite.run("Matrix4x4 * Matrix4x4", [&](size_t i) {
+		do_not_optimize(m[i & INPUT_MASK] * m[(i + 1) & INPUT_MASK]);
+	});
+
+	suite.run("Matrix4x4 * Vector4 (scalar)", [&](size_t i) {
+		do_not_optimize(scalar_kernels::mul(m[i & INPUT_MASK], v[i & INPUT_MASK]));
+	});
+	suite.run("Matrix4x4 * Vector4", [&](size_t i) {
+		do_not_optimize(m[i & INPUT_MASK] * v[i & INPUT_MASK]);
+	});
+
+	suite.run("transpose(Matrix4x4) (scalar)", [&](size_t i) {
+		do_not_optimize(scalar_kernels::transpose(m[i & INPUT_MASK]));
+	});
+	suite.run("transpose(Matrix4x4)", [&](size_t i) {
+		do_not_optimize(transpose(m[i & INPUT_MASK]));
+	});
+
+	suite.run("mul_with_first_transposed (scalar)", [&](size_t i) {
+		do_not_optimize(scalar_kernels::mul_with_first_transposed(m[i & INPUT_MASK], m[(i + 1) & INPUT_MASK]));
+	});
+	suite.run("mul_with_first_transposed", [&](size_t i) {
+		do_not_optimize(mul_with_first_transposed(m[i & INPUT_MASK], m[(i + 1) & INPUT_MASK]));
+	});
+
+	suite.run("dot(Vector4) (scalar)", [&](size_t i) {
+		do_not_optimize(scalar_kernels::dot(v[i & INPUT_MASK], v[(i + 1) & INPUT_MASK]));
+	});
+	suite.run("dot(Vector4)", [&](size_t i) {
+		do_not_optimize(dot(v[i & INPUT_MASK], v[(i + 1) & INPUT_MASK]));
+	});
+}
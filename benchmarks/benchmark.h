@@ -0,0 +1,118 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Keeps the compiler from optimizing away computation of value.
+template <class T> inline void do_not_optimize(const T &value) {
+#if defined(__GNUC__) || defined(__clang__)
+	asm volatile("" : : "r"(&value) : "memory");
+#else
+	static const volatile void *sink;
+	sink = &value;
+#endif
+}
+
+struct BenchmarkResult {
+	std::string name;
+	double median_ns;
+	double min_ns;
+	double mad_ns; // median absolute deviation
+	size_t iterations_per_sample;
+};
+
+// Minimal harness: every benchmark is calibrated so that one sample takes
+// roughly SAMPLE_TIME, then SAMPLE_COUNT samples are taken and summarized with
+// median and MAD, which are stable against scheduling noise.
+class BenchmarkSuite {
+	static constexpr std::chrono::microseconds SAMPLE_TIME{2000};
+	static constexpr int SAMPLE_COUNT = 31;
+
+	std::vector<BenchmarkResult> results;
+	std::string filter;
+
+	template <class F> static double time_batch(F &body, size_t iterations) {
+		const auto start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < iterations; ++i)
+			body(i);
+		const auto end = std::chrono::steady_clock::now();
+		return std::chrono::duration<double, std::nano>(end - start).count();
+	}
+
+	static double median(std::vector<double> values) {
+		std::sort(values.begin(), values.end());
+		return values[values.size() / 2];
+	}
+
+  public:
+	// Only benchmarks with names containing filter are run.
+	void set_filter(const std::string &filter) { this->filter = filter; }
+
+	// Runs body(i) repeatedly, i is the iteration index.
+	template <class F> void run(const std::string &name, F &&body) {
+		if (name.find(filter) == std::string::npos)
+			return;
+
+		size_t iterations = 1;
+		while (time_batch(body, iterations) <
+				   std::chrono::duration<double, std::nano>(SAMPLE_TIME).count() &&
+			   iterations < (size_t(1) << 30))
+			iterations *= 2;
+
+		std::vector<double> samples(SAMPLE_COUNT);
+		for (auto &sample : samples)
+			sample = time_batch(body, iterations) / iterations;
+
+		const double med = median(samples);
+		std::vector<double> deviations(samples.size());
+		for (size_t i = 0; i < samples.size(); ++i)
+			deviations[i] = std::abs(samples[i] - med);
+
+		results.push_back({name, med,
+						   *std::min_element(samples.begin(), samples.end()),
+						   median(deviations), iterations});
+		const auto &r = results.back();
+		printf("%-48s %12.2f ns %10.2f ns (min) %8.2f ns (mad)\n", r.name.c_str(),
+			   r.median_ns, r.min_ns, r.mad_ns);
+	}
+
+	// Prints a value computed next to the benchmarks, e.g. the error of a
+	// faster variant, if name passes the filter.
+	void report(const std::string &name, double value) const {
+		if (name.find(filter) == std::string::npos)
+			return;
+		printf("%-48s %12.3g\n", name.c_str(), value);
+	}
+
+	const std::vector<BenchmarkResult> &get_results() const { return results; }
+
+	// Writes all results as a JSON array, returns false if the file can't be
+	// opened.
+	bool write_json(const char *filename) const {
+		FILE *file = fopen(filename, "w");
+		if (!file)
+			return false;
+		fprintf(file, "[\n");
+		for (size_t i = 0; i < results.size(); ++i) {
+			const auto &r = results[i];
+			std::string name;
+			for (char c : r.name) {
+				if (c == '"' || c == '\\')
+					name += '\\';
+				name += c;
+			}
+			fprintf(file,
+					"  {\"name\": \"%s\", \"median_ns\": %.3f, \"min_ns\": %.3f, "
+					"\"mad_ns\": %.3f, \"iterations_per_sample\": %zu, \"samples\": %d}%s\n",
+					name.c_str(), r.median_ns, r.min_ns, r.mad_ns, r.iterations_per_sample, SAMPLE_COUNT,
+					i + 1 < results.size() ? "," : "");
+		}
+		fprintf(file, "]\n");
+		fclose(file);
+		return true;
+	}
+};
@@ -0,0 +1,78 @@
+#include "benchmark.h"
+#include "bernstein_weights.h"
+#include <random>
+
+namespace {
+// a dense scan fitted into the lattice
+constexpr size_t VERTEX_COUNT = 200'000;
+
+Vector3 de_casteljau3(Vector3 b0, Vector3 b1, Vector3 b2, Vector3 b3, float t) {
+	const float s = 1.0f - t;
+	b0 = s * b0 + t * b1;
+	b1 = s * b1 + t * b2;
+	b2 = s * b2 + t * b3;
+	b0 = s * b0 + t * b1;
+	b1 = s * b1 + t * b2;
+	return s * b0 + t * b1;
+}
+
+Vector3 de_casteljau2(Vector3 b0, Vector3 b1, Vector3 b2, float t) {
+	const float s = 1.0f - t;
+	b0 = s * b0 + t * b1;
+	b1 = s * b1 + t * b2;
+	return s * b0 + t * b1;
+}
+
+// deform_point_and_normal of phong_deformed_vertex_shader.glsl
+Vector3 deform_point_and_normal(const Vector3 *bezier, const Vector3 &p, const Vector3 &n, Vector3 &normal) {
+	Vector3 patch_points[16], dpatch_points[16];
+	for (int i = 0; i < 16; ++i) {
+		const Vector3 *b = bezier + 4 * i;
+		patch_points[i] = de_casteljau3(b[0], b[1], b[2], b[3], p.x);
+		dpatch_points[i] = 3.0f * de_casteljau2(b[1] - b[0], b[2] - b[1], b[3] - b[2], p.x);
+	}
+	Vector3 q[4], dq[4], qd[4];
+	for (int i = 0; i < 4; ++i) {
+		const Vector3 *a = patch_points + 4 * i, *da = dpatch_points + 4 * i;
+		q[i] = de_casteljau3(a[0], a[1], a[2], a[3], p.y);
+		dq[i] = de_casteljau3(da[0], da[1], da[2], da[3], p.y);
+		qd[i] = 3.0f * de_casteljau2(a[1] - a[0], a[2] - a[1], a[3] - a[2], p.y);
+	}
+	const Vector3 dx = de_casteljau3(dq[0], dq[1], dq[2], dq[3], p.z);
+	const Vector3 dy = de_casteljau3(qd[0], qd[1], qd[2], qd[3], p.z);
+	const Vector3 dz = 3.0f * de_casteljau2(q[1] - q[0], q[2] - q[1], q[3] - q[2], p.z);
+	const Vector3 yz = cross(dy, dz);
+	const Vector3 m = n.x * yz + n.y * cross(dz, dx) + n.z * cross(dx, dy);
+	normal = normalize(dot(dx, yz) < 0.0f ? -m : m);
+	return de_casteljau3(q[0], q[1], q[2], q[3], p.z);
+}
+} // namespace
+
+void run_bernstein_benchmarks(BenchmarkSuite &suite) {
+	std::mt19937 gen(42);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f), jitter(-0.1f, 0.1f);
+	std::vector<Vector3> rest(VERTEX_COUNT), rest_normals(VERTEX_COUNT);
+	for (size_t v = 0; v < VERTEX_COUNT; ++v) {
+		rest[v] = {unit(gen), unit(gen), unit(gen)};
+		rest_normals[v] = normalize(Vector3{jitter(gen), jitter(gen), jitter(gen)} + Vector3{0.0f, 0.0f, 0.1f});
+	}
+	Vector3 lattice[BernsteinWeights::LATTICE_POINT_COUNT];
+	for (int k = 0; k < 4; ++k)
+		for (int j = 0; j < 4; ++j)
+			for (int i = 0; i < 4; ++i)
+				lattice[i + 4 * j + 16 * k] = Vector3{i / 3.0f, j / 3.0f, k / 3.0f} +
+											  Vector3{jitter(gen), jitter(gen), jitter(gen)};
+
+	const BernsteinWeights weights(rest.data(), rest_normals.data(), VERTEX_COUNT);
+	std::vector<Vector3> positions(VERTEX_COUNT), normals(VERTEX_COUNT);
+
+	suite.run("deform 200k vertices (de Casteljau)", [&](size_t) {
+		for (size_t v = 0; v < VERTEX_COUNT; ++v)
+			positions[v] = deform_point_and_normal(lattice, rest[v], rest_normals[v], normals[v]);
+		do_not_optimize(positions[0]);
+	});
+	suite.run("deform 200k vertices (Bernstein weights)", [&](size_t) {
+		weights.deform(lattice, positions.data(), normals.data());
+		do_not_optimize(positions[0]);
+	});
+}
@@ -0,0 +1,63 @@
+#include "benchmark.h"
+#include "box.h"
+#include "camera.h"
+#include "quaternion.h"
+#include <random>
+
+namespace {
+constexpr size_t INPUT_COUNT = 256;
+constexpr size_t INPUT_MASK = INPUT_COUNT - 1;
+} // namespace
+
+void run_camera_benchmarks(BenchmarkSuite &suite) {
+	std::mt19937 gen(42);
+	std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+
+	std::vector<Vector3> points(INPUT_COUNT);
+	for (auto &p : points)
+		p = {dist(gen), dist(gen), dist(gen)};
+
+	suite.run("Camera()", [&](size_t) { do_not_optimize(Camera()); });
+
+	Camera camera;
+	camera.set_viewport(1280, 720);
+	suite.run("Camera::rotate", [&](size_t i) {
+		camera.rotate(1e-3f * points[i & INPUT_MASK].x, 1e-3f * points[i & INPUT_MASK].y, 0.0f);
+		do_not_optimize(camera);
+	});
+	suite.run("get_projection_view_matrix (cached)", [&](size_t) {
+		do_not_optimize(camera.get_projection_view_matrix(1280, 720));
+	});
+	suite.run("get_projection_view_matrix (after move)", [&](size_t i) {
+		camera.move_by(1e-3f * points[i & INPUT_MASK]);
+		do_not_optimize(camera.get_projection_view_matrix(1280, 720));
+	});
+
+	Camera light_camera;
+	Box box = Box::degenerate();
+	for (const auto &p : points)
+		box.add(p);
+	suite.run("Camera::look_from_at_box", [&](size_t i) {
+		light_camera.look_from_at_box(points[i & INPUT_MASK] + Vector3{3.0f, 3.0f, 3.0f}, box,
+									  Matrix4x4::identity());
+		do_not_optimize(light_camera);
+	});
+
+	suite.run("Box::add, 256 points", [&](size_t) {
+		Box b = Box::degenerate();
+		for (const auto &p : points)
+			b.add(p);
+		do_not_optimize(b);
+	});
+	const Matrix4x4 transform = Matrix4x4::uniform_scale(2.0f);
+	suite.run("Box::center(transform)", [&](size_t) { do_not_optimize(box.center(transform)); });
+
+	std::vector<Quaternion<float>> rotations(INPUT_COUNT);
+	for (auto &q : rotations) {
+		q = {dist(gen), dist(gen), dist(gen), dist(gen)};
+		q.normalize();
+	}
+	suite.run("slerp", [&](size_t i) {
+		do_not_optimize(slerp(rotations[i & INPUT_MASK], rotations[(i + 1) & INPUT_MASK], 0.3f));
+	});
+}
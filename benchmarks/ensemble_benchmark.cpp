@@ -0,0 +1,100 @@
+#include "benchmark.h"
+#include "algebra.h"
+#include "ensemble_simulation.h"
+
+namespace {
+constexpr size_t MEMBER_COUNT = 4096;
+constexpr int STEPS = 100;
+const float UNIT_INV_INERTIA[3] = {12.0f / 11.0f, 6.0f, 12.0f / 11.0f};
+
+// one simulation at a time, as SpringSimulation and SpinningTopSimulation
+// step their single state
+struct SpringState {
+	float m, c, k, x, v;
+};
+
+void step_spring(SpringState &s, float dt) {
+	const float force = s.c * (0.0f - s.x) - s.k * s.v;
+	s.x += dt * s.v;
+	s.v += dt * force / s.m;
+}
+
+struct TopState {
+	SpinningTopModel model;
+	SpinningTopModel::State x;
+};
+
+void step_top(TopState &s, float dt) {
+	using State = SpinningTopModel::State;
+	const State k1 = s.model.derivative(s.x);
+	const State k2 = s.model.derivative(State(s.x + (dt / 2.0f) * k1));
+	const State k3 = s.model.derivative(State(s.x + (dt / 2.0f) * k2));
+	const State k4 = s.model.derivative(State(s.x + dt * k3));
+	s.x = s.x + (dt / 6.0f) * (k1 + 2.0f * k2 + 2.0f * k3 + k4);
+	const float inv_length = 1.0f / std::sqrt(s.x[3] * s.x[3] + s.x[4] * s.x[4] + s.x[5] * s.x[5] + s.x[6] * s.x[6]);
+	for (int i = 3; i < 7; ++i)
+		s.x[i] *= inv_length;
+}
+} // namespace
+
+void run_ensemble_benchmarks(BenchmarkSuite &suite) {
+	std::vector<SpringState> springs(MEMBER_COUNT);
+	SpringEnsemble spring_ensemble;
+	for (size_t i = 0; i < MEMBER_COUNT; ++i) {
+		const float k = 0.5f + i * 0.001f;
+		springs[i] = {1.0f, 1.0f, k, 1.0f, 0.0f};
+		spring_ensemble.add({1.0f, 1.0f, k, 1.0f, 0.0f});
+	}
+
+	// both restart every iteration, damped states would decay to denormals
+	const auto spring_start = springs;
+	suite.run("4096 springs, 100 steps (one at a time)", [&](size_t) {
+		springs = spring_start;
+		for (auto &s : springs)
+			for (int step = 0; step < STEPS; ++step)
+				step_spring(s, 0.005f);
+		do_not_optimize(springs[0]);
+	});
+	suite.run("4096 springs, 100 steps (ensemble)", [&](size_t) {
+		spring_ensemble.reset();
+		spring_ensemble.run(STEPS);
+		do_not_optimize(spring_ensemble.get_position(0));
+	});
+
+	std::vector<TopState> tops(MEMBER_COUNT);
+	SpinningTopEnsemble top_ensemble(0.005f, UNIT_INV_INERTIA);
+	for (size_t i = 0; i < MEMBER_COUNT; ++i) {
+		const float angular_velocity = PI * (0.5f + i * 0.001f);
+		top_ensemble.add({angular_velocity * 180.0f / PI, 30.0f, 1.0f, 1.0f});
+		tops[i].model = top_ensemble.get_model(i);
+		for (int c = 0; c < 7; ++c)
+			tops[i].x[c] = top_ensemble.get_state(i, c);
+	}
+
+	const auto top_start = tops;
+	suite.run("4096 spinning tops, 100 steps (one at a time)", [&](size_t) {
+		tops = top_start;
+		for (auto &s : tops)
+			for (int step = 0; step < STEPS; ++step)
+				step_top(s, 0.005f);
+		do_not_optimize(tops[0]);
+	});
+	suite.run("4096 spinning tops, 100 steps (ensemble)", [&](size_t) {
+		top_ensemble.reset();
+		top_ensemble.run(STEPS);
+		do_not_optimize(top_ensemble.get_state(0, 0));
+	});
+
+	// both integrate SpinningTopModel, they differ by rounding only
+	tops = top_start;
+	top_ensemble.reset();
+	top_ensemble.run(STEPS);
+	float difference = 0.0f;
+	for (size_t i = 0; i < MEMBER_COUNT; ++i) {
+		for (int step = 0; step < STEPS; ++step)
+			step_top(tops[i], 0.005f);
+		for (int c = 0; c < 7; ++c)
+			difference = std::max(difference, std::abs(tops[i].x[c] - top_ensemble.get_state(i, c)));
+	}
+	suite.report("4096 spinning tops, ensemble max state difference", difference);
+}
@@ -0,0 +1,83 @@
+#include "benchmark.h"
+#include "generic_vector.h"
+#include <random>
+
+namespace {
+// Copy of the previous Vector<T, DIM> arithmetic, where every operator
+// returned a new vector, kept as the baseline for the expression templates.
+template <class T, size_t DIM>
+struct EagerVector {
+	T elem[DIM];
+	T& operator[](size_t idx) { return elem[idx]; }
+	const T& operator[](size_t idx) const { return elem[idx]; }
+};
+
+template <class T, size_t DIM>
+EagerVector<T, DIM> operator+(const EagerVector<T, DIM>& v1, const EagerVector<T, DIM>& v2) {
+	EagerVector<T, DIM> res;
+	for (size_t i = 0; i < DIM; ++i)
+		res[i] = v1[i] + v2[i];
+	return res;
+}
+
+template <class T, size_t DIM>
+EagerVector<T, DIM> operator*(const T& a, const EagerVector<T, DIM>& v) {
+	EagerVector<T, DIM> res;
+	for (size_t i = 0; i < DIM; ++i)
+		res[i] = a * v[i];
+	return res;
+}
+
+// Damped linear ODE, cheap enough for the vector arithmetic to dominate.
+template <class V, size_t DIM>
+V derivative(const V& x) {
+	V res;
+	for (size_t i = 0; i < DIM; ++i)
+		res[i] = -0.5f * x[(i + 1) % DIM] - 0.1f * x[i];
+	return res;
+}
+
+// One classic Runge-Kutta step, written the way the ODE solvers use Vector.
+template <class V, size_t DIM>
+void rk4_step(V& x, float h) {
+	const V k1 = derivative<V, DIM>(x);
+	const V k2 = derivative<V, DIM>(V(x + (h / 2) * k1));
+	const V k3 = derivative<V, DIM>(V(x + (h / 2) * k2));
+	const V k4 = derivative<V, DIM>(V(x + h * k3));
+	x = x + (h / 6) * (k1 + 2.0f * k2 + 2.0f * k3 + k4);
+}
+
+template <class V, size_t DIM>
+V random_state() {
+	std::mt19937 gen(42);
+	std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+	V res;
+	for (size_t i = 0; i < DIM; ++i)
+		res[i] = dist(gen);
+	return res;
+}
+
+template <size_t DIM>
+void run_rk4_benchmarks(BenchmarkSuite& suite) {
+	constexpr float h = 1e-3f;
+	const std::string dim = std::to_string(DIM);
+
+	auto eager = random_state<EagerVector<float, DIM>, DIM>();
+	suite.run("RK4 step, DIM " + dim + " (temporaries)", [&](size_t) {
+		rk4_step<EagerVector<float, DIM>, DIM>(eager, h);
+		do_not_optimize(eager);
+	});
+
+	auto fused = random_state<Vector<float, DIM>, DIM>();
+	suite.run("RK4 step, DIM " + dim, [&](size_t) {
+		rk4_step<Vector<float, DIM>, DIM>(fused, h);
+		do_not_optimize(fused);
+	});
+}
+} // namespace
+
+// DIM 7 is the spinning top state, 384 the Bezier cube (2 * 3 * 64).
+void run_generic_vector_benchmarks(BenchmarkSuite& suite) {
+	run_rk4_benchmarks<7>(suite);
+	run_rk4_benchmarks<384>(suite);
+}
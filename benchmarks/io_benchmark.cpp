@@ -0,0 +1,145 @@
+#include "benchmark.h"
+#include "algebra.h"
+#include "image_loader.h"
+#include "mesh_file.h"
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <random>
+
+#ifndef BENCH_DATA_DIR
+#define BENCH_DATA_DIR "models/"
+#endif
+
+namespace {
+// Writes a width x height 24-bit BMP with a gradient, bottom-up rows.
+void write_test_bmp(const std::string &filename, int width, int height) {
+	const int row_size = (3 * width + 3) / 4 * 4;
+	const unsigned int data_size = row_size * height;
+	const unsigned int file_size = 54 + data_size;
+	unsigned char header[54] = {'B', 'M'};
+	const auto put32 = [&header](int offset, unsigned int value) {
+		for (int i = 0; i < 4; ++i)
+			header[offset + i] = (value >> (8 * i)) & 0xff;
+	};
+	put32(2, file_size);
+	put32(10, 54);
+	put32(14, 40);
+	put32(18, width);
+	put32(22, height);
+	header[26] = 1;
+	header[28] = 24;
+	put32(34, data_size);
+
+	std::vector<unsigned char> data(data_size);
+	for (int y = 0; y < height; ++y)
+		for (int x = 0; x < width; ++x) {
+			unsigned char *p = &data[y * row_size + 3 * x];
+			p[0] = x & 0xff;
+			p[1] = y & 0xff;
+			p[2] = (x + y) & 0xff;
+		}
+
+	std::ofstream s(filename, std::ios::binary);
+	s.write(reinterpret_cast<const char *>(header), sizeof(header));
+	s.write(reinterpret_cast<const char *>(data.data()), data.size());
+}
+
+// Writes a mesh file with vertex_count random vertices and twice as many
+// triangles.
+void write_test_mesh(const std::string &filename, int vertex_count) {
+	std::mt19937 gen(42);
+	std::uniform_real_distribution<float> dist(-100.0f, 100.0f);
+	std::ofstream s(filename);
+	s << std::fixed << std::setprecision(4) << vertex_count << '\n';
+	for (int i = 0; i < vertex_count; ++i) {
+		for (int j = 0; j < 8; ++j)
+			s << dist(gen) << (j < 7 ? ' ' : '\n');
+	}
+	s << 2 * vertex_count << '\n';
+	for (int i = 0; i < 2 * vertex_count; ++i)
+		s << gen() % vertex_count << ' ' << gen() % vertex_count << ' ' << gen() % vertex_count << '\n';
+}
+
+// the parser used before read_mesh_file memory-mapped the file
+MeshFileData read_mesh_file_ifstream(const char *filename) {
+	std::ifstream s(filename);
+	int vertex_count, triangle_count;
+	MeshFileData data;
+	s >> vertex_count;
+	data.vertices.resize(vertex_count);
+	data.normals.resize(vertex_count);
+	data.uvs.resize(vertex_count);
+	for (int i = 0; i < vertex_count; ++i)
+		s >> data.vertices[i].x >> data.vertices[i].y >> data.vertices[i].z >> data.normals[i].x >>
+			data.normals[i].y >> data.normals[i].z >> data.uvs[i].x >> data.uvs[i].y;
+	s >> triangle_count;
+	data.indices.resize(triangle_count);
+	for (auto &t : data.indices)
+		s >> t.i >> t.j >> t.k;
+	return data;
+}
+
+// Writes a width x height 24-bit uncompressed TGA with the same gradient,
+// bottom-up rows.
+void write_test_tga(const std::string &filename, int width, int height) {
+	unsigned char header[18] = {};
+	header[2] = 2;
+	header[12] = width & 0xff;
+	header[13] = (width >> 8) & 0xff;
+	header[14] = height & 0xff;
+	header[15] = (height >> 8) & 0xff;
+	header[16] = 24;
+
+	std::vector<unsigned char> data(3 * width * height);
+	for (int y = 0; y < height; ++y)
+		for (int x = 0; x < width; ++x) {
+			unsigned char *p = &data[3 * (y * width + x)];
+			p[0] = x & 0xff;
+			p[1] = y & 0xff;
+			p[2] = (x + y) & 0xff;
+		}
+
+	std::ofstream s(filename, std::ios::binary);
+	s.write(reinterpret_cast<const char *>(header), sizeof(header));
+	s.write(reinterpret_cast<const char *>(data.data()), data.size());
+}
+
+// the texture path before load_image also converted every pixel to a float
+// Vector4 for the upload
+std::vector<Vector4> load_image_float(const char *filename) {
+	const Image image = load_image(filename);
+	std::vector<Vector4> pixels(static_cast<size_t>(image.width) * image.height);
+	for (size_t i = 0; i < pixels.size(); ++i)
+		pixels[i] = {image.pixels[4 * i] / 255.0f, image.pixels[4 * i + 1] / 255.0f, image.pixels[4 * i + 2] / 255.0f,
+					 image.pixels[4 * i + 3] / 255.0f};
+	return pixels;
+}
+} // namespace
+
+void run_io_benchmarks(BenchmarkSuite &suite) {
+	const std::string duck = std::string(BENCH_DATA_DIR) + "duck.txt";
+	suite.run("read_mesh_file duck.txt", [&](size_t) { do_not_optimize(read_mesh_file(duck.c_str())); });
+
+	const auto mesh = (std::filesystem::temp_directory_path() / "subsurface_bench_mesh.txt").string();
+	write_test_mesh(mesh, 1'000'000);
+	suite.run("read_mesh_file 1M vertices (ifstream)",
+			  [&](size_t) { do_not_optimize(read_mesh_file_ifstream(mesh.c_str())); });
+	suite.run("read_mesh_file 1M vertices", [&](size_t) { do_not_optimize(read_mesh_file(mesh.c_str())); });
+	std::filesystem::remove(mesh);
+
+	for (int size : {1024, 4096}) {
+		const std::string size_name = std::to_string(size) + "x" + std::to_string(size);
+		const auto bmp = (std::filesystem::temp_directory_path() / ("subsurface_bench_" + size_name + ".bmp")).string();
+		write_test_bmp(bmp, size, size);
+		suite.run("load_image BMP " + size_name + " (float pixels)",
+				  [&](size_t) { do_not_optimize(load_image_float(bmp.c_str())); });
+		suite.run("load_image BMP " + size_name, [&](size_t) { do_not_optimize(load_image(bmp.c_str())); });
+		std::filesystem::remove(bmp);
+
+		const auto tga = (std::filesystem::temp_directory_path() / ("subsurface_bench_" + size_name + ".tga")).string();
+		write_test_tga(tga, size, size);
+		suite.run("load_image TGA " + size_name, [&](size_t) { do_not_optimize(load_image(tga.c_str())); });
+		std::filesystem::remove(tga);
+	}
+}
@@ -0,0 +1,44 @@
+#include "benchmark.h"
+#include <cstring>
+
+void run_algebra_benchmarks(BenchmarkSuite &suite);
+void run_generic_vector_benchmarks(BenchmarkSuite &suite);
+void run_vertex_kernels_benchmarks(BenchmarkSuite &suite);
+void run_camera_benchmarks(BenchmarkSuite &suite);
+void run_io_benchmarks(BenchmarkSuite &suite);
+void run_task_benchmarks(BenchmarkSuite &suite);
+void run_mesh_simplifier_benchmarks(BenchmarkSuite &suite);
+void run_ensemble_benchmarks(BenchmarkSuite &suite);
+void run_ode_solver_benchmarks(BenchmarkSuite &suite);
+void run_soft_body_benchmarks(BenchmarkSuite &suite);
+void run_bernstein_benchmarks(BenchmarkSuite &suite);
+
+// Usage: subsurface_bench [--filter <substring>] [--json <file>]
+int main(int argc, char **argv) {
+	BenchmarkSuite suite;
+	const char *json = nullptr;
+	for (int i = 1; i + 1 < argc; i += 2) {
+		if (std::strcmp(argv[i], "--filter") == 0)
+			suite.set_filter(argv[i + 1]);
+		else if (std::strcmp(argv[i], "--json") == 0)
+			json = argv[i + 1];
+	}
+
+	run_algebra_benchmarks(suite);
+	run_generic_vector_benchmarks(suite);
+	run_vertex_kernels_benchmarks(suite);
+	run_camera_benchmarks(suite);
+	run_io_benchmarks(suite);
+	run_task_benchmarks(suite);
+	run_mesh_simplifier_benchmarks(suite);
+	run_ensemble_benchmarks(suite);
+	run_ode_solver_benchmarks(suite);
+	run_soft_body_benchmarks(suite);
+	run_bernstein_benchmarks(suite);
+
+	if (json && !suite.write_json(json)) {
+		fprintf(stderr, "Couldn't write %s\n", json);
+		return 1;
+	}
+	return 0;
+}
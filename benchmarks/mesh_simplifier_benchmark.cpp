@@ -0,0 +1,40 @@
+#include "benchmark.h"
+#include "mesh_simplifier.h"
+#include <cmath>
+
+namespace {
+// Bumpy UV sphere with a seam at u = 0, about the density of a head scan.
+struct SphereMesh {
+	std::vector<Vector3> vertices, normals;
+	std::vector<Vector2> uvs;
+	std::vector<IndexTriple> indices;
+};
+
+SphereMesh bumpy_sphere(unsigned int u_count, unsigned int v_count) {
+	SphereMesh mesh;
+	for (unsigned int j = 0; j <= v_count; ++j)
+		for (unsigned int i = 0; i <= u_count; ++i) {
+			const float theta = PI * j / v_count, phi = TWO_PI * (i % u_count) / u_count;
+			const float r = 1.0f + 0.01f * std::sin(7.0f * theta) * std::cos(5.0f * phi);
+			const Vector3 v = {r * std::sin(theta) * std::cos(phi), r * std::cos(theta),
+							   r * std::sin(theta) * std::sin(phi)};
+			mesh.vertices.push_back(v);
+			mesh.normals.push_back(normalize(v));
+			mesh.uvs.push_back({static_cast<float>(i) / u_count, static_cast<float>(j) / v_count});
+		}
+	const auto index = [u_count](unsigned int i, unsigned int j) { return j * (u_count + 1) + i; };
+	for (unsigned int j = 1; j + 1 < v_count; ++j)
+		for (unsigned int i = 0; i < u_count; ++i) {
+			mesh.indices.push_back({index(i, j), index(i + 1, j), index(i + 1, j + 1)});
+			mesh.indices.push_back({index(i, j), index(i + 1, j + 1), index(i, j + 1)});
+		}
+	return mesh;
+}
+} // namespace
+
+void run_mesh_simplifier_benchmarks(BenchmarkSuite &suite) {
+	const SphereMesh sphere = bumpy_sphere(400, 250);
+	suite.run("build_lod_chain, 200k triangles", [&](size_t) {
+		do_not_optimize(build_lod_chain(sphere.vertices, sphere.normals, sphere.uvs, sphere.indices));
+	});
+}
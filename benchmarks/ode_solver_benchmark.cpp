@@ -0,0 +1,70 @@
+#include "benchmark.h"
+#include "dormand_prince_ode_solver.h"
+#include "ensemble_simulation.h"
+
+namespace {
+using State = Vector<float, 7>;
+
+// unit cube spinning about its fixed corner, as the ensemble integrates it
+const SpinningTopModel TOP = {{11.0f / 12.0f, 1.0f / 6.0f, 11.0f / 12.0f},
+							   SpinningTopEnsemble::GRAVITY * std::sqrt(3.0f) / 2.0f};
+
+State spinning_top(float, const State &s) { return TOP.derivative(s); }
+
+template <class T> void normalize_quaternion(Vector<T, 7> &s) {
+	const T inv_length = T(1) / std::sqrt(s[3] * s[3] + s[4] * s[4] + s[5] * s[5] + s[6] * s[6]);
+	for (int i = 3; i < 7; ++i)
+		s[i] *= inv_length;
+}
+
+const State START = {0.0f, 3.14159265f, 0.0f, 0.96592583f, 0.0f, 0.0f, 0.25881905f};
+constexpr float DURATION = 10.0f;
+
+// fixed steps of h in float or double
+template <class T> Vector<T, 7> rk4(T h) {
+	using Vec = Vector<T, 7>;
+	const int steps = static_cast<int>(std::lround(DURATION / h));
+	Vec x;
+	for (int i = 0; i < 7; ++i)
+		x[i] = START[i];
+	for (int i = 0; i < steps; ++i) {
+		const Vec k1 = TOP.derivative(x);
+		const Vec k2 = TOP.derivative(Vec(x + (h / 2) * k1));
+		const Vec k3 = TOP.derivative(Vec(x + (h / 2) * k2));
+		const Vec k4 = TOP.derivative(Vec(x + h * k3));
+		x = x + (h / 6) * (k1 + T(2) * k2 + T(2) * k3 + k4);
+		normalize_quaternion(x);
+	}
+	return x;
+}
+
+DormandPrinceODESolver<float, 7> dormand_prince() {
+	DormandPrinceODESolver<float, 7> solver(spinning_top, 0.0f, START, 0.02f, INFINITY, normalize_quaternion<float>);
+	solver.set_tolerances(1e-6f, 1e-6f);
+	solver.advance_to(DURATION);
+	return solver;
+}
+
+float max_difference(const State &a, const Vector<double, 7> &b) {
+	double difference = 0.0;
+	for (int i = 0; i < 7; ++i)
+		difference = std::max(difference, std::abs(a[i] - b[i]));
+	return static_cast<float>(difference);
+}
+} // namespace
+
+void run_ode_solver_benchmarks(BenchmarkSuite &suite) {
+	suite.run("spinning top 10 s (RK4 at delta 0.02)", [&](size_t) { do_not_optimize(rk4(0.02f)); });
+	suite.run("spinning top 10 s (Dormand-Prince)", [&](size_t) { do_not_optimize(dormand_prince().value_at(DURATION)); });
+
+	// Float rounding alone moves the end state by a few 1e-4, so the
+	// reference is RK4 in double, converged to 1e-10 at this step. Both float
+	// solvers end up near the rounding floor.
+	const Vector<double, 7> reference = rk4(0.001);
+	const auto solver = dormand_prince();
+	suite.report("spinning top 10 s, error (RK4 at delta 0.02)", max_difference(rk4(0.02f), reference));
+	suite.report("spinning top 10 s, error (Dormand-Prince)", max_difference(solver.value_at(DURATION), reference));
+	suite.report("spinning top 10 s, evaluations (RK4 at delta 0.02)", 4 * std::lround(DURATION / 0.02f));
+	suite.report("spinning top 10 s, evaluations (Dormand-Prince)",
+				 static_cast<double>(solver.get_statistics().evaluations));
+}
@@ -0,0 +1,99 @@
+#include "benchmark.h"
+#include "mass_spring_lattice.h"
+
+namespace {
+constexpr int STEPS = 10;
+constexpr float DELTA = 0.001f;
+
+// explicit spring list over an array of points, every spring adds its force
+// to both ends
+template <int SIDE>
+struct SpringList {
+	struct Spring {
+		int a, b, type;
+		float length;
+	};
+	std::vector<Vector3> position, velocity, force;
+	std::vector<Spring> springs;
+	std::vector<int> anchors;
+	std::vector<Vector3> targets;
+
+	SpringList() {
+		const float edge = 1.0f / (SIDE - 1);
+		for (int k = 0; k < SIDE; ++k)
+			for (int j = 0; j < SIDE; ++j)
+				for (int i = 0; i < SIDE; ++i)
+					position.push_back(edge * Vector3{static_cast<float>(i), static_cast<float>(j), static_cast<float>(k)});
+		velocity.assign(position.size(), {0.0f, 0.0f, 0.0f});
+		force = velocity;
+		for (int k = 0; k < SIDE; ++k)
+			for (int j = 0; j < SIDE; ++j)
+				for (int i = 0; i < SIDE; ++i)
+					for (int dk = -1; dk <= 1; ++dk)
+						for (int dj = -1; dj <= 1; ++dj)
+							for (int di = -1; di <= 1; ++di) {
+								const int type = std::abs(di) + std::abs(dj) + std::abs(dk) - 1;
+								const int ni = i + di, nj = j + dj, nk = k + dk;
+								if (type < 0 || ni < 0 || nj < 0 || nk < 0 || ni >= SIDE || nj >= SIDE || nk >= SIDE)
+									continue;
+								const int a = i + SIDE * j + SIDE * SIDE * k, b = ni + SIDE * nj + SIDE * SIDE * nk;
+								if (a < b)
+									springs.push_back({a, b, type, edge * std::sqrt(static_cast<float>(type + 1))});
+							}
+		for (int c = 0; c < 8; ++c) {
+			anchors.push_back(MassSpringLattice<SIDE>::corner(c));
+			targets.push_back(position[anchors.back()]);
+		}
+	}
+
+	void step(const typename MassSpringLattice<SIDE>::Parameters &p, float dt) {
+		const float k[3] = {p.structural_k, p.shear_k, p.diagonal_k};
+		for (auto &f : force)
+			f = p.point_mass * p.gravity;
+		for (const auto &s : springs) {
+			const Vector3 d = position[s.b] - position[s.a];
+			const float length = std::sqrt(dot(d, d));
+			const Vector3 u = d / length;
+			const Vector3 f = (k[s.type] * (length - s.length) + p.damping * dot(velocity[s.b] - velocity[s.a], u)) * u;
+			force[s.a] = force[s.a] + f;
+			force[s.b] = force[s.b] - f;
+		}
+		for (size_t c = 0; c < anchors.size(); ++c) {
+			const int i = anchors[c];
+			force[i] = force[i] + p.anchor_k * (targets[c] - position[i]) - p.anchor_damping * velocity[i];
+		}
+		for (size_t i = 0; i < position.size(); ++i) {
+			velocity[i] = velocity[i] + (dt / p.point_mass) * force[i];
+			position[i] = position[i] + dt * velocity[i];
+		}
+	}
+};
+
+template <int SIDE>
+void run_lattice_pair(BenchmarkSuite &suite, const char *list_name, const char *lattice_name) {
+	SpringList<SIDE> list;
+	MassSpringLattice<SIDE> lattice;
+	for (int c = 0; c < 8; ++c)
+		lattice.anchor(MassSpringLattice<SIDE>::corner(c), lattice.get_position(MassSpringLattice<SIDE>::corner(c)));
+
+	// both restart every iteration so every run steps the same states
+	const auto start = list.position;
+	suite.run(list_name, [&](size_t) {
+		list.position = start;
+		std::fill(list.velocity.begin(), list.velocity.end(), Vector3{0.0f, 0.0f, 0.0f});
+		for (int s = 0; s < STEPS; ++s)
+			list.step(lattice.parameters, DELTA);
+		do_not_optimize(list.position[0]);
+	});
+	suite.run(lattice_name, [&](size_t) {
+		lattice.reset();
+		lattice.run(DELTA, STEPS);
+		do_not_optimize(lattice.get_position(0));
+	});
+}
+} // namespace
+
+void run_soft_body_benchmarks(BenchmarkSuite &suite) {
+	run_lattice_pair<4>(suite, "4^3 lattice, 10 steps (spring list)", "4^3 lattice, 10 steps (SoA lattice)");
+	run_lattice_pair<16>(suite, "16^3 lattice, 10 steps (spring list)", "16^3 lattice, 10 steps (SoA lattice)");
+}
@@ -0,0 +1,172 @@
+#include "benchmark.h"
+#include "task.h"
+#include "frame_graph.h"
+#include "triple_buffer.h"
+#include "state_history.h"
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+class CountingStep : public SingleTaskStep {
+	std::atomic<int> &counter;
+
+  public:
+	explicit CountingStep(std::atomic<int> &counter) : counter(counter) {}
+
+	virtual bool execute(const TaskParameters &) override {
+		++counter;
+		return false;
+	}
+
+	virtual void execute_immediately(const TaskParameters &) override { ++counter; }
+};
+
+// stands in for a per-frame CPU job, e.g. culling or kernel generation
+float busy_work(int seed) {
+	float x = static_cast<float>(seed);
+	for (int i = 0; i < 20000; ++i)
+		x = x * 0.999f + 1.0f;
+	return x;
+}
+
+// roughly the spinning top state with its time
+struct Snapshot {
+	float time;
+	float state[7];
+};
+} // namespace
+
+void run_task_benchmarks(BenchmarkSuite &suite) {
+	std::atomic<int> counter{0};
+
+	suite.run("Task step (add + execute_immediately)", [&](size_t) {
+		Task task;
+		task.add_step<CountingStep>(counter);
+		task.execute_immediately();
+	});
+
+	// ThreadTask runs on the shared pool, so this is the submission latency
+	const float delta_time = 0.0f;
+	suite.run("ThreadTask step (start + first step)", [&](size_t) {
+		TaskManager manager;
+		const int expected = counter + 1;
+		ThreadTask task(delta_time);
+		task.add_step<CountingStep>(counter);
+		manager.add_thread_task(std::move(task));
+		while (counter < expected)
+			std::this_thread::yield();
+	});
+
+	// many short jobs, as started by concurrent simulations or bake jobs
+	constexpr int JOBS = 256;
+	suite.run("256 jobs (std::thread each, old impl)", [&](size_t) {
+		std::vector<std::thread> threads;
+		for (int i = 0; i < JOBS; ++i)
+			threads.emplace_back([&]() { ++counter; });
+		for (auto &thread : threads)
+			thread.join();
+	});
+
+	suite.run("256 jobs (ThreadPool)", [&](size_t) {
+		ThreadPool &pool = ThreadPool::shared();
+		std::atomic<int> done{0};
+		for (int i = 0; i < JOBS; ++i)
+			pool.submit([&]() {
+				++counter;
+				++done;
+			});
+		while (done < JOBS)
+			std::this_thread::yield();
+	});
+
+	// the renderer picking up the latest simulation state while a task
+	// thread publishes as fast as it can
+	{
+		std::atomic<bool> stop{false};
+		std::mutex mutex;
+		Snapshot locked{};
+		std::thread writer([&]() {
+			for (float t = 0.0f; !stop; t += 1.0f) {
+				std::lock_guard<std::mutex> lock(mutex);
+				locked.time = t;
+			}
+		});
+		suite.run("State hand-off read (mutex copy)", [&](size_t) {
+			Snapshot copy;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				copy = locked;
+			}
+			do_not_optimize(copy);
+		});
+		stop = true;
+		writer.join();
+	}
+	{
+		std::atomic<bool> stop{false};
+		TripleBuffer<Snapshot> buffer;
+		std::thread writer([&]() {
+			for (float t = 0.0f; !stop; t += 1.0f) {
+				buffer.write_buffer().time = t;
+				buffer.publish();
+			}
+		});
+		suite.run("State hand-off read (TripleBuffer)", [&](size_t) {
+			buffer.update();
+			do_not_optimize(buffer.read_buffer());
+		});
+		stop = true;
+		writer.join();
+	}
+
+	// a frame's worth of integration steps reaching a trace listener: one
+	// virtual notify per step into an unbounded vector, or a batch drained
+	// from the sample queue into the bounded history
+	{
+		constexpr int STEPS = 1000;
+		struct TraceListener : StateListener<float, 7> {
+			std::vector<StateSample<float, 7>> trace;
+			void notify(const float &time, const Vector<float, 7> &state) override { trace.push_back({time, state}); }
+			void reset() override { trace.clear(); }
+		} listener;
+		StateListener<float, 7> *listeners[] = {&listener};
+		suite.run("1000 step states to a listener (notify per step, old impl)", [&](size_t) {
+			if (listener.trace.size() > 1'000'000)
+				listener.reset();
+			for (int i = 0; i < STEPS; ++i)
+				for (auto *l : listeners)
+					l->notify(i * 0.001f, Vector<float, 7>(float(i), 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f));
+			do_not_optimize(listener.trace.back());
+		});
+
+		SampleQueue<float, 7> queue(1 << 14);
+		StateHistory<float, 7> history(1000);
+		suite.run("1000 step states to a listener (SampleQueue batch)", [&](size_t) {
+			for (int i = 0; i < STEPS; ++i)
+				queue.push(i * 0.001f, Vector<float, 7>(float(i), 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f));
+			queue.drain([&](const StateSample<float, 7> *batch, size_t count) { history.push(batch, count); });
+			do_not_optimize(history.back());
+		});
+	}
+
+	// eight independent per-frame jobs and one GL job reading their results
+	constexpr int FRAME_JOBS = 8;
+	float results[FRAME_JOBS];
+	suite.run("8 frame jobs (serial, old impl)", [&](size_t) {
+		for (int i = 0; i < FRAME_JOBS; ++i)
+			results[i] = busy_work(i);
+		do_not_optimize(results);
+	});
+
+	FrameGraph graph;
+	suite.run("8 frame jobs (FrameGraph)", [&](size_t) {
+		for (int i = 0; i < FRAME_JOBS; ++i)
+			graph.add("job", JobAffinity::Worker, [&results, i]() { results[i] = busy_work(i); }).writes(&results[i]);
+		auto &reader = graph.add("gl read", JobAffinity::Gl, [&]() { do_not_optimize(results); });
+		for (int i = 0; i < FRAME_JOBS; ++i)
+			reader.reads(&results[i]);
+		graph.execute();
+	});
+}
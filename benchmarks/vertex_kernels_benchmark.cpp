@@ -0,0 +1,64 @@
+#include "benchmark.h"
+#include "vertex_kernels.h"
+#include <random>
+
+namespace {
+// about the size of a dense head scan
+constexpr size_t VERTEX_COUNT = 2'000'000;
+
+std::vector<Vector3> random_vertices() {
+	std::mt19937 gen(42);
+	std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+	std::vector<Vector3> res(VERTEX_COUNT);
+	for (auto &v : res)
+		v = {dist(gen), dist(gen), dist(gen)};
+	return res;
+}
+} // namespace
+
+void run_vertex_kernels_benchmarks(BenchmarkSuite &suite) {
+	const auto vertices = random_vertices();
+	std::vector<Vector3> out(VERTEX_COUNT);
+	Matrix4x4 transform = Matrix4x4::identity();
+	transform.elem[0][3] = 1.0f;
+
+	suite.run("bounds, 2M vertices (Box::add)", [&](size_t) {
+		Box box = Box::degenerate();
+		for (const auto &v : vertices)
+			box.add(v);
+		do_not_optimize(box);
+	});
+	suite.run("bounds, 2M vertices", [&](size_t) {
+		do_not_optimize(vertex_kernels::bounds(vertices.data(), vertices.size()));
+	});
+
+	suite.run("scale and offset, 2M vertices (loop)", [&](size_t) {
+		for (size_t i = 0; i < vertices.size(); ++i)
+			out[i] = 0.5f * vertices[i] + Vector3{0.5f, 0.25f, 0.5f};
+		do_not_optimize(out[0]);
+	});
+	suite.run("scale and offset, 2M vertices", [&](size_t) {
+		vertex_kernels::scale_offset(vertices.data(), out.data(), vertices.size(), 0.5f, {0.5f, 0.25f, 0.5f});
+		do_not_optimize(out[0]);
+	});
+
+	suite.run("transform points, 2M vertices (loop)", [&](size_t) {
+		for (size_t i = 0; i < vertices.size(); ++i)
+			out[i] = (transform * Vector4::extend(vertices[i], 1.0f)).xyz();
+		do_not_optimize(out[0]);
+	});
+	suite.run("transform points, 2M vertices", [&](size_t) {
+		vertex_kernels::transform_points(transform, vertices.data(), out.data(), vertices.size());
+		do_not_optimize(out[0]);
+	});
+
+	suite.run("normalize, 2M vertices (loop)", [&](size_t) {
+		for (size_t i = 0; i < vertices.size(); ++i)
+			out[i] = normalize(vertices[i]);
+		do_not_optimize(out[0]);
+	});
+	suite.run("normalize, 2M vertices", [&](size_t) {
+		vertex_kernels::normalize(vertices.data(), out.data(), vertices.size());
+		do_not_optimize(out[0]);
+	});
+}